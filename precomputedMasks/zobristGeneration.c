@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include "Utils.h"
+
+#define BOARD_LENGTH 8
+
+// Run this program with: gcc precomputedMasks/zobristGeneration.c -o zobristGeneration && ./zobristGeneration
+// The output is pasted in src/state/zobrist.c
+
+// A fixed seed so that the keys are the same every time the program is run
+u64 seed = 0x2545F4914F6CDD1DUL;
+
+// splitmix64, which gives much better 64 bits numbers than rand()
+u64 nextRandomKey() {
+    seed += 0x9E3779B97F4A7C15UL;
+    u64 z = seed;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+    return z ^ (z >> 31);
+}
+
+int main() {
+    FILE* output = fopen("zobristKeys.txt", "w");
+
+    // Indexed with (piece - 9), the rows 6 and 7 are never used
+    fprintf(output, "u64 zobristPieceKeys[14][BOARD_SIZE] = {\n");
+    for (int i = 0; i < 14; i++) {
+        fprintf(output, "    {");
+        for (int square = 0; square < BOARD_SIZE; square++) {
+            // Index 6 and 7 are not valid pieces
+            u64 key = (i == 6 || i == 7) ? 0UL : nextRandomKey();
+            fprintf(output, "%luUL", key);
+            if (square + 1 != BOARD_SIZE) {
+                fprintf(output, ", ");
+            }
+        }
+        fprintf(output, i + 1 != 14 ? "},\n" : "}\n");
+    }
+    fprintf(output, "};\n");
+
+    // Indexed with GameState.castlingPerm
+    fprintf(output, "u64 zobristCastlingKeys[16] = {");
+    for (int i = 0; i < 16; i++) {
+        fprintf(output, "%luUL", i == 0 ? 0UL : nextRandomKey());
+        fprintf(output, i + 1 != 16 ? ", " : "};\n");
+    }
+
+    // Indexed with the file of the en-passant target square
+    fprintf(output, "u64 zobristEnPassantKeys[BOARD_LENGTH] = {");
+    for (int i = 0; i < BOARD_LENGTH; i++) {
+        fprintf(output, "%luUL", nextRandomKey());
+        fprintf(output, i + 1 != BOARD_LENGTH ? ", " : "};\n");
+    }
+
+    fprintf(output, "u64 zobristBlackToMoveKey = %luUL;\n", nextRandomKey());
+
+    fclose(output);
+    return 0;
+}
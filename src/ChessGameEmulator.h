@@ -6,4 +6,10 @@
 
 void makeMove(Move move, GameState* state);
 
+/**
+ * Passes the turn to the opponent without moving a piece.
+ * This is not a legal chess move, it is used by the search for null move pruning
+*/
+void makeNullMove(GameState* state);
+
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define MOVEGENERATOR_H
 
 #include <stddef.h>
+#include <stdbool.h>
 #include "state/GameState.h"
 #include "state/Move.h"
 
@@ -11,4 +12,57 @@
 */
 void getValidMoves(Move results[MAX_LEGAL_MOVES + 1], const GameState currentGameState, const GameState* previousStates);
 
+/**
+ * Returns the bitboard of the squares the piece on `square` can legally move to, for the UI to highlight them when
+ * the piece is touched. It is 0 if the square has no piece of the side to move.
+ * Only the pins, the checks and the moves of that piece are computed, not every legal move of the position.
+ * A castling is the square the king lands on, and a promotion is a single square.
+ * The draws by repetition or by the fifty move rule are not looked at, it is up to the caller (see sessionStatus)
+*/
+u64 legalTargetsFrom(const GameState state, int square);
+
+/**
+ * Same as legalTargetsFrom for every square at once, which is cheaper than 64 calls.
+ * Returns the number of legal moves (a promotion counts as 4), so 0 means checkmate or stalemate
+*/
+int legalTargetsAll(const GameState state, u64 results[BOARD_SIZE]);
+
+/**
+ * Returns the bitboard of the `attackerColor` pieces that attack `square`.
+ * The sliding pieces are blocked by the pieces in `occupancy`
+*/
+u64 attackersOfSquare(const Board board, int square, u64 occupancy, PieceCharacteristics attackerColor);
+
+/**
+ * Returns true if the king of the side to move is attacked
+*/
+bool isInCheck(const GameState state);
+
+/**
+ * The steps of getValidMoves. The king moves step includes the pins and checks step, which runs inside it
+*/
+typedef enum MoveGenerationPhase {
+    PHASE_ATTACK_SQUARES, // calculateAttackSquares
+    PHASE_KING_MOVES, // generateKingMoves
+    PHASE_PINS_AND_CHECKS, // handlePinsAndChecksFromSlidingPieces
+    PHASE_SUPPORTING_PIECES_MOVES, // generateSupportingPiecesMoves
+    NB_MOVE_GENERATION_PHASES
+} MoveGenerationPhase;
+
+typedef struct MoveGenerationProfile {
+    u64 calls[NB_MOVE_GENERATION_PHASES];
+    u64 cycles[NB_MOVE_GENERATION_PHASES]; // Time stamp counter ticks on x86, nanoseconds elsewhere
+} MoveGenerationProfile;
+
+/**
+ * Copies the phase counters of the calling thread (every thread counts its own getValidMoves calls).
+ * The counters only exist when the library is built with CHESS_ENGINE_PROFILE_MOVE_GENERATION,
+ * otherwise this returns false and the profile is all zeros
+*/
+bool getMoveGenerationProfile(MoveGenerationProfile* result);
+
+void resetMoveGenerationProfile();
+
+const char* moveGenerationPhaseName(MoveGenerationPhase phase);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef POLYGLOT_BOOK_H
+#define POLYGLOT_BOOK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+#include "../utils/MappedFile.h"
+
+#define POLYGLOT_RANDOM_SIZE 781
+#define POLYGLOT_ENTRY_SIZE 16
+
+extern const u64 polyglotRandom64[POLYGLOT_RANDOM_SIZE];
+
+/**
+ * An opening book in the Polyglot .bin format: entries of 16 big endian bytes (key, move, weight, learn)
+ * sorted by key. The file is memory mapped and never copied
+*/
+typedef struct PolyglotBook {
+    MappedFile file;
+    size_t nbEntries;
+} PolyglotBook;
+
+typedef struct BookMove {
+    Move move;
+    unsigned short weight;
+} BookMove;
+
+/**
+ * Returns false if the file cannot be mapped or is not made of whole entries
+*/
+bool openPolyglotBook(const char* path, PolyglotBook* book);
+void closePolyglotBook(PolyglotBook* book);
+
+/**
+ * Returns the key of the position, compatible with every Polyglot book
+*/
+u64 polyglotKey(const GameState* state);
+
+/**
+ * Writes the book moves of the position in `results`, at most `maxMoves` of them, and returns how many there are.
+ * The moves use the engine's encoding and flags, they are in the book's order (best weight first for most books).
+ * The entries that are not legal moves of the position (key collisions or broken books) are skipped
+*/
+int probePolyglotBook(const PolyglotBook* book, const GameState* state, BookMove* results, int maxMoves);
+
+/**
+ * Picks one of the book moves of the position with a probability proportional to its weight.
+ * `random` is any random number, the caller chooses the generator. Returns 0 if the position is not in the book
+*/
+Move pickPolyglotBookMove(const PolyglotBook* book, const GameState* state, u64 random);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef POSITION_INDEX_H
+#define POSITION_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../utils/Utils.h"
+#include "../utils/MappedFile.h"
+#include "../utils/PgnReader.h"
+
+#define POSITION_INDEX_MAGIC "CEPIDX01"
+#define POSITION_INDEX_HEADER_SIZE 32
+
+/**
+ * The games that reached each position of a PGN file, keyed by the Zobrist key of the position.
+ * The file is a 32 byte header (magic, number of keys, number of postings) followed by three arrays of little endian u64:
+ * the sorted keys, the start of the postings of each key (plus the end of the last one) and the postings.
+ * It is memory mapped and read in place, so a query is a binary search on the keys and nothing is copied.
+ * The arrays stay in the byte order of the file, big endian machines swap each number when they read it
+*/
+typedef struct PositionIndex {
+    MappedFile file;
+    const u64* keys;
+    const u64* postingStarts; // The postings of keys[i] go from postingStarts[i] to postingStarts[i + 1]
+    const u64* postings;
+    size_t nbKeys;
+    size_t nbPostings;
+} PositionIndex;
+
+/**
+ * A posting is a game: its offset in the PGN file shifted by 2, with its PgnResult in the 2 low bits.
+ * The postings of a position are sorted by game offset, and a game is only there once even if the position was repeated
+*/
+size_t gameOffsetFromPosting(u64 posting);
+PgnResult resultFromPosting(u64 posting);
+
+typedef struct PositionResults {
+    size_t nbGames;
+    size_t nbWhiteWins;
+    size_t nbBlackWins;
+    size_t nbDraws; // The other games have an unknown result
+} PositionResults;
+
+typedef struct PositionIndexStats {
+    size_t nbGames;
+    size_t nbInvalidGames; // Not indexed, see importPgnFile
+    size_t nbKeys; // The different positions
+    size_t nbPostings;
+} PositionIndexStats;
+
+/**
+ * Replays the games of the PGN file on `nbThreads` threads and writes the index of their positions.
+ * The postings are sorted in memory, so the machine needs 16 bytes of RAM per position of the file.
+ * Needs the magic bitboards to be initialized. Returns false if the PGN file cannot be read or the index cannot be written
+*/
+bool buildPositionIndex(const char* pgnPath, const char* indexPath, int nbThreads, PositionIndexStats* stats);
+
+/**
+ * Returns false if the file cannot be mapped or is not a position index
+*/
+bool openPositionIndex(const char* path, PositionIndex* index);
+void closePositionIndex(PositionIndex* index);
+
+/**
+ * Returns the postings of the games that reached the position, which point in the mapped file, and sets their number in `nbGames`.
+ * They are little endian, read them with `positionIndexPosting`. Returns NULL if no game reached it
+*/
+const u64* findPositionGames(const PositionIndex* index, u64 zobristKey, size_t* nbGames);
+
+/**
+ * Returns the posting i of an array given by `findPositionGames`, in the byte order of the machine
+*/
+u64 positionIndexPosting(const u64* postings, size_t i);
+
+PositionResults findPositionResults(const PositionIndex* index, u64 zobristKey);
+
+#endif
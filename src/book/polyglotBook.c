@@ -0,0 +1,176 @@
+#include "PolyglotBook.h"
+#include "../utils/Utils.h"
+#include "../MoveGenerator.h"
+
+#define POLYGLOT_CASTLING_OFFSET 768
+#define POLYGLOT_EN_PASSANT_OFFSET 772
+#define POLYGLOT_TURN_OFFSET 780
+#define MAX_BOOK_MOVES 64 // More than enough, books rarely have more than 20 moves for a position
+
+// Indexed with (piece - 9), so 6 and 7 are not pieces. White kinds are odd, black kinds are even
+static const int polyglotKindFromBitBoardIndex[14] = { 11, 3, 5, 9, 7, 1, -1, -1, 10, 2, 4, 8, 6, 0 };
+
+// Indexed with the promotion piece of a Polyglot move: none, knight, bishop, rook, queen
+static const Flag flagFromPolyglotPromotion[5] = { NOFlAG, PROMOTE_TO_KNIGHT, PROMOTE_TO_BISHOP, PROMOTE_TO_ROOK, PROMOTE_TO_QUEEN };
+
+static u64 readBigEndian(const unsigned char* data, int nbBytes) {
+    u64 result = 0;
+    for (int i = 0; i < nbBytes; i++) {
+        result = (result << 8) | data[i];
+    }
+    return result;
+}
+
+static const unsigned char* bookEntry(const PolyglotBook* book, size_t index) {
+    return book->file.data + index * POLYGLOT_ENTRY_SIZE;
+}
+
+bool openPolyglotBook(const char* path, PolyglotBook* book) {
+    if (!mapFile(path, &book->file)) { return false; }
+    if (book->file.size % POLYGLOT_ENTRY_SIZE != 0) {
+        unmapFile(&book->file);
+        return false;
+    }
+    book->nbEntries = book->file.size / POLYGLOT_ENTRY_SIZE;
+    return true;
+}
+
+void closePolyglotBook(PolyglotBook* book) {
+    unmapFile(&book->file);
+    book->nbEntries = 0;
+}
+
+/**
+ * Polyglot only hashes the en-passant file when a pawn of the side to move can actually take
+*/
+static bool canCaptureEnPassant(const GameState* state) {
+    int target = state->enPassantTargetSquare;
+    if (target < 0) { return false; }
+    Piece pawn = makePiece(state->colorToGo, PAWN);
+    // The capturing pawns are next to the pawn that just moved two squares
+    int pawnRow = state->colorToGo == WHITE ? target + BOARD_LENGTH : target - BOARD_LENGTH;
+    int file = target % BOARD_LENGTH;
+    return (file > 0 && pieceAtIndex(state->board, pawnRow - 1) == pawn) ||
+           (file < BOARD_LENGTH - 1 && pieceAtIndex(state->board, pawnRow + 1) == pawn);
+}
+
+u64 polyglotKey(const GameState* state) {
+    u64 key = 0;
+    for (int bitBoardIndex = 0; bitBoardIndex < 14; bitBoardIndex++) {
+        int kind = polyglotKindFromBitBoardIndex[bitBoardIndex];
+        if (kind < 0) { continue; }
+        u64 bitBoard = bitBoardForPiece(state->board, (Piece) (bitBoardIndex + 9));
+        while (bitBoard) {
+            int index = trailingZeros_64(bitBoard);
+            // Polyglot squares start at a1, ours start at a8
+            key ^= polyglotRandom64[64 * kind + (index ^ 56)];
+            bitBoard &= bitBoard - 1;
+        }
+    }
+
+    // The bits of our castling perm are in the reverse order of the Polyglot castling keys
+    for (int i = 0; i < 4; i++) {
+        if (state->castlingPerm & (1 << (3 - i))) {
+            key ^= polyglotRandom64[POLYGLOT_CASTLING_OFFSET + i];
+        }
+    }
+    if (canCaptureEnPassant(state)) {
+        key ^= polyglotRandom64[POLYGLOT_EN_PASSANT_OFFSET + state->enPassantTargetSquare % BOARD_LENGTH];
+    }
+    if (state->colorToGo == WHITE) {
+        key ^= polyglotRandom64[POLYGLOT_TURN_OFFSET];
+    }
+    return key;
+}
+
+/**
+ * Returns the move of `legalMoves` (0 terminated) that the Polyglot move stands for,
+ * or 0 if it is not legal in the position (a key collision or a bad entry)
+*/
+static Move moveFromPolyglotMove(const GameState* state, const Move* legalMoves, unsigned short polyglotMove) {
+    int toFile = polyglotMove & 0b111;
+    int toRow = (polyglotMove >> 3) & 0b111;
+    int fromFile = (polyglotMove >> 6) & 0b111;
+    int fromRow = (polyglotMove >> 9) & 0b111;
+    int promotion = (polyglotMove >> 12) & 0b111;
+    int from = (7 - fromRow) * BOARD_LENGTH + fromFile;
+    int to = (7 - toRow) * BOARD_LENGTH + toFile;
+    if (promotion > 4) { return 0; }
+
+    Piece piece = pieceAtIndex(state->board, from);
+    if (pieceType(piece) == KING && pieceAtIndex(state->board, to) == makePiece(state->colorToGo, ROOK)) {
+        // Polyglot castles by taking its own rook, we move the king by two squares
+        to = to > from ? from + 2 : from - 2;
+    }
+    for (int i = 0; legalMoves[i]; i++) {
+        if (fromSquareFromMove(legalMoves[i]) != from || toSquareFromMove(legalMoves[i]) != to) { continue; }
+        Flag flag = flagFromMove(legalMoves[i]);
+        bool isPromotion = flag >= PROMOTE_TO_QUEEN && flag <= PROMOTE_TO_BISHOP;
+        if (isPromotion ? flag == flagFromPolyglotPromotion[promotion] : promotion == 0) { return legalMoves[i]; }
+    }
+    return 0;
+}
+
+/**
+ * Returns the index of the first entry with the key, or the number of entries if there is none
+*/
+static size_t findFirstBookEntry(const PolyglotBook* book, u64 key) {
+    size_t low = 0;
+    size_t high = book->nbEntries;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (readBigEndian(bookEntry(book, middle), 8) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+int probePolyglotBook(const PolyglotBook* book, const GameState* state, BookMove* results, int maxMoves) {
+    if (book == NULL || book->nbEntries == 0) { return 0; }
+    u64 key = polyglotKey(state);
+    size_t first = findFirstBookEntry(book, key);
+    if (first == book->nbEntries || readBigEndian(bookEntry(book, first), 8) != key) { return 0; }
+
+    // The fifty move rule does not matter for a book move, getValidMoves would only return its draw
+    GameState position = *state;
+    position.turnsForFiftyRule = 0;
+    Move legalMoves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(legalMoves, position, NULL);
+    Flag firstFlag = flagFromMove(legalMoves[0]);
+    if (firstFlag == CHECKMATE || firstFlag == STALEMATE) { return 0; }
+
+    int nbMoves = 0;
+    for (size_t i = first; i < book->nbEntries && nbMoves < maxMoves; i++) {
+        const unsigned char* entry = bookEntry(book, i);
+        if (readBigEndian(entry, 8) != key) { break; }
+        Move move = moveFromPolyglotMove(state, legalMoves, (unsigned short) readBigEndian(entry + 8, 2));
+        if (move == 0) { continue; }
+        results[nbMoves].move = move;
+        results[nbMoves].weight = (unsigned short) readBigEndian(entry + 10, 2);
+        nbMoves++;
+    }
+    return nbMoves;
+}
+
+Move pickPolyglotBookMove(const PolyglotBook* book, const GameState* state, u64 random) {
+    BookMove moves[MAX_BOOK_MOVES];
+    int nbMoves = probePolyglotBook(book, state, moves, MAX_BOOK_MOVES);
+    if (nbMoves == 0) { return 0; }
+
+    u64 totalWeight = 0;
+    for (int i = 0; i < nbMoves; i++) {
+        totalWeight += moves[i].weight;
+    }
+    // Some books only have moves with a weight of 0, they are all as good as each other
+    if (totalWeight == 0) { return moves[random % nbMoves].move; }
+
+    u64 pick = random % totalWeight;
+    for (int i = 0; i < nbMoves; i++) {
+        if (pick < moves[i].weight) { return moves[i].move; }
+        pick -= moves[i].weight;
+    }
+    return moves[nbMoves - 1].move;
+}
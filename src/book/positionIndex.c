@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "PositionIndex.h"
+
+// The positions of a game are gathered on its import thread, then added to the builder all at once
+#define GAME_BUFFER_SIZE 512
+#define WRITE_BUFFER_SIZE 4096
+
+typedef struct IndexEntry {
+    u64 key;
+    u64 posting;
+} IndexEntry;
+
+typedef struct IndexBuilder {
+    pthread_mutex_t mutex;
+    IndexEntry* entries;
+    size_t nbEntries;
+    size_t capacity;
+} IndexBuilder;
+
+static _Thread_local IndexEntry gameEntries[GAME_BUFFER_SIZE];
+static _Thread_local size_t nbGameEntries;
+
+/**
+ * The file is in little endian, so the numbers only need to be swapped on big endian machines.
+ * Swapping twice gives back the original, so the same function reads and writes
+*/
+static u64 swapIndexByteOrder(u64 number) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(number);
+#else
+    return number;
+#endif
+}
+
+size_t gameOffsetFromPosting(u64 posting) {
+    return (size_t) (posting >> 2);
+}
+
+PgnResult resultFromPosting(u64 posting) {
+    return (PgnResult) (posting & 3);
+}
+
+static void flushGameEntries(IndexBuilder* builder) {
+    pthread_mutex_lock(&builder->mutex);
+    if (builder->nbEntries + nbGameEntries > builder->capacity) {
+        while (builder->nbEntries + nbGameEntries > builder->capacity) {
+            builder->capacity = builder->capacity == 0 ? (1 << 16) : builder->capacity * 2;
+        }
+        builder->entries = realloc(builder->entries, sizeof(IndexEntry) * builder->capacity);
+        assert(builder->entries != NULL && "Malloc failed so buy more RAM lol");
+    }
+    memcpy(builder->entries + builder->nbEntries, gameEntries, sizeof(IndexEntry) * nbGameEntries);
+    builder->nbEntries += nbGameEntries;
+    pthread_mutex_unlock(&builder->mutex);
+    nbGameEntries = 0;
+}
+
+static void indexPosition(const PgnPosition* position, void* userData) {
+    gameEntries[nbGameEntries].key = position->state->zobristKey;
+    gameEntries[nbGameEntries].posting = ((u64) position->gameOffset << 2) | (u64) position->result;
+    nbGameEntries++;
+    // The last position of a game has no move
+    if (nbGameEntries == GAME_BUFFER_SIZE || position->move == 0) {
+        flushGameEntries(userData);
+    }
+}
+
+static int compareIndexEntries(const void* a, const void* b) {
+    const IndexEntry* first = a;
+    const IndexEntry* second = b;
+    if (first->key != second->key) { return first->key < second->key ? -1 : 1; }
+    if (first->posting != second->posting) { return first->posting < second->posting ? -1 : 1; }
+    return 0;
+}
+
+/**
+ * Writes the numbers through a buffer, so that the arrays of the index can be written without building them in memory
+*/
+typedef struct IndexWriter {
+    FILE* file;
+    u64 buffer[WRITE_BUFFER_SIZE];
+    size_t nbBuffered;
+    bool hasFailed;
+} IndexWriter;
+
+static void flushIndexWriter(IndexWriter* writer) {
+    if (writer->nbBuffered && fwrite(writer->buffer, sizeof(u64), writer->nbBuffered, writer->file) != writer->nbBuffered) {
+        writer->hasFailed = true;
+    }
+    writer->nbBuffered = 0;
+}
+
+static void writeIndexNumber(IndexWriter* writer, u64 number) {
+    writer->buffer[writer->nbBuffered++] = swapIndexByteOrder(number);
+    if (writer->nbBuffered == WRITE_BUFFER_SIZE) { flushIndexWriter(writer); }
+}
+
+static bool writePositionIndex(const char* path, const IndexEntry* entries, size_t nbEntries, size_t nbKeys) {
+    IndexWriter* writer = malloc(sizeof(IndexWriter));
+    assert(writer != NULL && "Malloc failed so buy more RAM lol");
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        free(writer);
+        return false;
+    }
+    writer->nbBuffered = 0;
+    writer->hasFailed = fwrite(POSITION_INDEX_MAGIC, 1, 8, writer->file) != 8;
+    writeIndexNumber(writer, nbKeys);
+    writeIndexNumber(writer, nbEntries);
+    writeIndexNumber(writer, 0); // Reserved
+
+    for (size_t i = 0; i < nbEntries; i++) {
+        if (i == 0 || entries[i].key != entries[i - 1].key) { writeIndexNumber(writer, entries[i].key); }
+    }
+    for (size_t i = 0; i < nbEntries; i++) {
+        if (i == 0 || entries[i].key != entries[i - 1].key) { writeIndexNumber(writer, i); }
+    }
+    writeIndexNumber(writer, nbEntries);
+    for (size_t i = 0; i < nbEntries; i++) {
+        writeIndexNumber(writer, entries[i].posting);
+    }
+    flushIndexWriter(writer);
+
+    bool isWritten = !writer->hasFailed;
+    isWritten &= fclose(writer->file) == 0;
+    free(writer);
+    return isWritten;
+}
+
+bool buildPositionIndex(const char* pgnPath, const char* indexPath, int nbThreads, PositionIndexStats* stats) {
+    memset(stats, 0, sizeof(PositionIndexStats));
+    IndexBuilder builder = { .entries = NULL };
+    pthread_mutex_init(&builder.mutex, NULL);
+    PgnImportStats importStats;
+    bool isImported = importPgnFile(pgnPath, nbThreads, indexPosition, &builder, &importStats);
+    pthread_mutex_destroy(&builder.mutex);
+    if (!isImported) { return false; }
+
+    // The threads added the games in any order, the sort makes the index the same whatever the number of threads
+    qsort(builder.entries, builder.nbEntries, sizeof(IndexEntry), compareIndexEntries);
+    size_t nbEntries = 0, nbKeys = 0;
+    for (size_t i = 0; i < builder.nbEntries; i++) {
+        // A repeated position gives the same entry twice
+        if (nbEntries > 0 && compareIndexEntries(&builder.entries[i], &builder.entries[nbEntries - 1]) == 0) { continue; }
+        if (nbEntries == 0 || builder.entries[i].key != builder.entries[nbEntries - 1].key) { nbKeys++; }
+        builder.entries[nbEntries++] = builder.entries[i];
+    }
+
+    bool isWritten = writePositionIndex(indexPath, builder.entries, nbEntries, nbKeys);
+    free(builder.entries);
+    stats->nbGames = importStats.nbGames;
+    stats->nbInvalidGames = importStats.nbInvalidGames;
+    stats->nbKeys = nbKeys;
+    stats->nbPostings = nbEntries;
+    return isWritten;
+}
+
+bool openPositionIndex(const char* path, PositionIndex* index) {
+    memset(index, 0, sizeof(PositionIndex));
+    if (!mapFile(path, &index->file)) { return false; }
+    const unsigned char* data = index->file.data;
+    size_t size = index->file.size;
+    if (size < POSITION_INDEX_HEADER_SIZE || memcmp(data, POSITION_INDEX_MAGIC, 8) != 0) {
+        closePositionIndex(index);
+        return false;
+    }
+    const u64* header = (const u64*) data;
+    u64 nbKeys = swapIndexByteOrder(header[1]), nbPostings = swapIndexByteOrder(header[2]);
+    u64 nbNumbers = (size - POSITION_INDEX_HEADER_SIZE) / sizeof(u64);
+    if ((size - POSITION_INDEX_HEADER_SIZE) % sizeof(u64) != 0 || nbKeys >= nbNumbers || nbPostings > nbNumbers
+        || 2 * nbKeys + 1 + nbPostings != nbNumbers) {
+        closePositionIndex(index);
+        return false;
+    }
+    index->nbKeys = nbKeys;
+    index->nbPostings = nbPostings;
+    index->keys = (const u64*) (data + POSITION_INDEX_HEADER_SIZE);
+    index->postingStarts = index->keys + nbKeys;
+    index->postings = index->postingStarts + nbKeys + 1;
+    if (swapIndexByteOrder(index->postingStarts[nbKeys]) != nbPostings) {
+        closePositionIndex(index);
+        return false;
+    }
+    return true;
+}
+
+void closePositionIndex(PositionIndex* index) {
+    unmapFile(&index->file);
+    memset(index, 0, sizeof(PositionIndex));
+}
+
+u64 positionIndexPosting(const u64* postings, size_t i) {
+    return swapIndexByteOrder(postings[i]);
+}
+
+const u64* findPositionGames(const PositionIndex* index, u64 zobristKey, size_t* nbGames) {
+    *nbGames = 0;
+    size_t low = 0;
+    size_t high = index->nbKeys;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (swapIndexByteOrder(index->keys[middle]) < zobristKey) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == index->nbKeys || swapIndexByteOrder(index->keys[low]) != zobristKey) { return NULL; }
+    u64 start = swapIndexByteOrder(index->postingStarts[low]), end = swapIndexByteOrder(index->postingStarts[low + 1]);
+    // A damaged file could point outside of the postings
+    if (start > end || end > index->nbPostings) { return NULL; }
+    *nbGames = end - start;
+    return index->postings + start;
+}
+
+PositionResults findPositionResults(const PositionIndex* index, u64 zobristKey) {
+    PositionResults results = { 0 };
+    const u64* postings = findPositionGames(index, zobristKey, &results.nbGames);
+    for (size_t i = 0; i < results.nbGames; i++) {
+        switch (resultFromPosting(positionIndexPosting(postings, i))) {
+            case PGN_WHITE_WINS: results.nbWhiteWins++; break;
+            case PGN_BLACK_WINS: results.nbBlackWins++; break;
+            case PGN_DRAW: results.nbDraws++; break;
+            default: break;
+        }
+    }
+    return results;
+}
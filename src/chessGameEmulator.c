@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "ChessGameEmulator.h"
+#include "state/Zobrist.h"
 
 void _updateCastlePerm(int pieceToMove, int from, GameState* state) {
   if (state->castlingPerm == 0) { return; }
@@ -44,23 +45,82 @@ void _updateCastlePerm(int pieceToMove, int from, GameState* state) {
 
 }
 
-void _updateFiftyMoveRule(int pieceToMove, int to, GameState* state) {
-  if (pieceType(pieceToMove) == PAWN || pieceAtIndex(state->board, to) != NOPIECE) {
+void _updateFiftyMoveRule(int pieceToMove, Piece capturedPiece, GameState* state) {
+  if (pieceType(pieceToMove) == PAWN || capturedPiece != NOPIECE) {
     state->turnsForFiftyRule = 0; // A pawn has moved or a capture has happened
-  } else {
+  } else if (state->turnsForFiftyRule < UINT8_MAX) {
     state->turnsForFiftyRule++; // No captures or pawn advance happenned
   }
 }
 
+Piece _pieceLandingOnTargetSquare(Piece pieceToMove, Flag flag, PieceCharacteristics color) {
+  switch (flag) {
+    case PROMOTE_TO_QUEEN:
+      return makePiece(color, QUEEN);
+    case PROMOTE_TO_KNIGHT:
+      return makePiece(color, KNIGHT);
+    case PROMOTE_TO_ROOK:
+      return makePiece(color, ROOK);
+    case PROMOTE_TO_BISHOP:
+      return makePiece(color, BISHOP);
+    default:
+      return pieceToMove;
+  }
+}
+
+void _recordDirtyPiece(GameState* state, int index, Piece piece, bool added) {
+  DirtyPieces* dirtyPieces = &state->dirtyPieces;
+  dirtyPieces->pieces[dirtyPieces->nbDirtyPieces] = piece;
+  dirtyPieces->indices[dirtyPieces->nbDirtyPieces] = (char) index;
+  dirtyPieces->added[dirtyPieces->nbDirtyPieces] = added;
+  dirtyPieces->nbDirtyPieces++;
+}
+
+// Every change to the board goes through these two functions, so that the evaluation is updated incrementally
+void _addPieceAtIndex(GameState* state, int index, Piece piece) {
+  togglePieceAtIndex(&state->board, index, piece);
+  addPieceToPieceSquareScore(&state->pieceSquareScore, index, piece);
+  _recordDirtyPiece(state, index, piece, true);
+  state->zobristKey ^= zobristPieceKeys[piece - 9][index];
+  if (pieceType(piece) == PAWN) {
+    state->pawnKey ^= zobristPieceKeys[piece - 9][index];
+  }
+}
+
+void _removePieceAtIndex(GameState* state, int index, Piece piece) {
+  togglePieceAtIndex(&state->board, index, piece);
+  removePieceFromPieceSquareScore(&state->pieceSquareScore, index, piece);
+  _recordDirtyPiece(state, index, piece, false);
+  state->zobristKey ^= zobristPieceKeys[piece - 9][index];
+  if (pieceType(piece) == PAWN) {
+    state->pawnKey ^= zobristPieceKeys[piece - 9][index];
+  }
+}
+
 void makeMove(Move move, GameState* state) {
   int from = fromSquareFromMove(move);
   int to = toSquareFromMove(move);
   Flag flag = flagFromMove(move);
   int pieceToMove = pieceAtIndex(state->board, from);
+  Piece capturedPiece = pieceAtIndex(state->board, to);
+
+  // The castling perm and the en-passant square are hashed back once they are updated at the end
+  state->zobristKey ^= zobristCastlingKeys[state->castlingPerm];
+  if (state->enPassantTargetSquare != -1) {
+    state->zobristKey ^= zobristEnPassantKeys[state->enPassantTargetSquare % 8];
+  }
+
   _updateCastlePerm(pieceToMove, from, state);
-  _updateFiftyMoveRule(pieceToMove, to, state);
+  // Capturing a rook on its starting square also removes the castling perm of that side
+  _updateCastlePerm(capturedPiece, to, state);
+  _updateFiftyMoveRule(pieceToMove, capturedPiece, state);
+  state->dirtyPieces.nbDirtyPieces = 0;
 
-  handleMove(&state->board, from, to);
+  _removePieceAtIndex(state, from, pieceToMove);
+  if (capturedPiece != NOPIECE) {
+    _removePieceAtIndex(state, to, capturedPiece);
+  }
+  _addPieceAtIndex(state, to, _pieceLandingOnTargetSquare(pieceToMove, flag, state->colorToGo));
 
   PieceCharacteristics oppositeColor = state->colorToGo == WHITE ? BLACK : WHITE;
 
@@ -74,7 +134,7 @@ void makeMove(Move move, GameState* state) {
   case EN_PASSANT:
     enPassantPawnIndex = state->colorToGo == WHITE ? to + 8 : to - 8;
     piece = pieceAtIndex(state->board, enPassantPawnIndex);
-    togglePieceAtIndex(&state->board, enPassantPawnIndex, piece);
+    _removePieceAtIndex(state, enPassantPawnIndex, piece);
     break;
   case DOUBLE_PAWN_PUSH:
     enPassantPawnIndex = state->colorToGo == WHITE ? to + 8 : to - 8;
@@ -83,34 +143,20 @@ void makeMove(Move move, GameState* state) {
   case KING_SIDE_CASTLING:
     rookIndex = from + 3;
     piece = pieceAtIndex(state->board, rookIndex);
-    togglePieceAtIndex(&state->board, rookIndex, piece);
-    togglePieceAtIndex(&state->board, to - 1, piece);
+    _removePieceAtIndex(state, rookIndex, piece);
+    _addPieceAtIndex(state, to - 1, piece);
     break;
   case QUEEN_SIDE_CASTLING:
     rookIndex = from - 4;
     piece = pieceAtIndex(state->board, rookIndex);
-    togglePieceAtIndex(&state->board, rookIndex, piece);
-    togglePieceAtIndex(&state->board, to + 1, piece);
-    break;
-  case PROMOTE_TO_QUEEN: 
-    togglePieceAtIndex(&state->board, to, makePiece(state->colorToGo, QUEEN));
-    // To undo what the `handleMove` function did wrong (on accident, I might add)
-    togglePieceAtIndex(&state->board, to, pieceToMove);
-    break;
-  case PROMOTE_TO_KNIGHT: 
-    togglePieceAtIndex(&state->board, to, makePiece(state->colorToGo, KNIGHT));
-    // To undo what the `handleMove` function did wrong (on accident, I might add)
-    togglePieceAtIndex(&state->board, to, pieceToMove);
-    break;
-  case PROMOTE_TO_ROOK: 
-    togglePieceAtIndex(&state->board, to, makePiece(state->colorToGo, ROOK));
-    // To undo what the `handleMove` function did wrong (on accident, I might add)
-    togglePieceAtIndex(&state->board, to, pieceToMove);
+    _removePieceAtIndex(state, rookIndex, piece);
+    _addPieceAtIndex(state, to + 1, piece);
     break;
-  case PROMOTE_TO_BISHOP: 
-    togglePieceAtIndex(&state->board, to, makePiece(state->colorToGo, BISHOP));
-    // To undo what the `handleMove` function did wrong (on accident, I might add)
-    togglePieceAtIndex(&state->board, to, pieceToMove);
+  case PROMOTE_TO_QUEEN:
+  case PROMOTE_TO_KNIGHT:
+  case PROMOTE_TO_ROOK:
+  case PROMOTE_TO_BISHOP:
+    // The promoted piece was already put on the board by _pieceLandingOnTargetSquare
     break;
   default:
     printf("ERROR: Invalid flag %d\n", flag);
@@ -123,4 +169,21 @@ void makeMove(Move move, GameState* state) {
   if (state->colorToGo == WHITE) {
     state->nbMoves++; // Only recording full moves
   }
+
+  state->zobristKey ^= zobristCastlingKeys[state->castlingPerm];
+  if (state->enPassantTargetSquare != -1) {
+    state->zobristKey ^= zobristEnPassantKeys[state->enPassantTargetSquare % 8];
+  }
+  state->zobristKey ^= zobristBlackToMoveKey;
+}
+
+void makeNullMove(GameState* state) {
+  state->dirtyPieces.nbDirtyPieces = 0;
+  if (state->enPassantTargetSquare != -1) {
+    state->zobristKey ^= zobristEnPassantKeys[state->enPassantTargetSquare % 8];
+    state->enPassantTargetSquare = -1;
+  }
+  if (state->turnsForFiftyRule < UINT8_MAX) { state->turnsForFiftyRule++; }
+  state->colorToGo = state->colorToGo == WHITE ? BLACK : WHITE;
+  state->zobristKey ^= zobristBlackToMoveKey;
 }
\ No newline at end of file
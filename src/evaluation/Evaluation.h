@@ -0,0 +1,14 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include "../state/GameState.h"
+#include "PawnHashTable.h"
+
+/**
+ * Returns the static evaluation of a position in centipawns.
+ * The result is from the point of view of the side to move (positive is good for `colorToGo`)
+ * The pawn structure is cached in `pawnHashTable`, which can be NULL if the caller does not have one
+*/
+int evaluate(const GameState* state, PawnHashTable* pawnHashTable);
+
+#endif
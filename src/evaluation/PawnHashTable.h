@@ -0,0 +1,45 @@
+#ifndef PAWN_HASH_TABLE_H
+#define PAWN_HASH_TABLE_H
+
+#include <stddef.h>
+#include "../state/Board.h"
+
+/**
+ * The cached result of the pawn structure analysis of a position.
+ * The scores are from white's point of view, like the PieceSquareScore.
+*/
+typedef struct PawnHashEntry {
+    u64 pawnKey;
+    int middleGame;
+    int endGame;
+    u64 passedPawns[2]; // Index 0 is for white and 1 for black
+} PawnHashEntry;
+
+/**
+ * A cache of pawn structure evaluations, indexed with GameState.pawnKey.
+ * It is not thread safe, every searching thread needs to own its table.
+*/
+typedef struct PawnHashTable {
+    PawnHashEntry* entries;
+    size_t mask; // The number of entries is a power of two, so the index is `pawnKey & mask`
+} PawnHashTable;
+
+/**
+ * Allocates a table with `nbEntries` entries, rounded down to a power of two
+*/
+PawnHashTable* createPawnHashTable(size_t nbEntries);
+void freePawnHashTable(PawnHashTable* table);
+void clearPawnHashTable(PawnHashTable* table);
+
+/**
+ * Computes the isolated, doubled, backward and passed pawns terms from scratch
+*/
+PawnHashEntry evaluatePawnStructure(Board board, u64 pawnKey);
+
+/**
+ * Returns the pawn structure entry for this position, only analysing the pawns if the entry is not in the table.
+ * `table` can be NULL, in which case the pawns are always analysed and the result is written to `scratch`
+*/
+const PawnHashEntry* probePawnHashTable(PawnHashTable* table, Board board, u64 pawnKey, PawnHashEntry* scratch);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef PIECE_SQUARE_TABLES_H
+#define PIECE_SQUARE_TABLES_H
+
+#include "../state/Board.h"
+
+// The phase of a position where every piece is still on the board (pawns and kings do not count)
+#define MAX_GAME_PHASE 24
+
+/**
+ * Material plus piece square table score of a position.
+ * The scores are always from white's point of view (positive is good for white).
+ * The phase goes from MAX_GAME_PHASE (opening) to 0 (only kings and pawns left).
+ * This struct is updated incrementally by the makeMove function, so it never needs to be recomputed.
+*/
+typedef struct PieceSquareScore {
+    int middleGame;
+    int endGame;
+    int phase;
+} PieceSquareScore;
+
+void addPieceToPieceSquareScore(PieceSquareScore* score, int index, Piece piece);
+void removePieceFromPieceSquareScore(PieceSquareScore* score, int index, Piece piece);
+
+/**
+ * Computes the score from scratch. Use this when a position is created (e.g. from a fen string)
+*/
+PieceSquareScore pieceSquareScoreFromBoard(Board board);
+
+#endif
@@ -0,0 +1,48 @@
+#include <stdbool.h>
+#include "Evaluation.h"
+
+// End game bonus for a passed pawn that has no piece in its way, indexed with the rank from its own side
+static const int freePassedPawnBonus[8] = { 0, 0, 5, 10, 20, 35, 60, 0 };
+
+static int freePassedPawnsScore(u64 passedPawns, u64 allPieces, PieceCharacteristics color) {
+    int result = 0;
+    while (passedPawns) {
+        int index = trailingZeros_64(passedPawns);
+        passedPawns &= passedPawns - 1;
+        // Walking the squares in front of the pawn up to the promotion square
+        int increment = color == WHITE ? -8 : 8;
+        bool isPathFree = true;
+        for (int square = index + increment; square >= 0 && square < BOARD_SIZE; square += increment) {
+            if ((allPieces >> square) & 1) {
+                isPathFree = false;
+                break;
+            }
+        }
+        if (isPathFree) {
+            int row = index / 8;
+            result += freePassedPawnBonus[color == WHITE ? 7 - row : row];
+        }
+    }
+    return result;
+}
+
+int evaluate(const GameState* state, PawnHashTable* pawnHashTable) {
+    const PieceSquareScore score = state->pieceSquareScore;
+    int middleGame = score.middleGame;
+    int endGame = score.endGame;
+
+    PawnHashEntry scratch;
+    const PawnHashEntry* pawnEntry = probePawnHashTable(pawnHashTable, state->board, state->pawnKey, &scratch);
+    middleGame += pawnEntry->middleGame;
+    endGame += pawnEntry->endGame;
+    // The passed pawns are cached, but whether their path is blocked depends on the other pieces
+    u64 allPieces = allPiecesBitBoard(state->board);
+    endGame += freePassedPawnsScore(pawnEntry->passedPawns[0], allPieces, WHITE);
+    endGame -= freePassedPawnsScore(pawnEntry->passedPawns[1], allPieces, BLACK);
+
+    // Promotions can make the phase go over the max, which would give a negative weight to the end game score
+    int phase = score.phase > MAX_GAME_PHASE ? MAX_GAME_PHASE : score.phase;
+    // Tapering the score between the middle game and the end game depending on the material left
+    int result = (middleGame * phase + endGame * (MAX_GAME_PHASE - phase)) / MAX_GAME_PHASE;
+    return state->colorToGo == WHITE ? result : -result;
+}
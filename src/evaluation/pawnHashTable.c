@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "PawnHashTable.h"
+
+#define FILE_A_MASK 0x0101010101010101UL
+
+// Penalties and bonuses as {middle game, end game}
+static const int doubledPawnPenalty[2] = { -11, -28 };
+static const int isolatedPawnPenalty[2] = { -12, -16 };
+static const int backwardPawnPenalty[2] = { -8, -11 };
+// Indexed with the rank of the pawn from its own side (0 is the first rank, 7 the promotion rank)
+static const int passedPawnBonus[2][8] = {
+    { 0, 2, 6, 12, 22, 40, 70, 0 },
+    { 0, 8, 14, 24, 42, 72, 115, 0 }
+};
+
+PawnHashTable* createPawnHashTable(size_t nbEntries) {
+    size_t powerOfTwo = 1;
+    while (powerOfTwo * 2 <= nbEntries) {
+        powerOfTwo *= 2;
+    }
+    PawnHashTable* table = malloc(sizeof(PawnHashTable));
+    assert(table != NULL && "Malloc failed so buy more RAM lol");
+    table->entries = calloc(powerOfTwo, sizeof(PawnHashEntry));
+    assert(table->entries != NULL && "Malloc failed so buy more RAM lol");
+    table->mask = powerOfTwo - 1;
+    return table;
+}
+
+void freePawnHashTable(PawnHashTable* table) {
+    if (table == NULL) { return; }
+    free(table->entries);
+    free(table);
+}
+
+void clearPawnHashTable(PawnHashTable* table) {
+    memset(table->entries, 0, sizeof(PawnHashEntry) * (table->mask + 1));
+}
+
+static u64 adjacentFilesMask(int file) {
+    u64 result = 0;
+    if (file > 0) { result |= FILE_A_MASK << (file - 1); }
+    if (file < 7) { result |= FILE_A_MASK << (file + 1); }
+    return result;
+}
+
+// Remember that row 0 is the 8th rank, so white pawns go towards the smaller rows
+static u64 rowsInFrontMask(int row, PieceCharacteristics color) {
+    if (color == WHITE) {
+        return row == 0 ? 0 : (~(u64) 0) >> (8 * (8 - row));
+    }
+    return row == 7 ? 0 : (~(u64) 0) << (8 * (row + 1));
+}
+
+static u64 pawnAttacksBitBoard(u64 pawns, PieceCharacteristics color) {
+    u64 notFileA = ~FILE_A_MASK;
+    u64 notFileH = ~(FILE_A_MASK << 7);
+    if (color == WHITE) {
+        return ((pawns & notFileA) >> 9) | ((pawns & notFileH) >> 7);
+    }
+    return ((pawns & notFileA) << 7) | ((pawns & notFileH) << 9);
+}
+
+static void evaluatePawnsOfColor(PawnHashEntry* entry, u64 friendlyPawns, u64 enemyPawns, PieceCharacteristics color) {
+    int sign = color == WHITE ? 1 : -1;
+    int middleGame = 0, endGame = 0;
+    u64 passedPawns = 0;
+    u64 enemyPawnAttacks = pawnAttacksBitBoard(enemyPawns, color == WHITE ? BLACK : WHITE);
+
+    u64 pawns = friendlyPawns;
+    while (pawns) {
+        int index = trailingZeros_64(pawns);
+        pawns &= pawns - 1;
+        int row = index / 8;
+        int file = index % 8;
+        u64 fileMask = FILE_A_MASK << file;
+        u64 adjacentFiles = adjacentFilesMask(file);
+        u64 inFront = rowsInFrontMask(row, color);
+        
+        if (friendlyPawns & fileMask & inFront) {
+            // Only the pawn at the back is penalized, so a file with two pawns gets one penalty
+            middleGame += doubledPawnPenalty[0];
+            endGame += doubledPawnPenalty[1];
+        }
+
+        bool isIsolated = (friendlyPawns & adjacentFiles) == 0;
+        if (isIsolated) {
+            middleGame += isolatedPawnPenalty[0];
+            endGame += isolatedPawnPenalty[1];
+        }
+
+        if ((enemyPawns & (fileMask | adjacentFiles) & inFront) == 0 && (friendlyPawns & fileMask & inFront) == 0) {
+            passedPawns |= ((u64) 1) << index;
+            int relativeRank = color == WHITE ? 7 - row : row;
+            middleGame += passedPawnBonus[0][relativeRank];
+            endGame += passedPawnBonus[1][relativeRank];
+        } else if (!isIsolated) {
+            // A backward pawn has no friendly pawn beside or behind it, and cannot advance without being captured
+            u64 besideOrBehind = ~inFront & adjacentFiles;
+            int stopSquare = color == WHITE ? index - 8 : index + 8;
+            if ((friendlyPawns & besideOrBehind) == 0 && ((enemyPawnAttacks >> stopSquare) & 1)) {
+                middleGame += backwardPawnPenalty[0];
+                endGame += backwardPawnPenalty[1];
+            }
+        }
+    }
+
+    entry->middleGame += sign * middleGame;
+    entry->endGame += sign * endGame;
+    entry->passedPawns[color == WHITE ? 0 : 1] = passedPawns;
+}
+
+PawnHashEntry evaluatePawnStructure(Board board, u64 pawnKey) {
+    PawnHashEntry entry = { 0 };
+    entry.pawnKey = pawnKey;
+    u64 whitePawns = bitBoardForPiece(board, makePiece(WHITE, PAWN));
+    u64 blackPawns = bitBoardForPiece(board, makePiece(BLACK, PAWN));
+    evaluatePawnsOfColor(&entry, whitePawns, blackPawns, WHITE);
+    evaluatePawnsOfColor(&entry, blackPawns, whitePawns, BLACK);
+    return entry;
+}
+
+const PawnHashEntry* probePawnHashTable(PawnHashTable* table, Board board, u64 pawnKey, PawnHashEntry* scratch) {
+    if (table == NULL) {
+        *scratch = evaluatePawnStructure(board, pawnKey);
+        return scratch;
+    }
+    PawnHashEntry* entry = &table->entries[pawnKey & table->mask];
+    // A position without pawns has a key of 0, which is also what an empty entry looks like, and that is fine
+    // since the analysis of no pawns gives an entry full of 0 
+    if (entry->pawnKey != pawnKey) {
+        *entry = evaluatePawnStructure(board, pawnKey);
+    }
+    return entry;
+}
@@ -10,24 +10,52 @@
 #include "MoveGenerator.h"
 #include "magicBitBoard/MagicBitBoard.h"
 
-GameState currentState;
+#if defined(CHESS_ENGINE_PROFILE_MOVE_GENERATION)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define readCycleCounter() __rdtsc()
+#else
+#include <time.h>
+static inline u64 readCycleCounter() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+#endif
+
+static _Thread_local MoveGenerationProfile profile;
+
+// Runs `call` and adds its duration to the counters of `phase`
+#define PROFILE_PHASE(phase, call) \
+do { \
+    u64 phaseStart = readCycleCounter(); \
+    call; \
+    profile.calls[phase]++; \
+    profile.cycles[phase] += readCycleCounter() - phaseStart; \
+} while (0)
+#else
+#define PROFILE_PHASE(phase, call) call
+#endif
+
+// Every thread generates its own moves, so the state of the generator is thread local
+static _Thread_local GameState currentState;
 
-Move* validMoves;
-int currentMoveIndex;
+static _Thread_local Move* validMoves;
+static _Thread_local int currentMoveIndex;
 
-PieceCharacteristics opponentColor;
-int friendlyKingIndex;
+static _Thread_local PieceCharacteristics opponentColor;
+static _Thread_local int friendlyKingIndex;
 
 // For O(1) .contains call
-bool attackedSquares[BOARD_SIZE];
+static _Thread_local bool attackedSquares[BOARD_SIZE];
 
-bool inDoubleCheck;
-bool inCheck;
-bool enPassantWillRemoveTheCheck;
+static _Thread_local bool inDoubleCheck;
+static _Thread_local bool inCheck;
+static _Thread_local bool enPassantWillRemoveTheCheck;
 
-u64 checkBitBoard;
-u64 pinMasks[BOARD_SIZE];
-u64 friendlyPieceBitBoard;
+static _Thread_local u64 checkBitBoard;
+static _Thread_local u64 pinMasks[BOARD_SIZE];
+static _Thread_local u64 friendlyPieceBitBoard;
 
 void init() {
     opponentColor = currentState.colorToGo == WHITE ? BLACK : WHITE;
@@ -285,7 +313,7 @@ void generateKingMoves() {
     if (inDoubleCheck) { return; } // Only king moves are valid
     
     generateCastle();
-    handlePinsAndChecksFromSlidingPieces();
+    PROFILE_PHASE(PHASE_PINS_AND_CHECKS, handlePinsAndChecksFromSlidingPieces());
 
     u64 toggle = (u64) 1;
     // Handling checks from pawns and knights
@@ -294,6 +322,10 @@ void generateKingMoves() {
     // For loop is remove copy pasting. I know sometimes I copy paste a lot but I was fed up this time
     for (int i = 0; i < 2; i++) {
         potentialPawn = friendlyKingIndex + (i == 0 ? 7 : 9) * delta;
+        // On the a and h files one of the two squares wraps around to the other side of the board
+        if (potentialPawn < 0 || potentialPawn >= BOARD_SIZE) { continue; }
+        int fileDistance = potentialPawn % 8 - friendlyKingIndex % 8;
+        if (fileDistance != 1 && fileDistance != -1) { continue; }
         if (pieceAtIndex(currentState.board, potentialPawn) == makePiece(opponentColor, PAWN)) {
             checkBitBoard |= toggle << potentialPawn;
 
@@ -544,46 +576,45 @@ void pawnMoves(int from) {
     }
 }
 
+static void generatePieceMoves(int currentIndex, int piece) {
+    u64 pseudoLegalMovesBitBoard;
+    switch (pieceType(piece)) {
+        case ROOK: 
+            rookMoves(currentIndex);
+            break;
+        case BISHOP:
+            bishopMoves(currentIndex);
+            break;
+        case QUEEN:
+            queenMoves(currentIndex);
+            break;
+        case KNIGHT:
+            pseudoLegalMovesBitBoard = knightMovementMask[currentIndex];
+            pseudoLegalMovesBitBoard &= ~friendlyPieceBitBoard; // We invert the bit board so that we do not capture friendly pieces
+            appendLegalMovesFromPseudoLegalMovesBitBoard(currentIndex, pseudoLegalMovesBitBoard);
+            break;
+        case PAWN:
+            pawnMoves(currentIndex);
+            break;
+        default:
+            break;
+    }
+}
+
 void generateSupportingPiecesMoves() {
     for (int currentIndex = 0; currentIndex < BOARD_SIZE; currentIndex++) {
         const int piece = pieceAtIndex(currentState.board, currentIndex);
         if (piece == NOPIECE || pieceColor(piece) == opponentColor) { continue; }
-        
-        u64 pseudoLegalMovesBitBoard;
-        switch (pieceType(piece)) {
-            case ROOK: 
-                rookMoves(currentIndex);
-                break;
-            case BISHOP:
-                bishopMoves(currentIndex);
-                break;
-            case QUEEN:
-                queenMoves(currentIndex);
-                break;
-            case KNIGHT:
-                pseudoLegalMovesBitBoard = knightMovementMask[currentIndex];
-                pseudoLegalMovesBitBoard &= ~friendlyPieceBitBoard; // We invert the bit board so that we do not capture friendly pieces
-                appendLegalMovesFromPseudoLegalMovesBitBoard(currentIndex, pseudoLegalMovesBitBoard);
-                break;
-            case PAWN:
-                pawnMoves(currentIndex);
-                break;
-            default:
-                break;
-        }
+        generatePieceMoves(currentIndex, piece);
     }
 }
 
-bool compareGameStateForRepetition(const GameState gameStateToCompare) {
-    // Comparing boards
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        if (pieceAtIndex(currentState.board, i) != pieceAtIndex(gameStateToCompare.board, i)) {
-            return false;
-        }
-    }
-    return currentState.castlingPerm == gameStateToCompare.castlingPerm &&
-        currentState.colorToGo == gameStateToCompare.colorToGo &&
-        currentState.enPassantTargetSquare == gameStateToCompare.enPassantTargetSquare;
+bool compareGameStateForRepetition(const GameState* gameStateToCompare) {
+    // The same position always has the same 8 bitboards, so the boards are compared a cache line at a time
+    return currentState.castlingPerm == gameStateToCompare->castlingPerm &&
+        currentState.colorToGo == gameStateToCompare->colorToGo &&
+        currentState.enPassantTargetSquare == gameStateToCompare->enPassantTargetSquare &&
+        memcmp(&currentState.board, &gameStateToCompare->board, sizeof(Board)) == 0;
 }
 
 bool isThereThreeFoldRepetition(const GameState* previousStates) {
@@ -593,12 +624,11 @@ bool isThereThreeFoldRepetition(const GameState* previousStates) {
     bool hasOneDuplicate = false;
     int index = 0;
     bool result = false;
-    GameState previousState;
     // If colorToGo == 0 then it is not a valid state
     while (true) {
 
-        previousState = previousStates[index];
-        if (previousState.colorToGo == 0) {
+        const GameState* previousState = &previousStates[index];
+        if (previousState->colorToGo == 0) {
             break;
         }
 
@@ -622,15 +652,16 @@ void getValidMoves(Move results[MAX_LEGAL_MOVES + 1], const GameState currentGam
     validMoves = results;
     currentMoveIndex = 0;
     
-    if (isThereThreeFoldRepetition(previousStates) || (currentState.turnsForFiftyRule >= 50)) {
+    // turnsForFiftyRule counts half moves, so the fifty move rule is reached after 100 of them
+    if (isThereThreeFoldRepetition(previousStates) || (currentState.turnsForFiftyRule >= 100)) {
         appendMove(0, 0, DRAW); // This is the `draw` move
         // We assume that the array is 0 initialized, so we do not need to add a 0 entry
         return; 
     }
 
     init();
-    calculateAttackSquares();
-    generateKingMoves();
+    PROFILE_PHASE(PHASE_ATTACK_SQUARES, calculateAttackSquares());
+    PROFILE_PHASE(PHASE_KING_MOVES, generateKingMoves());
 
     if (inDoubleCheck) { 
         // Only king moves are valid when in double check
@@ -642,7 +673,7 @@ void getValidMoves(Move results[MAX_LEGAL_MOVES + 1], const GameState currentGam
         return;
     }
     
-    generateSupportingPiecesMoves();
+    PROFILE_PHASE(PHASE_SUPPORTING_PIECES_MOVES, generateSupportingPiecesMoves());
     
     if (currentMoveIndex == 0) {
         // There is no valid move
@@ -653,4 +684,107 @@ void getValidMoves(Move results[MAX_LEGAL_MOVES + 1], const GameState currentGam
         }
     }
     // We assume that the array is 0 initialized, so we do not need to add a 0 entry
-}
\ No newline at end of file
+}
+
+/**
+ * The part of getValidMoves that every piece needs: the attacked squares, the pins, the check mask and the king moves
+*/
+static void prepareLegalTargets(const GameState* state, Move* moves) {
+    currentState = *state;
+    validMoves = moves;
+    currentMoveIndex = 0;
+    init();
+    calculateAttackSquares();
+    generateKingMoves();
+}
+
+static void addTargetsOfMoves(const Move* moves, int nbMoves, u64 results[BOARD_SIZE]) {
+    for (int i = 0; i < nbMoves; i++) {
+        // The from and to squares, without the calls to fromSquareFromMove and toSquareFromMove
+        results[moves[i] & 0x3F] |= ((u64) 1) << ((moves[i] >> 6) & 0x3F);
+    }
+}
+
+u64 legalTargetsFrom(const GameState state, int square) {
+    if (square < 0 || square >= BOARD_SIZE) { return 0; }
+    const int piece = pieceAtIndex(state.board, square);
+    if (piece == NOPIECE || pieceColor(piece) != state.colorToGo) { return 0; }
+
+    Move moves[MAX_LEGAL_MOVES + 1];
+    prepareLegalTargets(&state, moves);
+    if (pieceType(piece) != KING) {
+        if (inDoubleCheck) { return 0; }
+        // The king moves were only needed for the pins and the checks
+        currentMoveIndex = 0;
+        generatePieceMoves(square, piece);
+    }
+
+    // Every move left starts from `square`
+    u64 result = 0;
+    for (int i = 0; i < currentMoveIndex; i++) {
+        result |= ((u64) 1) << ((moves[i] >> 6) & 0x3F);
+    }
+    return result;
+}
+
+int legalTargetsAll(const GameState state, u64 results[BOARD_SIZE]) {
+    memset(results, 0, sizeof(u64) * BOARD_SIZE);
+    Move moves[MAX_LEGAL_MOVES + 1];
+    prepareLegalTargets(&state, moves);
+    if (!inDoubleCheck) { generateSupportingPiecesMoves(); }
+    addTargetsOfMoves(moves, currentMoveIndex, results);
+    return currentMoveIndex;
+}
+
+u64 attackersOfSquare(const Board board, int square, u64 occupancy, PieceCharacteristics attackerColor) {
+    u64 rooksAndQueens = bitBoardForPiece(board, makePiece(attackerColor, ROOK)) | bitBoardForPiece(board, makePiece(attackerColor, QUEEN));
+    u64 bishopsAndQueens = bitBoardForPiece(board, makePiece(attackerColor, BISHOP)) | bitBoardForPiece(board, makePiece(attackerColor, QUEEN));
+    u64 result = 0;
+    result |= getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square]) & rooksAndQueens;
+    result |= getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square]) & bishopsAndQueens;
+    result |= knightMovementMask[square] & bitBoardForPiece(board, makePiece(attackerColor, KNIGHT));
+    result |= kingMovementMask[square] & bitBoardForPiece(board, makePiece(attackerColor, KING));
+
+    // A pawn attacks the square if it is one rank behind the square (from the pawn's point of view) on an adjacent file
+    u64 pawns = bitBoardForPiece(board, makePiece(attackerColor, PAWN));
+    int file = square % 8;
+    int behind = attackerColor == WHITE ? square + 8 : square - 8;
+    if (behind >= 0 && behind < BOARD_SIZE) {
+        if (file > 0) { result |= pawns & (((u64) 1) << (behind - 1)); }
+        if (file < 7) { result |= pawns & (((u64) 1) << (behind + 1)); }
+    }
+    return result;
+}
+
+bool isInCheck(const GameState state) {
+    u64 kingBitBoard = bitBoardForPiece(state.board, makePiece(state.colorToGo, KING));
+    if (!kingBitBoard) { return false; }
+    PieceCharacteristics attackerColor = state.colorToGo == WHITE ? BLACK : WHITE;
+    return attackersOfSquare(state.board, trailingZeros_64(kingBitBoard), allPiecesBitBoard(state.board), attackerColor) != 0;
+}
+
+bool getMoveGenerationProfile(MoveGenerationProfile* result) {
+#if defined(CHESS_ENGINE_PROFILE_MOVE_GENERATION)
+    *result = profile;
+    return true;
+#else
+    memset(result, 0, sizeof(MoveGenerationProfile));
+    return false;
+#endif
+}
+
+void resetMoveGenerationProfile() {
+#if defined(CHESS_ENGINE_PROFILE_MOVE_GENERATION)
+    memset(&profile, 0, sizeof(MoveGenerationProfile));
+#endif
+}
+
+const char* moveGenerationPhaseName(MoveGenerationPhase phase) {
+    static const char* names[NB_MOVE_GENERATION_PHASES] = {
+        "calculateAttackSquares",
+        "generateKingMoves",
+        "handlePinsAndChecksFromSlidingPieces",
+        "generateSupportingPiecesMoves"
+    };
+    return phase >= 0 && phase < NB_MOVE_GENERATION_PHASES ? names[phase] : "unknown";
+}
@@ -0,0 +1,91 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../state/GameState.h"
+
+/*
+The network is a HalfKP network: 
+    (40960 -> 256) x 2 -> 32 -> 32 -> 1
+
+A feature is a (king square, non king piece, piece square) triple, seen from the point of view of one side.
+There is one accumulator per side, which holds the output of the first layer for that side.
+Since a move only changes a few features, the accumulators are updated with the deltas recorded
+by makeMove in GameState.dirtyPieces, instead of being recomputed from the whole board.
+
+The network file format (all values are little endian):
+    char     magic[4]                    "CNUE"
+    uint32_t version                     1
+    uint32_t featureDimensions           40960
+    uint32_t halfDimensions              256
+    uint32_t hidden1Dimensions           32
+    uint32_t hidden2Dimensions           32
+    uint32_t reserved[2]
+    int16_t  featureBiases[256]
+    int16_t  featureWeights[40960][256]
+    int32_t  hidden1Biases[32]
+    int8_t   hidden1Weights[32][512]
+    int32_t  hidden2Biases[32]
+    int8_t   hidden2Weights[32][32]
+    int32_t  outputBias
+    int8_t   outputWeights[32]
+*/
+#define NNUE_FEATURE_DIMENSIONS (64 * 10 * 64)
+#define NNUE_HALF_DIMENSIONS 256
+#define NNUE_HIDDEN1_DIMENSIONS 32
+#define NNUE_HIDDEN2_DIMENSIONS 32
+
+/**
+ * The first layer output for both sides.
+ * values[0] is from white's point of view and values[1] from black's point of view
+*/
+typedef struct NnueAccumulator {
+    _Alignas(64) int16_t values[2][NNUE_HALF_DIMENSIONS];
+} NnueAccumulator;
+
+/**
+ * Memory maps the network file at `path`, replacing the previously loaded network.
+ * Returns false if the file does not exist, does not have the expected format or if a search holds the network.
+ * The previous network is kept when it fails
+*/
+bool nnueLoadNetwork(const char* path);
+
+/**
+ * Returns false, and keeps the network, if a search holds it
+*/
+bool nnueUnloadNetwork();
+bool nnueIsNetworkLoaded();
+
+/**
+ * A search holds the network from its start to its end, so that it is not unmapped while the search reads it.
+ * Every call to nnueHoldNetwork needs a call to nnueReleaseNetwork
+*/
+void nnueHoldNetwork();
+void nnueReleaseNetwork();
+
+/**
+ * Computes both halves of the accumulator from the whole board
+*/
+void nnueRefreshAccumulator(NnueAccumulator* accumulator, const GameState* state);
+
+/**
+ * Computes the accumulator of `state` from the accumulator of the position before the last move.
+ * Only the pieces in `state->dirtyPieces` are added or substracted, except for the side whose king moved,
+ * which needs to be refreshed since every one of its features depends on the king square.
+ * `accumulator` and `previous` can point to the same accumulator.
+*/
+void nnueUpdateAccumulator(NnueAccumulator* accumulator, const NnueAccumulator* previous, const GameState* state);
+
+/**
+ * Returns the evaluation of the network in centipawns, from the point of view of the side to move
+*/
+int nnueEvaluate(const NnueAccumulator* accumulator, PieceCharacteristics colorToGo);
+
+/**
+ * Evaluates the position without an existing accumulator.
+ * This is slow, use the incremental functions while searching
+*/
+int nnueEvaluatePosition(const GameState* state);
+
+#endif
@@ -0,0 +1,394 @@
+#include <string.h>
+#include <stdatomic.h>
+#include "Nnue.h"
+#include "../evaluation/Evaluation.h"
+#include "../utils/MappedFile.h"
+
+// The kernels are picked at compile time, compile with -march=native (or the CHESS_ENGINE_NATIVE cmake option) to get the best ones
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NNUE_USE_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NNUE_USE_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define NNUE_USE_SSSE3
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NNUE_USE_NEON
+#endif
+
+#define NNUE_MAGIC "CNUE"
+#define NNUE_VERSION 1
+#define NNUE_HEADER_SIZE 32
+// The hidden layers are quantized with 6 bits of precision
+#define NNUE_WEIGHT_SCALE_BITS 6
+// Converts the output of the network to centipawns
+#define NNUE_OUTPUT_SCALE 16
+
+typedef struct Network {
+    MappedFile file;
+    // All of these pointers point directly inside the mapped file
+    const int16_t* featureBiases;
+    const int16_t* featureWeights;
+    const int32_t* hidden1Biases;
+    const int8_t* hidden1Weights;
+    const int32_t* hidden2Biases;
+    const int8_t* hidden2Weights;
+    int32_t outputBias;
+    const int8_t* outputWeights;
+} Network;
+
+static Network network;
+static atomic_bool isNetworkLoaded = false;
+// Number of searches holding the network, -1 while it is being replaced or unloaded
+static atomic_int networkHolders = 0;
+
+// Indexed with the piece type: NOPIECE, KING, KNIGHT, BISHOP, QUEEN, ROOK, PAWN
+// The kings are not features in HalfKP, their position is part of every other feature
+static const int featureKindFromPieceType[7] = { -1, -1, 1, 2, 4, 3, 0 };
+
+/* ---------------------------------------- Kernels ---------------------------------------- */
+
+static inline void addFeatureWeights(int16_t* values, const int16_t* weights) {
+#if defined(NNUE_USE_AVX2)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+        __m256i value = _mm256_loadu_si256((const __m256i*) &values[i]);
+        __m256i weight = _mm256_loadu_si256((const __m256i*) &weights[i]);
+        _mm256_storeu_si256((__m256i*) &values[i], _mm256_add_epi16(value, weight));
+    }
+#elif defined(NNUE_USE_SSE2)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        __m128i value = _mm_loadu_si128((const __m128i*) &values[i]);
+        __m128i weight = _mm_loadu_si128((const __m128i*) &weights[i]);
+        _mm_storeu_si128((__m128i*) &values[i], _mm_add_epi16(value, weight));
+    }
+#elif defined(NNUE_USE_NEON)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        vst1q_s16(&values[i], vaddq_s16(vld1q_s16(&values[i]), vld1q_s16(&weights[i])));
+    }
+#else
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i++) {
+        values[i] += weights[i];
+    }
+#endif
+}
+
+static inline void substractFeatureWeights(int16_t* values, const int16_t* weights) {
+#if defined(NNUE_USE_AVX2)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+        __m256i value = _mm256_loadu_si256((const __m256i*) &values[i]);
+        __m256i weight = _mm256_loadu_si256((const __m256i*) &weights[i]);
+        _mm256_storeu_si256((__m256i*) &values[i], _mm256_sub_epi16(value, weight));
+    }
+#elif defined(NNUE_USE_SSE2)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        __m128i value = _mm_loadu_si128((const __m128i*) &values[i]);
+        __m128i weight = _mm_loadu_si128((const __m128i*) &weights[i]);
+        _mm_storeu_si128((__m128i*) &values[i], _mm_sub_epi16(value, weight));
+    }
+#elif defined(NNUE_USE_NEON)
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+        vst1q_s16(&values[i], vsubq_s16(vld1q_s16(&values[i]), vld1q_s16(&weights[i])));
+    }
+#else
+    for (int i = 0; i < NNUE_HALF_DIMENSIONS; i++) {
+        values[i] -= weights[i];
+    }
+#endif
+}
+
+/**
+ * Clamps the accumulator values between 0 and 127 and converts them to bytes.
+ * `size` needs to be a multiple of 32
+*/
+static inline void clippedReLU(const int16_t* input, uint8_t* output, int size) {
+#if defined(NNUE_USE_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < size; i += 32) {
+        __m256i first = _mm256_max_epi16(_mm256_loadu_si256((const __m256i*) &input[i]), zero);
+        __m256i second = _mm256_max_epi16(_mm256_loadu_si256((const __m256i*) &input[i + 16]), zero);
+        // packs saturates to 127 and works on 128 bits lanes, so the 64 bits blocks need to be put back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(first, second), 0b11011000);
+        _mm256_storeu_si256((__m256i*) &output[i], packed);
+    }
+#elif defined(NNUE_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < size; i += 16) {
+        __m128i first = _mm_max_epi16(_mm_loadu_si128((const __m128i*) &input[i]), zero);
+        __m128i second = _mm_max_epi16(_mm_loadu_si128((const __m128i*) &input[i + 8]), zero);
+        _mm_storeu_si128((__m128i*) &output[i], _mm_packs_epi16(first, second));
+    }
+#elif defined(NNUE_USE_NEON)
+    const int16x8_t zero = vdupq_n_s16(0);
+    for (int i = 0; i < size; i += 16) {
+        int8x8_t first = vqmovn_s16(vmaxq_s16(vld1q_s16(&input[i]), zero));
+        int8x8_t second = vqmovn_s16(vmaxq_s16(vld1q_s16(&input[i + 8]), zero));
+        vst1q_s8((int8_t*) &output[i], vcombine_s8(first, second));
+    }
+#else
+    for (int i = 0; i < size; i++) {
+        int16_t value = input[i];
+        output[i] = (uint8_t) (value < 0 ? 0 : (value > 127 ? 127 : value));
+    }
+#endif
+}
+
+/**
+ * Dot product between the clipped (0 to 127) inputs and the weights of one neuron.
+ * `size` needs to be a multiple of 32
+*/
+static inline int32_t dotProduct(const uint8_t* input, const int8_t* weights, int size) {
+#if defined(NNUE_USE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < size; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*) &input[i]);
+        __m256i weight = _mm256_loadu_si256((const __m256i*) &weights[i]);
+        // The products of two pairs cannot saturate since the inputs are at most 127
+        __m256i product = _mm256_maddubs_epi16(in, weight);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(product, ones));
+    }
+    __m128i result = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    result = _mm_add_epi32(result, _mm_shuffle_epi32(result, 0b01001110));
+    result = _mm_add_epi32(result, _mm_shuffle_epi32(result, 0b10110001));
+    return _mm_cvtsi128_si32(result);
+#elif defined(NNUE_USE_SSSE3)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < size; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) &input[i]);
+        __m128i weight = _mm_loadu_si128((const __m128i*) &weights[i]);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, weight), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+    return _mm_cvtsi128_si32(sum);
+#elif defined(NNUE_USE_NEON)
+    int32x4_t sum = vdupq_n_s32(0);
+    for (int i = 0; i < size; i += 16) {
+        // The inputs are between 0 and 127, so they can be read as signed bytes
+        int8x16_t in = vld1q_s8((const int8_t*) &input[i]);
+        int8x16_t weight = vld1q_s8(&weights[i]);
+        sum = vpadalq_s16(sum, vmull_s8(vget_low_s8(in), vget_low_s8(weight)));
+        sum = vpadalq_s16(sum, vmull_s8(vget_high_s8(in), vget_high_s8(weight)));
+    }
+    return vaddvq_s32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < size; i++) {
+        sum += (int32_t) input[i] * (int32_t) weights[i];
+    }
+    return sum;
+#endif
+}
+
+/* ---------------------------------------- Network ---------------------------------------- */
+
+static uint32_t readUint32(const unsigned char* data) {
+    uint32_t result;
+    memcpy(&result, data, sizeof(uint32_t));
+    return result;
+}
+
+static size_t expectedNetworkFileSize() {
+    return NNUE_HEADER_SIZE +
+        sizeof(int16_t) * NNUE_HALF_DIMENSIONS +
+        sizeof(int16_t) * NNUE_FEATURE_DIMENSIONS * NNUE_HALF_DIMENSIONS +
+        sizeof(int32_t) * NNUE_HIDDEN1_DIMENSIONS +
+        sizeof(int8_t) * NNUE_HIDDEN1_DIMENSIONS * 2 * NNUE_HALF_DIMENSIONS +
+        sizeof(int32_t) * NNUE_HIDDEN2_DIMENSIONS +
+        sizeof(int8_t) * NNUE_HIDDEN2_DIMENSIONS * NNUE_HIDDEN1_DIMENSIONS +
+        sizeof(int32_t) +
+        sizeof(int8_t) * NNUE_HIDDEN2_DIMENSIONS;
+}
+
+bool nnueLoadNetwork(const char* path) {
+    MappedFile file;
+    if (!mapFile(path, &file)) { return false; }
+
+    const unsigned char* data = file.data;
+    if (file.size != expectedNetworkFileSize() ||
+        memcmp(data, NNUE_MAGIC, 4) != 0 ||
+        readUint32(data + 4) != NNUE_VERSION ||
+        readUint32(data + 8) != NNUE_FEATURE_DIMENSIONS ||
+        readUint32(data + 12) != NNUE_HALF_DIMENSIONS ||
+        readUint32(data + 16) != NNUE_HIDDEN1_DIMENSIONS ||
+        readUint32(data + 20) != NNUE_HIDDEN2_DIMENSIONS) {
+        unmapFile(&file);
+        return false;
+    }
+
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&networkHolders, &expected, -1)) {
+        unmapFile(&file);
+        return false;
+    }
+    if (atomic_load(&isNetworkLoaded)) { unmapFile(&network.file); }
+    network.file = file;
+    // Every section starts at an offset which is a multiple of its element size, so the casts are aligned
+    const unsigned char* current = data + NNUE_HEADER_SIZE;
+    network.featureBiases = (const int16_t*) current;
+    current += sizeof(int16_t) * NNUE_HALF_DIMENSIONS;
+    network.featureWeights = (const int16_t*) current;
+    current += sizeof(int16_t) * NNUE_FEATURE_DIMENSIONS * NNUE_HALF_DIMENSIONS;
+    network.hidden1Biases = (const int32_t*) current;
+    current += sizeof(int32_t) * NNUE_HIDDEN1_DIMENSIONS;
+    network.hidden1Weights = (const int8_t*) current;
+    current += sizeof(int8_t) * NNUE_HIDDEN1_DIMENSIONS * 2 * NNUE_HALF_DIMENSIONS;
+    network.hidden2Biases = (const int32_t*) current;
+    current += sizeof(int32_t) * NNUE_HIDDEN2_DIMENSIONS;
+    network.hidden2Weights = (const int8_t*) current;
+    current += sizeof(int8_t) * NNUE_HIDDEN2_DIMENSIONS * NNUE_HIDDEN1_DIMENSIONS;
+    network.outputBias = (int32_t) readUint32(current);
+    current += sizeof(int32_t);
+    network.outputWeights = (const int8_t*) current;
+
+    atomic_store(&isNetworkLoaded, true);
+    atomic_store(&networkHolders, 0);
+    return true;
+}
+
+bool nnueUnloadNetwork() {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&networkHolders, &expected, -1)) { return false; }
+    if (atomic_load(&isNetworkLoaded)) {
+        unmapFile(&network.file);
+        memset(&network, 0, sizeof(Network));
+        atomic_store(&isNetworkLoaded, false);
+    }
+    atomic_store(&networkHolders, 0);
+    return true;
+}
+
+bool nnueIsNetworkLoaded() {
+    return atomic_load(&isNetworkLoaded);
+}
+
+void nnueHoldNetwork() {
+    int holders = atomic_load(&networkHolders);
+    // The network is only swapped for the time of a few assignments, so waiting for it is short
+    while (holders < 0 || !atomic_compare_exchange_weak(&networkHolders, &holders, holders + 1)) {
+        if (holders < 0) { holders = atomic_load(&networkHolders); }
+    }
+}
+
+void nnueReleaseNetwork() {
+    atomic_fetch_sub(&networkHolders, 1);
+}
+
+/* ---------------------------------------- Accumulator ---------------------------------------- */
+
+static inline const int16_t* featureWeights(int perspective, int kingIndex, Piece piece, int index) {
+    // Each side sees the board from its own side, so black's features are flipped vertically
+    int flip = perspective == 0 ? 0 : 56;
+    int kind = featureKindFromPieceType[pieceType(piece)];
+    if ((pieceColor(piece) == WHITE) != (perspective == 0)) {
+        kind += 5; // Opponent pieces come after the friendly pieces
+    }
+    int feature = ((kingIndex ^ flip) * 10 + kind) * 64 + (index ^ flip);
+    return network.featureWeights + (size_t) feature * NNUE_HALF_DIMENSIONS;
+}
+
+static void refreshPerspective(int16_t* values, const GameState* state, int perspective) {
+    memcpy(values, network.featureBiases, sizeof(int16_t) * NNUE_HALF_DIMENSIONS);
+
+    PieceCharacteristics perspectiveColor = perspective == 0 ? WHITE : BLACK;
+    int kingIndex = trailingZeros_64(bitBoardForPiece(state->board, makePiece(perspectiveColor, KING)));
+
+    const PieceCharacteristics colors[2] = { WHITE, BLACK };
+    const PieceCharacteristics types[5] = { KNIGHT, BISHOP, QUEEN, ROOK, PAWN };
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 5; j++) {
+            Piece piece = makePiece(colors[i], types[j]);
+            u64 bitboard = bitBoardForPiece(state->board, piece);
+            while (bitboard) {
+                int index = trailingZeros_64(bitboard);
+                addFeatureWeights(values, featureWeights(perspective, kingIndex, piece, index));
+                bitboard &= bitboard - 1;
+            }
+        }
+    }
+}
+
+void nnueRefreshAccumulator(NnueAccumulator* accumulator, const GameState* state) {
+    if (!isNetworkLoaded) { return; }
+    refreshPerspective(accumulator->values[0], state, 0);
+    refreshPerspective(accumulator->values[1], state, 1);
+}
+
+void nnueUpdateAccumulator(NnueAccumulator* accumulator, const NnueAccumulator* previous, const GameState* state) {
+    if (!isNetworkLoaded) { return; }
+    const DirtyPieces* dirtyPieces = &state->dirtyPieces;
+
+    for (int perspective = 0; perspective < 2; perspective++) {
+        Piece perspectiveKing = makePiece(perspective == 0 ? WHITE : BLACK, KING);
+
+        bool kingMoved = false;
+        for (int i = 0; i < dirtyPieces->nbDirtyPieces; i++) {
+            if (dirtyPieces->pieces[i] == perspectiveKing) { kingMoved = true; }
+        }
+        if (kingMoved) {
+            refreshPerspective(accumulator->values[perspective], state, perspective);
+            continue;
+        }
+
+        int16_t* values = accumulator->values[perspective];
+        if (accumulator != previous) {
+            memcpy(values, previous->values[perspective], sizeof(int16_t) * NNUE_HALF_DIMENSIONS);
+        }
+        int kingIndex = trailingZeros_64(bitBoardForPiece(state->board, perspectiveKing));
+        for (int i = 0; i < dirtyPieces->nbDirtyPieces; i++) {
+            Piece piece = dirtyPieces->pieces[i];
+            if (pieceType(piece) == KING) { continue; } // The opponent king is not a feature
+
+            const int16_t* weights = featureWeights(perspective, kingIndex, piece, dirtyPieces->indices[i]);
+            if (dirtyPieces->added[i]) {
+                addFeatureWeights(values, weights);
+            } else {
+                substractFeatureWeights(values, weights);
+            }
+        }
+    }
+}
+
+/* ---------------------------------------- Evaluation ---------------------------------------- */
+
+static inline uint8_t clampHiddenNeuron(int32_t value) {
+    value >>= NNUE_WEIGHT_SCALE_BITS;
+    return (uint8_t) (value < 0 ? 0 : (value > 127 ? 127 : value));
+}
+
+int nnueEvaluate(const NnueAccumulator* accumulator, PieceCharacteristics colorToGo) {
+    if (!isNetworkLoaded) { return 0; }
+    _Alignas(64) uint8_t input[2 * NNUE_HALF_DIMENSIONS];
+    _Alignas(64) uint8_t hidden1[NNUE_HIDDEN1_DIMENSIONS];
+    _Alignas(64) uint8_t hidden2[NNUE_HIDDEN2_DIMENSIONS];
+
+    // The side to move accumulator always comes first
+    int us = colorToGo == WHITE ? 0 : 1;
+    clippedReLU(accumulator->values[us], input, NNUE_HALF_DIMENSIONS);
+    clippedReLU(accumulator->values[1 - us], input + NNUE_HALF_DIMENSIONS, NNUE_HALF_DIMENSIONS);
+
+    for (int i = 0; i < NNUE_HIDDEN1_DIMENSIONS; i++) {
+        const int8_t* weights = network.hidden1Weights + i * 2 * NNUE_HALF_DIMENSIONS;
+        hidden1[i] = clampHiddenNeuron(network.hidden1Biases[i] + dotProduct(input, weights, 2 * NNUE_HALF_DIMENSIONS));
+    }
+    for (int i = 0; i < NNUE_HIDDEN2_DIMENSIONS; i++) {
+        const int8_t* weights = network.hidden2Weights + i * NNUE_HIDDEN1_DIMENSIONS;
+        hidden2[i] = clampHiddenNeuron(network.hidden2Biases[i] + dotProduct(hidden1, weights, NNUE_HIDDEN1_DIMENSIONS));
+    }
+    int32_t output = network.outputBias + dotProduct(hidden2, network.outputWeights, NNUE_HIDDEN2_DIMENSIONS);
+    return output / NNUE_OUTPUT_SCALE;
+}
+
+int nnueEvaluatePosition(const GameState* state) {
+    if (!isNetworkLoaded) {
+        return evaluate(state, NULL); // Falling back to the hand crafted evaluation
+    }
+    NnueAccumulator accumulator;
+    nnueRefreshAccumulator(&accumulator, state);
+    return nnueEvaluate(&accumulator, state->colorToGo);
+}
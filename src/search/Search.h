@@ -0,0 +1,104 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+#include "TranspositionTable.h"
+
+#define MAX_PLY 128
+#define MATE_SCORE 31000
+#define INFINITE_SCORE 32000
+// Score of a position that the tablebases say is won, minus the ply where it was found, below every mate score
+#define TABLEBASE_WIN_SCORE (MATE_SCORE - 2 * MAX_PLY)
+
+/**
+ * Returns true if the score means that one side is getting mated
+*/
+bool isMateScore(int score);
+
+/**
+ * The selective search techniques, each one can be turned off to measure its effect
+*/
+typedef struct SearchFeatures {
+    bool nullMovePruning; // Skipping a turn and seeing if the opponent still cannot get back below beta
+    bool lateMoveReductions; // Searching the quiet moves that are late in the move ordering with a reduced depth
+    bool reverseFutilityPruning; // Cutting the node when the static evaluation is way above beta
+    bool lateMovePruning; // Not searching the last quiet moves at low depths
+} SearchFeatures;
+
+/**
+ * Returns the features used by default, which is all of them
+*/
+SearchFeatures defaultSearchFeatures();
+
+/**
+ * Every limit set to 0 is ignored, the search stops as soon as one of the others is reached.
+ * The times are in milliseconds, the clock values are the ones of the side to move
+*/
+typedef struct SearchLimits {
+    int depth;
+    u64 nodes; // The nodes of every thread together, checked every few hundred nodes with several threads
+    int moveTime;
+    int timeLeft;
+    int increment;
+    int movesToGo;
+    atomic_bool* stop; // Can be NULL, another thread sets it to true to stop the search
+    // Can be NULL. While it is true the time limits are ignored, another thread sets it to false on ponderhit
+    // and the clock starts from there
+    atomic_bool* ponder;
+} SearchLimits;
+
+typedef struct SearchResult {
+    int multiPv; // The rank of this line, starting at 1 for the best one
+    Move bestMove; // 0 if there is no legal move in the position
+    int score; // From the point of view of the side to move, in centipawns
+    int depth; // The last depth that was fully searched
+    int selectiveDepth;
+    u64 nodes;
+    u64 tablebaseHits;
+    u64 time; // In milliseconds
+    u64 nodesPerSecond;
+    int principalVariationLength;
+    Move principalVariation[MAX_PLY];
+} SearchResult;
+
+/**
+ * Called by the search after every completed iteration, `nodes` and `time` are the ones of the whole search so far.
+ * With several lines, it is called once per line, from the best to the worst
+*/
+typedef void (*SearchIterationCallback)(const SearchResult* result, void* userData);
+
+typedef struct SearchOptions {
+    SearchFeatures features;
+    int nbThreads; // The threads share the transposition table, only the main one reports iterations
+    // The number of best moves to find, each one with its own principal variation (capped to the number of legal moves)
+    int multiPv;
+    SearchIterationCallback onIteration; // Can be NULL
+    void* userData; // Given back to onIteration
+} SearchOptions;
+
+/**
+ * Returns the default features, one thread, one line and no callback
+*/
+SearchOptions defaultSearchOptions();
+
+/**
+ * Searches the position with iterative deepening until one of the limits is reached.
+ * `previousStates` follows the same convention as getValidMoves (0 terminated array, can be NULL)
+ * and is used to detect draws by repetition.
+ * When the Syzygy tables (see syzygyInitialize) have the root position, only the moves that keep its outcome are
+ * searched. Otherwise the tables, then the generated endgame tables (see endgameTablesInitialize), are probed in the
+ * search after captures and pawn moves.
+ * `magicBitBoardInitialize` needs to be called before searching
+*/
+SearchResult searchPosition(
+    const GameState* rootState, 
+    const GameState* previousStates, 
+    SearchLimits limits, 
+    SearchOptions options, 
+    TranspositionTable* table
+);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <stdbool.h>
+#include "../state/Move.h"
+
+// Time lost between the engine sending its move and the clock being stopped, in milliseconds
+#define MOVE_OVERHEAD 10
+
+/**
+ * How much time the search can spend on the current move.
+ * The soft limit is checked between iterations, it grows when the best move keeps changing.
+ * The hard limit is checked inside the search and is never exceeded
+*/
+typedef struct TimeManager {
+    u64 startTime; // In nanoseconds, from a monotonic clock
+    u64 softLimit; // In milliseconds, 0 means no limit
+    u64 hardLimit; // In milliseconds, 0 means no limit
+    double bestMoveInstability; // Decaying count of the best move changes between iterations
+} TimeManager;
+
+/**
+ * Returns the current time of a monotonic clock, in nanoseconds
+*/
+u64 currentTimeNanoseconds();
+
+/**
+ * `timeLeft`, `increment` and `movesToGo` are the clock of the side to move, `moveTime` is a fixed time for the move.
+ * Every value is in milliseconds and 0 means that it is not set. `moveTime` takes priority over the clock
+*/
+void startTimeManager(TimeManager* manager, int moveTime, int timeLeft, int increment, int movesToGo);
+
+u64 elapsedMilliseconds(const TimeManager* manager);
+
+bool isHardLimitReached(const TimeManager* manager);
+
+/**
+ * Called after every completed iteration, returns true if the next one should not be started
+*/
+bool shouldStopIterating(TimeManager* manager, bool bestMoveChanged);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/Move.h"
+
+typedef enum {
+    BOUND_NONE,
+    BOUND_UPPER, // The search failed low, the score is at most this value
+    BOUND_LOWER, // The search failed high, the score is at least this value
+    BOUND_EXACT
+} Bound;
+
+typedef struct TranspositionData {
+    Move move;
+    short score;
+    short staticEvaluation;
+    unsigned char depth;
+    unsigned char bound;
+    unsigned char generation;
+} TranspositionData;
+
+/**
+ * An entry is the packed data plus the key xor'ed with the data.
+ * Threads can write to the same entry at the same time without locks: a torn entry has a checksum which
+ * does not match its key anymore, so it is simply treated as a miss.
+*/
+typedef struct TranspositionEntry {
+    u64 checksum;
+    u64 data;
+} TranspositionEntry;
+
+#define TRANSPOSITION_BUCKET_SIZE 2
+
+/**
+ * The table is shared between every searching thread.
+ * Each bucket holds a depth-preferred entry and an always-replace entry
+*/
+typedef struct TranspositionTable {
+    TranspositionEntry* entries;
+    size_t nbBuckets;
+    unsigned char generation;
+} TranspositionTable;
+
+TranspositionTable* createTranspositionTable(size_t megabytes);
+void resizeTranspositionTable(TranspositionTable* table, size_t megabytes);
+void clearTranspositionTable(TranspositionTable* table);
+void freeTranspositionTable(TranspositionTable* table);
+
+/**
+ * Must be called before every new search, so that the old entries get replaced first
+*/
+void newTranspositionTableSearch(TranspositionTable* table);
+
+bool probeTranspositionTable(const TranspositionTable* table, u64 key, TranspositionData* result);
+void storeInTranspositionTable(TranspositionTable* table, u64 key, Move move, int score, int staticEvaluation, int depth, Bound bound);
+
+/**
+ * Returns the per mille of the table used by the current search, like the UCI hashfull info
+*/
+int transpositionTableHashFull(const TranspositionTable* table);
+
+#endif
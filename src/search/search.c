@@ -0,0 +1,829 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "Search.h"
+#include "TimeManager.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../state/Zobrist.h"
+#include "../evaluation/Evaluation.h"
+#include "../nnue/Nnue.h"
+#include "../tablebase/Syzygy.h"
+#include "../tablebase/EndgameTable.h"
+
+#define PAWN_HASH_TABLE_ENTRIES (1 << 14)
+#define MAX_HISTORY_SCORE 16384
+// The stop flag and the clock are only checked every this many nodes (a power of 2).
+// At a few hundred thousand nodes per second, a stop is noticed in well under a millisecond
+#define STOP_CHECK_INTERVAL 64
+#define THREADS_NODES_CHECK_INTERVAL 256 // How often the main thread adds up the nodes of the other threads
+
+// Move ordering scores, the higher the earlier the move is searched
+#define TRANSPOSITION_MOVE_SCORE 1000000
+#define CAPTURE_SCORE 100000
+#define PROMOTION_SCORE 95000
+#define FIRST_KILLER_SCORE 90000
+#define SECOND_KILLER_SCORE 89000
+
+// Indexed with the piece type: NOPIECE, KING, KNIGHT, BISHOP, QUEEN, ROOK, PAWN
+static const int moveOrderingPieceValues[7] = { 0, 20, 3, 3, 9, 5, 1 };
+
+typedef struct SearchStack {
+    GameState state;
+    Move killers[2];
+    int staticEvaluation;
+} SearchStack;
+
+/**
+ * Everything a thread needs to search a position.
+ * Nothing in here is shared, except the transposition table
+*/
+typedef struct SearchWorker {
+    SearchStack stack[MAX_PLY + 1];
+    NnueAccumulator* accumulators; // One per ply, NULL if no network is loaded
+
+    // The keys of the game before the root, followed by the keys of the positions in the current search path
+    u64* keys;
+    int nbGameKeys;
+
+    int history[2][BOARD_SIZE][BOARD_SIZE]; // Indexed with [colorToGo == BLACK][from][to]
+    Move principalVariation[MAX_PLY + 1][MAX_PLY + 1];
+    int principalVariationLength[MAX_PLY + 1];
+
+    PawnHashTable* pawnHashTable;
+    TranspositionTable* table;
+    SearchFeatures features;
+    SearchLimits limits;
+    TimeManager timeManager; // Only started on ponderhit when pondering
+    bool isPondering;
+    u64 startTime; // In nanoseconds, used to report the time of the whole search
+
+    // The moves of the root that keep the tablebase outcome, only these are searched when there are some
+    Move rootMoves[MAX_LEGAL_MOVES + 1];
+    int nbRootMoves;
+    bool probeTablebases; // Not needed when the root is already in the tables
+
+    // With several lines, the best moves of the lines already searched at this depth are skipped at the root
+    Move excludedRootMoves[MAX_LEGAL_MOVES];
+    int nbExcludedRootMoves;
+
+    // Every worker of the search, the node limit is checked against the nodes of all of them
+    struct SearchWorker** workers;
+    int nbWorkers;
+
+    _Atomic u64 nodes; // Only written by the worker's thread, the main thread reads it to report the total
+    _Atomic u64 tablebaseHits; // Same as nodes
+    int selectiveDepth;
+    bool canStop; // The first iteration always completes, so that there is a move to play
+    bool stopped;
+} SearchWorker;
+
+static int lateMoveReductions[64][64];
+// Several searches can start at the same time on different threads (self-play for example)
+static pthread_once_t lateMoveReductionsOnce = PTHREAD_ONCE_INIT;
+
+static void initializeLateMoveReductions() {
+    for (int depth = 1; depth < 64; depth++) {
+        for (int moveIndex = 1; moveIndex < 64; moveIndex++) {
+            lateMoveReductions[depth][moveIndex] = (int) (0.75 + log(depth) * log(moveIndex) / 2.25);
+        }
+    }
+}
+
+bool isMateScore(int score) {
+    return score > MATE_SCORE - MAX_PLY || score < -MATE_SCORE + MAX_PLY;
+}
+
+SearchFeatures defaultSearchFeatures() {
+    SearchFeatures features = {
+        .nullMovePruning = true,
+        .lateMoveReductions = true,
+        .reverseFutilityPruning = true,
+        .lateMovePruning = true
+    };
+    return features;
+}
+
+/**
+ * Outcome of the position for the side to move when the fifty move counter was just reset: 1 for a win, 0 for a draw
+ * and -1 for a loss. The Syzygy tables are asked first, where cursed wins and blessed losses are draws.
+ * The generated endgame tables do not know the fifty move rule, so their wins and losses only count when the mate
+ * comes within fifty moves, otherwise the position is left to the search
+*/
+static bool probeTablebaseOutcome(const GameState* state, int* outcome) {
+    SyzygyWdl syzygyWdl;
+    if (syzygyProbeWdl(state, &syzygyWdl)) {
+        *outcome = syzygyWdl == SYZYGY_LOSS ? -1 : (syzygyWdl == SYZYGY_WIN ? 1 : 0);
+        return true;
+    }
+    EndgameProbe probe;
+    if (!probeEndgameTables(state, &probe)) { return false; }
+    if (probe.wdl != ENDGAME_DRAW && probe.movesToMate > 50) { return false; }
+    *outcome = probe.wdl == ENDGAME_LOSS ? -1 : (probe.wdl == ENDGAME_WIN ? 1 : 0);
+    return true;
+}
+
+// Mate and tablebase scores are stored relative to the node in the transposition table, and relative to the root in the search
+static int scoreToTranspositionTable(int score, int ply) {
+    if (score > TABLEBASE_WIN_SCORE - MAX_PLY) { return score + ply; }
+    if (score < -TABLEBASE_WIN_SCORE + MAX_PLY) { return score - ply; }
+    return score;
+}
+
+static int scoreFromTranspositionTable(int score, int ply) {
+    if (score > TABLEBASE_WIN_SCORE - MAX_PLY) { return score - ply; }
+    if (score < -TABLEBASE_WIN_SCORE + MAX_PLY) { return score + ply; }
+    return score;
+}
+
+static u64 nodesSearched(SearchWorker* worker) {
+    return atomic_load_explicit(&worker->nodes, memory_order_relaxed);
+}
+
+static u64 threadsNodes(SearchWorker** workers, int nbThreads) {
+    u64 nodes = 0;
+    for (int i = 0; i < nbThreads; i++) {
+        nodes += nodesSearched(workers[i]);
+    }
+    return nodes;
+}
+
+// Not an atomic increment: there is only one writer, the atomic type just makes the reads from other threads safe
+static void countNode(SearchWorker* worker) {
+    atomic_store_explicit(&worker->nodes, nodesSearched(worker) + 1, memory_order_relaxed);
+}
+
+/**
+ * On ponderhit, the search keeps going as the real search: everything it did so far is kept and the clock starts now
+*/
+static void updatePonderState(SearchWorker* worker) {
+    if (worker->isPondering && !atomic_load_explicit(worker->limits.ponder, memory_order_relaxed)) {
+        worker->isPondering = false;
+        SearchLimits limits = worker->limits;
+        startTimeManager(&worker->timeManager, limits.moveTime, limits.timeLeft, limits.increment, limits.movesToGo);
+    }
+}
+
+static bool shouldStop(SearchWorker* worker) {
+    if (worker->stopped) { return true; }
+    if (!worker->canStop) { return false; }
+    u64 nodes = nodesSearched(worker);
+    // The other threads are only looked at from time to time, the limit can be passed by that many nodes per thread
+    bool isNodeLimitChecked = worker->limits.nodes != 0 && (worker->nbWorkers == 1 || (nodes & (THREADS_NODES_CHECK_INTERVAL - 1)) == 0);
+    if (isNodeLimitChecked && threadsNodes(worker->workers, worker->nbWorkers) >= worker->limits.nodes) {
+        worker->stopped = true;
+    } else if ((nodes & (STOP_CHECK_INTERVAL - 1)) == 0) {
+        bool isStopRequested = worker->limits.stop != NULL && atomic_load_explicit(worker->limits.stop, memory_order_relaxed);
+        updatePonderState(worker);
+        worker->stopped = isStopRequested || isHardLimitReached(&worker->timeManager);
+    }
+    return worker->stopped;
+}
+
+static int staticEvaluation(SearchWorker* worker, int ply) {
+    GameState* state = &worker->stack[ply].state;
+    if (worker->accumulators != NULL) {
+        return nnueEvaluate(&worker->accumulators[ply], state->colorToGo);
+    }
+    return evaluate(state, worker->pawnHashTable);
+}
+
+/**
+ * Puts the state after `move` at `ply + 1` and updates everything that depends on it
+*/
+static void pushMove(SearchWorker* worker, int ply, Move move) {
+    GameState* child = &worker->stack[ply + 1].state;
+    *child = worker->stack[ply].state;
+    if (move) {
+        makeMove(move, child);
+    } else {
+        makeNullMove(child);
+    }
+    if (worker->accumulators != NULL) {
+        nnueUpdateAccumulator(&worker->accumulators[ply + 1], &worker->accumulators[ply], child);
+    }
+    worker->keys[worker->nbGameKeys + ply + 1] = child->zobristKey;
+}
+
+static bool isDraw(SearchWorker* worker, int ply) {
+    const GameState* state = &worker->stack[ply].state;
+    if (state->turnsForFiftyRule >= 100) { return true; }
+
+    // Only the positions since the last capture or pawn move can be repetitions
+    int current = worker->nbGameKeys + ply;
+    int limit = state->turnsForFiftyRule < current ? state->turnsForFiftyRule : current;
+    for (int i = 4; i <= limit; i += 2) {
+        if (worker->keys[current - i] == worker->keys[current]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool hasNonPawnMaterial(const GameState* state) {
+    PieceCharacteristics color = state->colorToGo;
+    return (bitBoardForPiece(state->board, makePiece(color, KNIGHT)) |
+            bitBoardForPiece(state->board, makePiece(color, BISHOP)) |
+            bitBoardForPiece(state->board, makePiece(color, ROOK)) |
+            bitBoardForPiece(state->board, makePiece(color, QUEEN))) != 0;
+}
+
+static bool isCapture(const GameState* state, Move move) {
+    return flagFromMove(move) == EN_PASSANT || pieceAtIndex(state->board, toSquareFromMove(move)) != NOPIECE;
+}
+
+static bool isPromotion(Move move) {
+    Flag flag = flagFromMove(move);
+    return flag >= PROMOTE_TO_QUEEN && flag <= PROMOTE_TO_BISHOP;
+}
+
+/**
+ * Returns true if getValidMoves returned one of the special moves that tells that the game is over
+*/
+static bool isGameOverMove(Move move) {
+    Flag flag = flagFromMove(move);
+    return flag == STALEMATE || flag == CHECKMATE || flag == DRAW;
+}
+
+static int* historyEntry(SearchWorker* worker, PieceCharacteristics color, Move move) {
+    return &worker->history[color == BLACK][(int) fromSquareFromMove(move)][(int) toSquareFromMove(move)];
+}
+
+static int scoreMove(SearchWorker* worker, int ply, Move move, Move transpositionMove) {
+    if (move == transpositionMove) { return TRANSPOSITION_MOVE_SCORE; }
+    const GameState* state = &worker->stack[ply].state;
+    int from = fromSquareFromMove(move);
+    int to = toSquareFromMove(move);
+
+    if (isCapture(state, move)) {
+        // Most valuable victim, least valuable attacker
+        PieceCharacteristics victim = flagFromMove(move) == EN_PASSANT ? PAWN : pieceType(pieceAtIndex(state->board, to));
+        PieceCharacteristics attacker = pieceType(pieceAtIndex(state->board, from));
+        return CAPTURE_SCORE + moveOrderingPieceValues[victim] * 100 - moveOrderingPieceValues[attacker];
+    }
+    if (flagFromMove(move) == PROMOTE_TO_QUEEN) { return PROMOTION_SCORE; }
+    if (move == worker->stack[ply].killers[0]) { return FIRST_KILLER_SCORE; }
+    if (move == worker->stack[ply].killers[1]) { return SECOND_KILLER_SCORE; }
+    return *historyEntry(worker, state->colorToGo, move);
+}
+
+/**
+ * Selection sort, one move at a time: the search often stops after the first few moves
+*/
+static Move pickNextMove(Move* moves, int* scores, int nbMoves, int index) {
+    int bestIndex = index;
+    for (int i = index + 1; i < nbMoves; i++) {
+        if (scores[i] > scores[bestIndex]) { bestIndex = i; }
+    }
+    Move move = moves[bestIndex];
+    int score = scores[bestIndex];
+    moves[bestIndex] = moves[index];
+    scores[bestIndex] = scores[index];
+    moves[index] = move;
+    scores[index] = score;
+    return move;
+}
+
+static void updateHistory(SearchWorker* worker, PieceCharacteristics color, Move move, int bonus) {
+    int* entry = historyEntry(worker, color, move);
+    // The entry moves towards the bonus, which keeps it between -MAX_HISTORY_SCORE and MAX_HISTORY_SCORE
+    *entry += bonus - *entry * abs(bonus) / MAX_HISTORY_SCORE;
+}
+
+static void removeExcludedRootMoves(SearchWorker* worker, Move* moves) {
+    int nbMoves = 0;
+    for (int i = 0; moves[i]; i++) {
+        bool isExcluded = false;
+        for (int j = 0; j < worker->nbExcludedRootMoves; j++) {
+            if (moves[i] == worker->excludedRootMoves[j]) { isExcluded = true; }
+        }
+        if (!isExcluded) { moves[nbMoves++] = moves[i]; }
+    }
+    moves[nbMoves] = 0;
+}
+
+static void updatePrincipalVariation(SearchWorker* worker, int ply, Move move) {
+    worker->principalVariation[ply][0] = move;
+    int childLength = worker->principalVariationLength[ply + 1];
+    memcpy(&worker->principalVariation[ply][1], worker->principalVariation[ply + 1], sizeof(Move) * childLength);
+    worker->principalVariationLength[ply] = childLength + 1;
+}
+
+static int quiescence(SearchWorker* worker, int alpha, int beta, int ply) {
+    worker->principalVariationLength[ply] = 0;
+    if (shouldStop(worker)) { return 0; }
+    countNode(worker);
+    if (ply > worker->selectiveDepth) { worker->selectiveDepth = ply; }
+
+    const GameState* state = &worker->stack[ply].state;
+    if (state->turnsForFiftyRule >= 100) { return 0; }
+    if (ply >= MAX_PLY) { return staticEvaluation(worker, ply); }
+
+    bool inCheck = isInCheck(*state);
+    int bestScore = -INFINITE_SCORE;
+    if (!inCheck) {
+        // Standing pat: the side to move does not have to capture
+        bestScore = staticEvaluation(worker, ply);
+        if (bestScore >= beta) { return bestScore; }
+        if (bestScore > alpha) { alpha = bestScore; }
+    }
+
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, *state, NULL);
+    if (isGameOverMove(moves[0])) {
+        return flagFromMove(moves[0]) == CHECKMATE ? -MATE_SCORE + ply : 0;
+    }
+
+    int scores[MAX_LEGAL_MOVES];
+    int nbMoves = 0;
+    while (moves[nbMoves]) {
+        scores[nbMoves] = scoreMove(worker, ply, moves[nbMoves], 0);
+        nbMoves++;
+    }
+
+    for (int i = 0; i < nbMoves; i++) {
+        Move move = pickNextMove(moves, scores, nbMoves, i);
+        // Every evasion is searched when in check, otherwise only the captures and queen promotions
+        if (!inCheck && !isCapture(state, move) && flagFromMove(move) != PROMOTE_TO_QUEEN) { continue; }
+
+        pushMove(worker, ply, move);
+        int score = -quiescence(worker, -beta, -alpha, ply + 1);
+        if (worker->stopped) { return 0; }
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePrincipalVariation(worker, ply, move);
+                if (alpha >= beta) { break; }
+            }
+        }
+    }
+    return bestScore;
+}
+
+static int alphaBeta(SearchWorker* worker, int alpha, int beta, int depth, int ply, bool canNullMove) {
+    worker->principalVariationLength[ply] = 0;
+    if (depth <= 0) { return quiescence(worker, alpha, beta, ply); }
+    if (shouldStop(worker)) { return 0; }
+    countNode(worker);
+
+    const bool isRoot = ply == 0;
+    const bool isPrincipalVariationNode = beta - alpha > 1;
+    GameState* state = &worker->stack[ply].state;
+    const int originalAlpha = alpha;
+
+    if (!isRoot) {
+        if (isDraw(worker, ply)) { return 0; }
+        if (ply >= MAX_PLY) { return staticEvaluation(worker, ply); }
+
+        // Mate distance pruning: even a mate in this node cannot beat a shorter mate found elsewhere
+        if (alpha < -MATE_SCORE + ply) { alpha = -MATE_SCORE + ply; }
+        if (beta > MATE_SCORE - ply - 1) { beta = MATE_SCORE - ply - 1; }
+        if (alpha >= beta) { return alpha; }
+    }
+
+    TranspositionData transposition;
+    bool hasTransposition = probeTranspositionTable(worker->table, state->zobristKey, &transposition);
+    Move transpositionMove = hasTransposition ? transposition.move : 0;
+    if (hasTransposition && !isPrincipalVariationNode && transposition.depth >= depth) {
+        int score = scoreFromTranspositionTable(transposition.score, ply);
+        if (transposition.bound == BOUND_EXACT ||
+            (transposition.bound == BOUND_LOWER && score >= beta) ||
+            (transposition.bound == BOUND_UPPER && score <= alpha)) {
+            return score;
+        }
+    }
+
+    // Right after a capture or a pawn move, the win/draw/loss tables know the result
+    if (!isRoot && worker->probeTablebases && state->turnsForFiftyRule == 0) {
+        int outcome;
+        if (probeTablebaseOutcome(state, &outcome)) {
+            u64 hits = atomic_load_explicit(&worker->tablebaseHits, memory_order_relaxed);
+            atomic_store_explicit(&worker->tablebaseHits, hits + 1, memory_order_relaxed);
+            int score = outcome < 0 ? -TABLEBASE_WIN_SCORE + ply : (outcome > 0 ? TABLEBASE_WIN_SCORE - ply : 0);
+            Bound bound = outcome < 0 ? BOUND_UPPER : (outcome > 0 ? BOUND_LOWER : BOUND_EXACT);
+            if (bound == BOUND_EXACT || (bound == BOUND_LOWER && score >= beta) || (bound == BOUND_UPPER && score <= alpha)) {
+                // The entry keeps the real static evaluation, the next visits use it for their pruning
+                int tablebaseEvaluation = isInCheck(*state) ? -INFINITE_SCORE : staticEvaluation(worker, ply);
+                storeInTranspositionTable(worker->table, state->zobristKey, 0, scoreToTranspositionTable(score, ply), tablebaseEvaluation, MAX_PLY - 1, bound);
+                return score;
+            }
+        }
+    }
+
+    bool inCheck = isInCheck(*state);
+    if (inCheck) {
+        depth++; // Check extension, so that the search does not stop in the middle of a forced sequence
+    }
+
+    int evaluation = -INFINITE_SCORE;
+    if (!inCheck) {
+        // The entries stored while in check have no static evaluation
+        bool hasStaticEvaluation = hasTransposition && transposition.staticEvaluation != -INFINITE_SCORE;
+        evaluation = hasStaticEvaluation ? transposition.staticEvaluation : staticEvaluation(worker, ply);
+    }
+    worker->stack[ply].staticEvaluation = evaluation;
+    worker->stack[ply + 1].killers[0] = 0;
+    worker->stack[ply + 1].killers[1] = 0;
+
+    if (!isPrincipalVariationNode && !inCheck && !isRoot) {
+        if (worker->features.reverseFutilityPruning &&
+            depth <= 6 &&
+            !isMateScore(beta) &&
+            evaluation - 80 * depth >= beta) {
+            return evaluation;
+        }
+
+        // A side that only has pawns could be in zugzwang, where passing would be better than every move
+        if (worker->features.nullMovePruning &&
+            canNullMove &&
+            depth >= 3 &&
+            evaluation >= beta &&
+            hasNonPawnMaterial(state)) {
+            int reduction = 3 + depth / 6;
+            pushMove(worker, ply, 0);
+            int score = -alphaBeta(worker, -beta, -beta + 1, depth - 1 - reduction, ply + 1, false);
+            if (worker->stopped) { return 0; }
+            if (score >= beta) {
+                return isMateScore(score) ? beta : score;
+            }
+        }
+    }
+
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    if (isRoot && worker->nbRootMoves > 0) {
+        memcpy(moves, worker->rootMoves, sizeof(moves));
+    } else {
+        getValidMoves(moves, *state, NULL);
+    }
+    if (isGameOverMove(moves[0])) {
+        return flagFromMove(moves[0]) == CHECKMATE ? -MATE_SCORE + ply : 0;
+    }
+    if (isRoot && worker->nbExcludedRootMoves > 0) {
+        removeExcludedRootMoves(worker, moves);
+    }
+
+    int scores[MAX_LEGAL_MOVES];
+    int nbMoves = 0;
+    while (moves[nbMoves]) {
+        scores[nbMoves] = scoreMove(worker, ply, moves[nbMoves], transpositionMove);
+        nbMoves++;
+    }
+
+    Move quietMovesSearched[MAX_LEGAL_MOVES];
+    int nbQuietMovesSearched = 0;
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove = 0;
+
+    for (int i = 0; i < nbMoves; i++) {
+        Move move = pickNextMove(moves, scores, nbMoves, i);
+        bool isQuiet = !isCapture(state, move) && !isPromotion(move);
+
+        if (worker->features.lateMovePruning &&
+            !isPrincipalVariationNode &&
+            !inCheck &&
+            isQuiet &&
+            depth <= 4 &&
+            bestScore > -MATE_SCORE + MAX_PLY &&
+            nbQuietMovesSearched >= 3 + depth * depth) {
+            continue;
+        }
+
+        pushMove(worker, ply, move);
+        bool givesCheck = isInCheck(worker->stack[ply + 1].state);
+        int newDepth = depth - 1;
+        int score;
+
+        if (i == 0) {
+            score = -alphaBeta(worker, -beta, -alpha, newDepth, ply + 1, true);
+        } else {
+            int reduction = 0;
+            if (worker->features.lateMoveReductions &&
+                depth >= 3 &&
+                i >= (isPrincipalVariationNode ? 3 : 2) &&
+                isQuiet &&
+                !inCheck &&
+                !givesCheck) {
+                // The later the move is in the ordering, the less likely it is to be good
+                reduction = lateMoveReductions[depth < 64 ? depth : 63][i < 64 ? i : 63];
+                reduction -= *historyEntry(worker, state->colorToGo, move) / 8192;
+                if (isPrincipalVariationNode) { reduction--; }
+                if (move == worker->stack[ply].killers[0] || move == worker->stack[ply].killers[1]) { reduction--; }
+                if (reduction > newDepth - 1) { reduction = newDepth - 1; }
+                if (reduction < 0) { reduction = 0; }
+            }
+
+            score = -alphaBeta(worker, -alpha - 1, -alpha, newDepth - reduction, ply + 1, true);
+            if (score > alpha && reduction > 0) {
+                score = -alphaBeta(worker, -alpha - 1, -alpha, newDepth, ply + 1, true);
+            }
+            if (score > alpha && score < beta) {
+                score = -alphaBeta(worker, -beta, -alpha, newDepth, ply + 1, true);
+            }
+        }
+        if (worker->stopped) { return 0; }
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                updatePrincipalVariation(worker, ply, move);
+
+                if (alpha >= beta) {
+                    if (isQuiet) {
+                        if (worker->stack[ply].killers[0] != move) {
+                            worker->stack[ply].killers[1] = worker->stack[ply].killers[0];
+                            worker->stack[ply].killers[0] = move;
+                        }
+                        int bonus = depth * depth;
+                        updateHistory(worker, state->colorToGo, move, bonus);
+                        for (int j = 0; j < nbQuietMovesSearched; j++) {
+                            updateHistory(worker, state->colorToGo, quietMovesSearched[j], -bonus);
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        if (isQuiet) {
+            quietMovesSearched[nbQuietMovesSearched++] = move;
+        }
+    }
+
+    // Without some of its moves, the score of the root is not the one of the position
+    if (isRoot && worker->nbExcludedRootMoves > 0) { return bestScore; }
+    Bound bound = bestScore >= beta ? BOUND_LOWER : (alpha > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    storeInTranspositionTable(worker->table, state->zobristKey, bestMove, scoreToTranspositionTable(bestScore, ply), evaluation, depth, bound);
+    return bestScore;
+}
+
+/**
+ * Searches the root with a small window around the previous score, and widens it when the score falls outside
+*/
+static int aspirationWindow(SearchWorker* worker, int depth, int previousScore) {
+    int delta = 25;
+    int alpha = -INFINITE_SCORE;
+    int beta = INFINITE_SCORE;
+    if (depth >= 5) {
+        alpha = previousScore - delta;
+        beta = previousScore + delta;
+    }
+    while (true) {
+        int score = alphaBeta(worker, alpha, beta, depth, 0, false);
+        if (worker->stopped) { return score; }
+        if (score <= alpha) {
+            alpha = score - delta > -INFINITE_SCORE ? score - delta : -INFINITE_SCORE;
+        } else if (score >= beta) {
+            beta = score + delta < INFINITE_SCORE ? score + delta : INFINITE_SCORE;
+        } else {
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+static SearchWorker* createSearchWorker(const GameState* rootState, const GameState* previousStates, TranspositionTable* table) {
+    SearchWorker* worker = calloc(1, sizeof(SearchWorker));
+    assert(worker != NULL && "Malloc failed so buy more RAM lol");
+
+    int nbPreviousStates = 0;
+    while (previousStates != NULL && previousStates[nbPreviousStates].colorToGo != 0) {
+        nbPreviousStates++;
+    }
+    worker->nbGameKeys = nbPreviousStates;
+    worker->keys = malloc(sizeof(u64) * (nbPreviousStates + MAX_PLY + 2));
+    assert(worker->keys != NULL && "Malloc failed so buy more RAM lol");
+    for (int i = 0; i < nbPreviousStates; i++) {
+        // Recomputing the keys, in case the caller built the states without makeMove
+        const GameState* previous = &previousStates[i];
+        worker->keys[i] = zobristKeyFromPosition(previous->board, previous->colorToGo, previous->castlingPerm, previous->enPassantTargetSquare);
+    }
+
+    worker->stack[0].state = *rootState;
+    worker->stack[0].state.zobristKey = zobristKeyFromPosition(rootState->board, rootState->colorToGo, rootState->castlingPerm, rootState->enPassantTargetSquare);
+    worker->keys[nbPreviousStates] = worker->stack[0].state.zobristKey;
+
+    if (nnueIsNetworkLoaded()) {
+        worker->accumulators = malloc(sizeof(NnueAccumulator) * (MAX_PLY + 1));
+        assert(worker->accumulators != NULL && "Malloc failed so buy more RAM lol");
+        nnueRefreshAccumulator(&worker->accumulators[0], &worker->stack[0].state);
+    }
+    worker->pawnHashTable = createPawnHashTable(PAWN_HASH_TABLE_ENTRIES);
+    worker->table = table;
+    worker->startTime = currentTimeNanoseconds();
+    return worker;
+}
+
+static void freeSearchWorker(SearchWorker* worker) {
+    freePawnHashTable(worker->pawnHashTable);
+    free(worker->accumulators);
+    free(worker->keys);
+    free(worker);
+}
+
+static u64 nodesPerSecond(u64 nodes, u64 time) {
+    return time > 0 ? nodes * 1000 / time : nodes * 1000;
+}
+
+static u64 threadsTablebaseHits(SearchWorker** workers, int nbThreads) {
+    u64 hits = 0;
+    for (int i = 0; i < nbThreads; i++) {
+        hits += atomic_load_explicit(&workers[i]->tablebaseHits, memory_order_relaxed);
+    }
+    return hits;
+}
+
+/**
+ * The main thread (index 0) follows the limits and reports its iterations, the helpers search until they are told to stop.
+ * Helpers fill the shared transposition table, and the odd ones search one ply deeper than the main thread so that they
+ * do not all search the same nodes
+*/
+typedef struct SearchThread {
+    int index;
+    SearchWorker** workers;
+    int nbThreads;
+    int nbLines; // Only the main thread searches more than one line
+    const SearchOptions* options;
+    SearchResult result;
+} SearchThread;
+
+/**
+ * Insertion sort from the best score to the worst, a line searched later can end up better than the previous ones
+ * since each one is searched with its own aspiration window
+*/
+static void sortLines(SearchResult* lines, int nbLines) {
+    for (int i = 1; i < nbLines; i++) {
+        SearchResult line = lines[i];
+        int j = i;
+        while (j > 0 && lines[j - 1].score < line.score) {
+            lines[j] = lines[j - 1];
+            j--;
+        }
+        lines[j] = line;
+    }
+}
+
+static void* iterativeDeepening(void* data) {
+    SearchThread* thread = data;
+    SearchWorker* worker = thread->workers[thread->index];
+    const bool isMainThread = thread->index == 0;
+    SearchResult* result = &thread->result;
+    SearchResult* lines = calloc(thread->nbLines, sizeof(SearchResult));
+    assert(lines != NULL && "Malloc failed so buy more RAM lol");
+
+    int maxDepth = (worker->limits.depth > 0 && worker->limits.depth < MAX_PLY) ? worker->limits.depth : MAX_PLY - 1;
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        int searchedDepth = (!isMainThread && thread->index % 2 == 1 && depth < maxDepth) ? depth + 1 : depth;
+
+        // Each line is the best one without the moves of the lines before it
+        worker->nbExcludedRootMoves = 0;
+        for (int i = 0; i < thread->nbLines; i++) {
+            int score = aspirationWindow(worker, searchedDepth, lines[i].score);
+            if (worker->stopped) { break; }
+
+            SearchResult* line = &lines[i];
+            line->score = score;
+            line->depth = depth;
+            line->selectiveDepth = worker->selectiveDepth;
+            line->principalVariationLength = worker->principalVariationLength[0];
+            memcpy(line->principalVariation, worker->principalVariation[0], sizeof(Move) * line->principalVariationLength);
+            line->bestMove = line->principalVariationLength > 0 ? line->principalVariation[0] : 0;
+            if (line->bestMove == 0) { break; }
+            worker->excludedRootMoves[worker->nbExcludedRootMoves++] = line->bestMove;
+        }
+        worker->nbExcludedRootMoves = 0;
+        if (worker->stopped) { break; }
+
+        sortLines(lines, thread->nbLines);
+        bool bestMoveChanged = depth > 1 && lines[0].bestMove != result->bestMove;
+        *result = lines[0];
+        result->multiPv = 1;
+        worker->canStop = true;
+
+        if (result->bestMove == 0) { break; } // There is no legal move in the root position
+        if (!isMainThread) { continue; }
+
+        for (int i = 0; i < thread->nbLines; i++) {
+            lines[i].multiPv = i + 1;
+            lines[i].nodes = threadsNodes(thread->workers, thread->nbThreads);
+            lines[i].tablebaseHits = threadsTablebaseHits(thread->workers, thread->nbThreads);
+            lines[i].time = (currentTimeNanoseconds() - worker->startTime) / 1000000;
+            lines[i].nodesPerSecond = nodesPerSecond(lines[i].nodes, lines[i].time);
+            if (thread->options->onIteration != NULL) {
+                thread->options->onIteration(&lines[i], thread->options->userData);
+            }
+        }
+        result->nodes = lines[0].nodes;
+        result->tablebaseHits = lines[0].tablebaseHits;
+        result->time = lines[0].time;
+        result->nodesPerSecond = lines[0].nodesPerSecond;
+
+        // There is no point in searching deeper once a forced mate is found
+        if (isMateScore(result->score) && MATE_SCORE - abs(result->score) <= depth) { break; }
+        updatePonderState(worker);
+        if (shouldStopIterating(&worker->timeManager, bestMoveChanged)) { break; }
+        if (worker->limits.stop != NULL && atomic_load_explicit(worker->limits.stop, memory_order_relaxed)) { break; }
+    }
+    free(lines);
+    return NULL;
+}
+
+SearchOptions defaultSearchOptions() {
+    SearchOptions options = {
+        .features = defaultSearchFeatures(),
+        .nbThreads = 1,
+        .multiPv = 1,
+        .onIteration = NULL,
+        .userData = NULL
+    };
+    return options;
+}
+
+SearchResult searchPosition(
+    const GameState* rootState,
+    const GameState* previousStates,
+    SearchLimits limits,
+    SearchOptions options,
+    TranspositionTable* table) {
+    pthread_once(&lateMoveReductionsOnce, initializeLateMoveReductions);
+    newTranspositionTableSearch(table);
+
+    // The tables at the root pick the moves, the search then only has to find the fastest way to convert them
+    Move rootMoves[MAX_LEGAL_MOVES + 1];
+    int nbRootMoves = syzygyRootMoves(rootState, rootMoves);
+
+    int nbLines = options.multiPv > 1 ? options.multiPv : 1;
+    if (nbLines > 1) {
+        Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+        int nbMoves = nbRootMoves;
+        if (nbMoves == 0) {
+            getValidMoves(moves, *rootState, previousStates);
+            while (moves[nbMoves] && !isGameOverMove(moves[nbMoves])) { nbMoves++; }
+        }
+        if (nbLines > nbMoves) { nbLines = nbMoves > 1 ? nbMoves : 1; }
+    }
+
+    nnueHoldNetwork(); // Until the workers are freed, they read the network without copying it
+    int nbThreads = options.nbThreads > 1 ? options.nbThreads : 1;
+    atomic_bool helpersStop = false;
+    SearchWorker* workers[nbThreads];
+    SearchThread threads[nbThreads];
+    pthread_t helpers[nbThreads];
+    for (int i = 0; i < nbThreads; i++) {
+        workers[i] = createSearchWorker(rootState, previousStates, table);
+        workers[i]->workers = workers;
+        workers[i]->nbWorkers = nbThreads;
+        workers[i]->features = options.features;
+        workers[i]->nbRootMoves = nbRootMoves;
+        memcpy(workers[i]->rootMoves, rootMoves, sizeof(rootMoves));
+        workers[i]->probeTablebases = nbRootMoves == 0 && (syzygyLargestTable() > 0 || endgameTablesLargest() > 0);
+        if (i == 0) {
+            workers[i]->limits = limits;
+            workers[i]->isPondering = limits.ponder != NULL && atomic_load(limits.ponder);
+            if (!workers[i]->isPondering) {
+                startTimeManager(&workers[i]->timeManager, limits.moveTime, limits.timeLeft, limits.increment, limits.movesToGo);
+            }
+        } else {
+            SearchLimits helperLimits = { .stop = &helpersStop };
+            workers[i]->limits = helperLimits;
+            workers[i]->canStop = true;
+        }
+        SearchThread thread = {
+            .index = i,
+            .workers = workers,
+            .nbThreads = nbThreads,
+            .nbLines = i == 0 ? nbLines : 1,
+            .options = &options
+        };
+        threads[i] = thread;
+    }
+
+    workers[0]->tablebaseHits = nbRootMoves > 0;
+
+    for (int i = 1; i < nbThreads; i++) {
+        int error = pthread_create(&helpers[i], NULL, iterativeDeepening, &threads[i]);
+        assert(error == 0 && "Could not start a search thread");
+        (void) error;
+    }
+    iterativeDeepening(&threads[0]);
+    atomic_store(&helpersStop, true);
+    for (int i = 1; i < nbThreads; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+
+    SearchResult result = threads[0].result;
+    result.multiPv = 1;
+    result.nodes = threadsNodes(workers, nbThreads);
+    result.tablebaseHits = threadsTablebaseHits(workers, nbThreads);
+    result.time = (currentTimeNanoseconds() - workers[0]->startTime) / 1000000;
+    result.nodesPerSecond = nodesPerSecond(result.nodes, result.time);
+    for (int i = 0; i < nbThreads; i++) {
+        freeSearchWorker(workers[i]);
+    }
+    nnueReleaseNetwork();
+    return result;
+}
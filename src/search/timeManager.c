@@ -0,0 +1,64 @@
+#include <time.h>
+#include "TimeManager.h"
+
+// When the number of moves until the next time control is unknown, the time left is split as if there were this many
+#define DEFAULT_MOVES_TO_GO 30
+#define MAX_MOVES_TO_GO 50
+
+u64 currentTimeNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64) now.tv_sec * 1000000000ULL + (u64) now.tv_nsec;
+}
+
+static u64 atLeastOneMillisecond(long long milliseconds) {
+    return milliseconds >= 1 ? (u64) milliseconds : 1;
+}
+
+void startTimeManager(TimeManager* manager, int moveTime, int timeLeft, int increment, int movesToGo) {
+    manager->startTime = currentTimeNanoseconds();
+    manager->softLimit = 0;
+    manager->hardLimit = 0;
+    manager->bestMoveInstability = 0;
+
+    if (moveTime > 0) {
+        manager->hardLimit = atLeastOneMillisecond(moveTime - MOVE_OVERHEAD);
+        manager->softLimit = manager->hardLimit;
+        return;
+    }
+    if (timeLeft <= 0) { return; }
+
+    if (movesToGo <= 0 || movesToGo > MAX_MOVES_TO_GO) {
+        movesToGo = movesToGo <= 0 ? DEFAULT_MOVES_TO_GO : MAX_MOVES_TO_GO;
+    }
+    long long usableTime = (long long) timeLeft - MOVE_OVERHEAD;
+    long long softLimit = usableTime / movesToGo + (long long) increment * 3 / 4;
+    // A single move can use a lot more than its share when it is hard, but never enough to lose on time
+    long long hardLimit = softLimit * 5;
+    long long maximumTime = usableTime * 3 / 4;
+    if (hardLimit > maximumTime) { hardLimit = maximumTime; }
+    if (softLimit > hardLimit) { softLimit = hardLimit; }
+
+    manager->softLimit = atLeastOneMillisecond(softLimit);
+    manager->hardLimit = atLeastOneMillisecond(hardLimit);
+}
+
+u64 elapsedMilliseconds(const TimeManager* manager) {
+    return (currentTimeNanoseconds() - manager->startTime) / 1000000;
+}
+
+bool isHardLimitReached(const TimeManager* manager) {
+    return manager->hardLimit != 0 && elapsedMilliseconds(manager) >= manager->hardLimit;
+}
+
+bool shouldStopIterating(TimeManager* manager, bool bestMoveChanged) {
+    manager->bestMoveInstability = manager->bestMoveInstability / 2 + (bestMoveChanged ? 1 : 0);
+    if (manager->softLimit == 0) { return false; }
+
+    // Up to twice the time when the best move changed in the last few iterations
+    double scale = 1 + manager->bestMoveInstability / 2;
+    if (scale > 2) { scale = 2; }
+    u64 softLimit = (u64) (manager->softLimit * scale);
+    if (softLimit > manager->hardLimit) { softLimit = manager->hardLimit; }
+    return elapsedMilliseconds(manager) >= softLimit;
+}
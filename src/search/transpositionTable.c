@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "TranspositionTable.h"
+
+// Bits of the packed data:
+// 0-15: move, 16-31: score, 32-47: static evaluation, 48-55: depth, 56-57: bound, 58-63: generation
+#define GENERATION_MASK 0b111111
+
+static u64 packTranspositionData(Move move, int score, int staticEvaluation, int depth, Bound bound, unsigned char generation) {
+    return ((u64) move) |
+        (((u64) (unsigned short) score) << 16) |
+        (((u64) (unsigned short) staticEvaluation) << 32) |
+        (((u64) (unsigned char) depth) << 48) |
+        (((u64) bound) << 56) |
+        (((u64) (generation & GENERATION_MASK)) << 58);
+}
+
+static TranspositionData unpackTranspositionData(u64 data) {
+    TranspositionData result;
+    result.move = (Move) (data & 0xFFFF);
+    result.score = (short) ((data >> 16) & 0xFFFF);
+    result.staticEvaluation = (short) ((data >> 32) & 0xFFFF);
+    result.depth = (unsigned char) ((data >> 48) & 0xFF);
+    result.bound = (unsigned char) ((data >> 56) & 0b11);
+    result.generation = (unsigned char) (data >> 58);
+    return result;
+}
+
+static void allocateEntries(TranspositionTable* table, size_t megabytes) {
+    size_t bucketSize = sizeof(TranspositionEntry) * TRANSPOSITION_BUCKET_SIZE;
+    size_t nbBuckets = (megabytes * 1024 * 1024) / bucketSize;
+    if (nbBuckets == 0) { nbBuckets = 1; }
+    table->entries = calloc(nbBuckets * TRANSPOSITION_BUCKET_SIZE, sizeof(TranspositionEntry));
+    assert(table->entries != NULL && "Malloc failed so buy more RAM lol");
+    table->nbBuckets = nbBuckets;
+    table->generation = 0;
+}
+
+TranspositionTable* createTranspositionTable(size_t megabytes) {
+    TranspositionTable* table = malloc(sizeof(TranspositionTable));
+    assert(table != NULL && "Malloc failed so buy more RAM lol");
+    allocateEntries(table, megabytes);
+    return table;
+}
+
+void resizeTranspositionTable(TranspositionTable* table, size_t megabytes) {
+    free(table->entries);
+    allocateEntries(table, megabytes);
+}
+
+void clearTranspositionTable(TranspositionTable* table) {
+    memset(table->entries, 0, sizeof(TranspositionEntry) * TRANSPOSITION_BUCKET_SIZE * table->nbBuckets);
+    table->generation = 0;
+}
+
+void freeTranspositionTable(TranspositionTable* table) {
+    if (table == NULL) { return; }
+    free(table->entries);
+    free(table);
+}
+
+void newTranspositionTableSearch(TranspositionTable* table) {
+    table->generation = (table->generation + 1) & GENERATION_MASK;
+}
+
+/**
+ * The high 64 bits of the 128 bit product. 32 bit targets (and MSVC) have no 128 bit integers, so it is done in 32 bit halves there
+*/
+static inline u64 multiplyHigh64(u64 a, u64 b) {
+#ifdef __SIZEOF_INT128__
+    return (u64) (((unsigned __int128) a * b) >> 64);
+#else
+    u64 aLow = (uint32_t) a, aHigh = a >> 32;
+    u64 bLow = (uint32_t) b, bHigh = b >> 32;
+    u64 lowLow = aLow * bLow;
+    u64 highLow = aHigh * bLow;
+    u64 lowHigh = aLow * bHigh;
+    u64 middle = (lowLow >> 32) + (uint32_t) highLow + (uint32_t) lowHigh;
+    return aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32);
+#endif
+}
+
+static TranspositionEntry* bucketForKey(const TranspositionTable* table, u64 key) {
+    // Maps the key to [0, nbBuckets) without a modulo, see https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction/
+    size_t index = (size_t) multiplyHigh64(key, table->nbBuckets);
+    return &table->entries[index * TRANSPOSITION_BUCKET_SIZE];
+}
+
+bool probeTranspositionTable(const TranspositionTable* table, u64 key, TranspositionData* result) {
+    TranspositionEntry* bucket = bucketForKey(table, key);
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++) {
+        // Relaxed atomic loads: other threads can write the entry at the same time, the checksum catches torn entries
+        u64 checksum = __atomic_load_n(&bucket[i].checksum, __ATOMIC_RELAXED);
+        u64 data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        if ((checksum ^ data) == key && data != 0) {
+            *result = unpackTranspositionData(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void storeInTranspositionTable(TranspositionTable* table, u64 key, Move move, int score, int staticEvaluation, int depth, Bound bound) {
+    TranspositionEntry* bucket = bucketForKey(table, key);
+    TranspositionEntry* depthPreferred = &bucket[0];
+    TranspositionEntry* entry = &bucket[1]; // The always-replace entry
+
+    u64 oldData = __atomic_load_n(&depthPreferred->data, __ATOMIC_RELAXED);
+    TranspositionData old = unpackTranspositionData(oldData);
+    bool sameKey = (__atomic_load_n(&depthPreferred->checksum, __ATOMIC_RELAXED) ^ oldData) == key;
+    if (oldData == 0 || sameKey || old.generation != (table->generation & GENERATION_MASK) || depth >= old.depth) {
+        entry = depthPreferred;
+        // Keeping the best move of a previous search of this position if this search did not find one
+        if (sameKey && move == 0) { move = old.move; }
+    }
+
+    u64 data = packTranspositionData(move, score, staticEvaluation, depth, bound, table->generation);
+    __atomic_store_n(&entry->checksum, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+int transpositionTableHashFull(const TranspositionTable* table) {
+    size_t sampleSize = table->nbBuckets < 1000 ? table->nbBuckets : 1000;
+    int used = 0;
+    for (size_t i = 0; i < sampleSize * TRANSPOSITION_BUCKET_SIZE; i++) {
+        u64 data = table->entries[i].data;
+        if (data != 0 && unpackTranspositionData(data).generation == (table->generation & GENERATION_MASK)) {
+            used++;
+        }
+    }
+    return sampleSize == 0 ? 0 : (int) ((used * 1000) / (sampleSize * TRANSPOSITION_BUCKET_SIZE));
+}
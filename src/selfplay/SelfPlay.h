@@ -0,0 +1,60 @@
+#ifndef SELF_PLAY_H
+#define SELF_PLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../state/Move.h"
+#include "../state/PackedPosition.h"
+
+#define SELF_PLAY_FILE_MAGIC "CESELF01"
+#define SELF_PLAY_FILE_MAGIC_LENGTH 8
+
+/**
+ * A searched position of a self-play game. The file is the 8 byte magic followed by the records, in little endian
+*/
+typedef struct SelfPlayRecord {
+    PackedPosition position;
+    Move move; // The move played, found by the search
+    int16_t score; // The score of the search, in centipawns from the point of view of the side to move
+    int8_t result; // 1 if the side to move won the game, 0 for a draw, -1 for a loss
+    uint8_t reserved;
+    uint16_t ply; // Since the start of the game, with the random opening
+} SelfPlayRecord;
+
+_Static_assert(sizeof(SelfPlayRecord) == 40, "A self-play record should be 40 bytes");
+
+typedef struct SelfPlayOptions {
+    int nbGames;
+    int nbThreads; // One game per thread at a time, each thread searches with one search thread
+    u64 nodesPerMove;
+    int nbRandomPlies; // The opening of each game is made of random legal moves
+    int maxPlies; // A game that reaches it is a draw
+    size_t hashMegabytes; // The size of the transposition table of each thread
+    u64 seed; // A game depends only on the seed and its index, not on the thread that plays it
+    const char* outputPath;
+} SelfPlayOptions;
+
+typedef struct SelfPlayStats {
+    size_t nbGames;
+    size_t nbRecords;
+    size_t nbWhiteWins;
+    size_t nbBlackWins;
+    size_t nbDraws;
+    size_t nbSkippedGames; // Every random opening of these games ended the game, they are not in the other counts
+} SelfPlayStats;
+
+/**
+ * Returns 1000 games on every core with 5000 nodes per move, 8 random plies and a 16MB table, to selfplay.bin
+*/
+SelfPlayOptions defaultSelfPlayOptions();
+
+/**
+ * Plays the games on `nbThreads` threads. Every finished game is handed to a writer thread through a lock-free queue,
+ * so that the file writes never block the searches. `onGameFinished` can be NULL, it is called from the game threads
+ * with the totals so far, so it has to be thread safe.
+ * `magicBitBoardInitialize` needs to be called before. Returns false if the output file cannot be written
+*/
+bool runSelfPlay(SelfPlayOptions options, void (*onGameFinished)(const SelfPlayStats* stats, void* userData), void* userData, SelfPlayStats* stats);
+
+#endif
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "SelfPlay.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../utils/FenString.h"
+#include "../search/Search.h"
+
+#define STARTING_POSITION "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define QUEUE_SIZE (1 << 16) // In records, a power of two
+#define WRITE_BUFFER_SIZE 4096
+#define MAX_RANDOM_OPENING_TRIES 64
+#define MAX_GAME_ATTEMPTS 16 // With a new seed each, before the game is skipped
+#define MAX_SELF_PLAY_PLIES 0xFFFF // The ply of a record is 16 bits
+
+typedef struct RecordQueueCell {
+    atomic_size_t sequence;
+    SelfPlayRecord record;
+} RecordQueueCell;
+
+/**
+ * A bounded queue with several producers and one consumer. The sequence of a cell says whether it can be written
+ * (sequence == position) or read (sequence == position + 1), so the producers only compete on the enqueue position
+*/
+typedef struct RecordQueue {
+    RecordQueueCell* cells;
+    _Alignas(64) atomic_size_t enqueuePosition;
+    _Alignas(64) size_t dequeuePosition; // Only used by the writer thread
+} RecordQueue;
+
+typedef struct SelfPlay {
+    SelfPlayOptions options;
+    GameState startingPosition;
+    RecordQueue queue;
+    atomic_int nextGame;
+    atomic_int nbRunningThreads;
+    atomic_size_t nbGames;
+    atomic_size_t nbRecords;
+    atomic_size_t nbWhiteWins;
+    atomic_size_t nbBlackWins;
+    atomic_size_t nbDraws;
+    atomic_size_t nbSkippedGames;
+    void (*onGameFinished)(const SelfPlayStats* stats, void* userData);
+    void* userData;
+    FILE* file;
+    bool hasFailed; // Only used by the writer thread
+} SelfPlay;
+
+/**
+ * Everything a thread needs to play its games, nothing is shared with the other threads but the queue
+*/
+typedef struct SelfPlayThread {
+    SelfPlay* selfPlay;
+    TranspositionTable* table;
+    GameState* history; // The positions of the game before the current one, 0 terminated like getValidMoves expects
+    SelfPlayRecord* records; // The searched positions of the game, sent once the result is known
+} SelfPlayThread;
+
+static int numberOfCores() {
+    long nbCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return nbCores < 1 ? 1 : (int) nbCores;
+}
+
+SelfPlayOptions defaultSelfPlayOptions() {
+    SelfPlayOptions options = {
+        .nbGames = 1000,
+        .nbThreads = numberOfCores(),
+        .nodesPerMove = 5000,
+        .nbRandomPlies = 8,
+        .maxPlies = 400,
+        .hashMegabytes = 16,
+        .seed = 0,
+        .outputPath = "selfplay.bin"
+    };
+    return options;
+}
+
+static bool pushRecord(RecordQueue* queue, const SelfPlayRecord* record) {
+    size_t position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+    RecordQueueCell* cell;
+    while (true) {
+        cell = &queue->cells[position & (QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        if (sequence == position) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) { break; }
+        } else if (sequence < position) {
+            return false; // Full, the writer has not read this cell yet
+        } else {
+            position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+        }
+    }
+    cell->record = *record;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+static bool popRecord(RecordQueue* queue, SelfPlayRecord* record) {
+    size_t position = queue->dequeuePosition;
+    RecordQueueCell* cell = &queue->cells[position & (QUEUE_SIZE - 1)];
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + 1) { return false; }
+    *record = cell->record;
+    atomic_store_explicit(&cell->sequence, position + QUEUE_SIZE, memory_order_release);
+    queue->dequeuePosition = position + 1;
+    return true;
+}
+
+/**
+ * Splitmix64, every game has its own generator seeded from the game index
+*/
+static u64 nextRandom(u64* state) {
+    u64 result = (*state += 0x9E3779B97F4A7C15ULL);
+    result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    result = (result ^ (result >> 27)) * 0x94D049BB133111EBULL;
+    return result ^ (result >> 31);
+}
+
+static bool isGameOver(const Move moves[MAX_LEGAL_MOVES + 1]) {
+    Flag flag = flagFromMove(moves[0]);
+    return flag == CHECKMATE || flag == STALEMATE || flag == DRAW;
+}
+
+/**
+ * Only the kings, or the kings and one minor piece, which nobody can win
+*/
+static bool isInsufficientMaterial(const Board* board) {
+    u64 pawnsRooksQueens = board->pieces[PAWN - 1] | board->pieces[ROOK - 1] | board->pieces[QUEEN - 1];
+    u64 minorPieces = board->pieces[KNIGHT - 1] | board->pieces[BISHOP - 1];
+    return pawnsRooksQueens == 0 && (minorPieces & (minorPieces - 1)) == 0;
+}
+
+static void addToHistory(SelfPlayThread* thread, const GameState* state, int ply) {
+    thread->history[ply] = *state;
+    thread->history[ply + 1].colorToGo = 0;
+}
+
+/**
+ * Plays the random moves of the opening, returns false if the game ended during the opening
+*/
+static bool playRandomOpening(SelfPlayThread* thread, u64* random, GameState* state, int* nbPlies) {
+    *state = thread->selfPlay->startingPosition;
+    *nbPlies = 0;
+    thread->history[0].colorToGo = 0;
+    Move moves[MAX_LEGAL_MOVES + 1];
+    for (int i = 0; i <= thread->selfPlay->options.nbRandomPlies; i++) {
+        memset(moves, 0, sizeof(moves));
+        getValidMoves(moves, *state, thread->history);
+        if (isGameOver(moves)) { return false; }
+        if (i == thread->selfPlay->options.nbRandomPlies) { break; }
+        addToHistory(thread, state, *nbPlies);
+        makeMove(moves[nextRandom(random) % nbMovesInArray(moves)], state);
+        (*nbPlies)++;
+    }
+    return true;
+}
+
+static void sendGame(SelfPlayThread* thread, int nbRecords, int whiteResult) {
+    SelfPlay* selfPlay = thread->selfPlay;
+    for (int i = 0; i < nbRecords; i++) {
+        bool isWhiteToMove = !(thread->records[i].position.sideAndCastling & (1 << 4));
+        thread->records[i].result = (int8_t) (isWhiteToMove ? whiteResult : -whiteResult);
+        // The writer only falls behind when the disk does, waiting is the only option then
+        while (!pushRecord(&selfPlay->queue, &thread->records[i])) { sched_yield(); }
+    }
+
+    atomic_fetch_add(&selfPlay->nbRecords, nbRecords);
+    atomic_fetch_add(whiteResult > 0 ? &selfPlay->nbWhiteWins : whiteResult < 0 ? &selfPlay->nbBlackWins : &selfPlay->nbDraws, 1);
+    size_t nbGames = atomic_fetch_add(&selfPlay->nbGames, 1) + 1;
+    if (selfPlay->onGameFinished != NULL) {
+        SelfPlayStats stats = {
+            .nbGames = nbGames,
+            .nbRecords = atomic_load(&selfPlay->nbRecords),
+            .nbWhiteWins = atomic_load(&selfPlay->nbWhiteWins),
+            .nbBlackWins = atomic_load(&selfPlay->nbBlackWins),
+            .nbDraws = atomic_load(&selfPlay->nbDraws),
+            .nbSkippedGames = atomic_load(&selfPlay->nbSkippedGames)
+        };
+        selfPlay->onGameFinished(&stats, selfPlay->userData);
+    }
+}
+
+/**
+ * Plays and sends one game, returns false without sending anything if every random opening ended the game
+*/
+static bool playGame(SelfPlayThread* thread, int gameIndex, int attempt) {
+    const SelfPlayOptions* options = &thread->selfPlay->options;
+    u64 random = options->seed ^ (0xD1B54A32D192ED03ULL * (u64) (gameIndex + 1)) ^ (0x9E3779B97F4A7C15ULL * (u64) attempt);
+    GameState state;
+    int nbPlies;
+    int nbTries = 1;
+    while (!playRandomOpening(thread, &random, &state, &nbPlies)) {
+        if (nbTries++ == MAX_RANDOM_OPENING_TRIES) { return false; }
+    }
+
+    // A clean table makes the game the same whatever the games played before on this thread
+    clearTranspositionTable(thread->table);
+    SearchOptions searchOptions = defaultSearchOptions();
+    SearchLimits limits = { .nodes = options->nodesPerMove };
+    int nbRecords = 0;
+    int whiteResult = 0;
+    Move moves[MAX_LEGAL_MOVES + 1];
+    while (nbPlies < options->maxPlies && !isInsufficientMaterial(&state.board)) {
+        memset(moves, 0, sizeof(moves));
+        getValidMoves(moves, state, thread->history);
+        if (flagFromMove(moves[0]) == CHECKMATE) {
+            whiteResult = state.colorToGo == WHITE ? -1 : 1;
+            break;
+        }
+        if (isGameOver(moves)) { break; }
+
+        SearchResult result = searchPosition(&state, thread->history, limits, searchOptions, thread->table);
+        if (result.bestMove == 0) { break; }
+        SelfPlayRecord* record = &thread->records[nbRecords++];
+        memset(record, 0, sizeof(SelfPlayRecord));
+        packPosition(&state, &record->position);
+        record->move = result.bestMove;
+        record->score = (int16_t) result.score;
+        record->ply = (uint16_t) nbPlies;
+
+        addToHistory(thread, &state, nbPlies);
+        makeMove(result.bestMove, &state);
+        nbPlies++;
+    }
+    sendGame(thread, nbRecords, whiteResult);
+    return true;
+}
+
+static void* playGames(void* data) {
+    SelfPlayThread* thread = data;
+    SelfPlay* selfPlay = thread->selfPlay;
+    int gameIndex;
+    while ((gameIndex = atomic_fetch_add(&selfPlay->nextGame, 1)) < selfPlay->options.nbGames) {
+        int attempt = 0;
+        while (!playGame(thread, gameIndex, attempt)) {
+            if (++attempt == MAX_GAME_ATTEMPTS) {
+                // Counting it as a draw without records would skew the results
+                atomic_fetch_add(&selfPlay->nbSkippedGames, 1);
+                break;
+            }
+        }
+    }
+    atomic_fetch_sub(&selfPlay->nbRunningThreads, 1);
+    return NULL;
+}
+
+/**
+ * The file is in little endian, like the packed position files
+*/
+static void swapRecordByteOrder(SelfPlayRecord* records, size_t nbRecords) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < nbRecords; i++) {
+        records[i].position.occupancy = __builtin_bswap64(records[i].position.occupancy);
+        records[i].position.nbMoves = __builtin_bswap16(records[i].position.nbMoves);
+        records[i].move = __builtin_bswap16(records[i].move);
+        records[i].score = (int16_t) __builtin_bswap16((uint16_t) records[i].score);
+        records[i].ply = __builtin_bswap16(records[i].ply);
+    }
+#else
+    (void) records;
+    (void) nbRecords;
+#endif
+}
+
+static void writeBufferedRecords(SelfPlay* selfPlay, SelfPlayRecord* buffer, size_t* nbBuffered) {
+    swapRecordByteOrder(buffer, *nbBuffered);
+    if (*nbBuffered && fwrite(buffer, sizeof(SelfPlayRecord), *nbBuffered, selfPlay->file) != *nbBuffered) {
+        selfPlay->hasFailed = true;
+    }
+    *nbBuffered = 0;
+}
+
+static void* writeRecords(void* data) {
+    SelfPlay* selfPlay = data;
+    SelfPlayRecord* buffer = malloc(sizeof(SelfPlayRecord) * WRITE_BUFFER_SIZE);
+    assert(buffer != NULL && "Malloc failed so buy more RAM lol");
+    size_t nbBuffered = 0;
+    while (true) {
+        // Read before the queue, so that the records of the last game are in the queue if every thread is done
+        bool isDone = atomic_load(&selfPlay->nbRunningThreads) == 0;
+        if (popRecord(&selfPlay->queue, &buffer[nbBuffered])) {
+            if (++nbBuffered == WRITE_BUFFER_SIZE) { writeBufferedRecords(selfPlay, buffer, &nbBuffered); }
+            continue;
+        }
+        if (isDone) { break; }
+        struct timespec wait = { .tv_sec = 0, .tv_nsec = 1000000 };
+        nanosleep(&wait, NULL);
+    }
+    writeBufferedRecords(selfPlay, buffer, &nbBuffered);
+    free(buffer);
+    return NULL;
+}
+
+bool runSelfPlay(SelfPlayOptions options, void (*onGameFinished)(const SelfPlayStats* stats, void* userData), void* userData, SelfPlayStats* stats) {
+    memset(stats, 0, sizeof(SelfPlayStats));
+    if (options.nbThreads < 1) { options.nbThreads = 1; }
+    if (options.maxPlies < 1 || options.maxPlies > MAX_SELF_PLAY_PLIES) { options.maxPlies = MAX_SELF_PLAY_PLIES; }
+    if (options.nbRandomPlies < 0) { options.nbRandomPlies = 0; }
+    // At least one searched move, a game made only of random moves would be another draw without records
+    if (options.nbRandomPlies >= options.maxPlies) { options.nbRandomPlies = options.maxPlies - 1; }
+
+    FILE* file = fopen(options.outputPath, "wb");
+    if (file == NULL) { return false; }
+    if (fwrite(SELF_PLAY_FILE_MAGIC, 1, SELF_PLAY_FILE_MAGIC_LENGTH, file) != SELF_PLAY_FILE_MAGIC_LENGTH) {
+        fclose(file);
+        return false;
+    }
+
+    SelfPlay selfPlay;
+    memset(&selfPlay, 0, sizeof(SelfPlay));
+    selfPlay.options = options;
+    selfPlay.onGameFinished = onGameFinished;
+    selfPlay.userData = userData;
+    selfPlay.file = file;
+    bool isValid = setGameStateFromFenString(STARTING_POSITION, &selfPlay.startingPosition);
+    assert(isValid && "Invalid starting position");
+    (void) isValid;
+    selfPlay.queue.cells = malloc(sizeof(RecordQueueCell) * QUEUE_SIZE);
+    assert(selfPlay.queue.cells != NULL && "Malloc failed so buy more RAM lol");
+    for (size_t i = 0; i < QUEUE_SIZE; i++) {
+        atomic_init(&selfPlay.queue.cells[i].sequence, i);
+    }
+    atomic_init(&selfPlay.queue.enqueuePosition, 0);
+    atomic_init(&selfPlay.nextGame, 0);
+    atomic_init(&selfPlay.nbRunningThreads, options.nbThreads);
+
+    SelfPlayThread threads[options.nbThreads];
+    for (int i = 0; i < options.nbThreads; i++) {
+        threads[i].selfPlay = &selfPlay;
+        threads[i].table = createTranspositionTable(options.hashMegabytes);
+        threads[i].history = malloc(sizeof(GameState) * (options.maxPlies + 2));
+        threads[i].records = malloc(sizeof(SelfPlayRecord) * options.maxPlies);
+        assert(threads[i].history != NULL && threads[i].records != NULL && "Malloc failed so buy more RAM lol");
+    }
+
+    pthread_t writer;
+    pthread_t workers[options.nbThreads];
+    int error = pthread_create(&writer, NULL, writeRecords, &selfPlay);
+    assert(error == 0 && "Could not start the self-play writer thread");
+    for (int i = 1; i < options.nbThreads; i++) {
+        error = pthread_create(&workers[i], NULL, playGames, &threads[i]);
+        assert(error == 0 && "Could not start a self-play thread");
+    }
+    (void) error;
+    playGames(&threads[0]);
+    for (int i = 1; i < options.nbThreads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_join(writer, NULL);
+
+    for (int i = 0; i < options.nbThreads; i++) {
+        freeTranspositionTable(threads[i].table);
+        free(threads[i].history);
+        free(threads[i].records);
+    }
+    free(selfPlay.queue.cells);
+
+    stats->nbGames = atomic_load(&selfPlay.nbGames);
+    stats->nbRecords = atomic_load(&selfPlay.nbRecords);
+    stats->nbWhiteWins = atomic_load(&selfPlay.nbWhiteWins);
+    stats->nbBlackWins = atomic_load(&selfPlay.nbBlackWins);
+    stats->nbDraws = atomic_load(&selfPlay.nbDraws);
+    stats->nbSkippedGames = atomic_load(&selfPlay.nbSkippedGames);
+    bool isWritten = !selfPlay.hasFailed;
+    isWritten &= fclose(file) == 0;
+    return isWritten;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "SelfPlay.h"
+#include "../magicBitBoard/MagicBitBoard.h"
+#include "../nnue/Nnue.h"
+
+void printProgress(const SelfPlayStats* stats, void* userData) {
+    int nbGames = *(const int*) userData;
+    if (stats->nbGames % 100 != 0 && (int) stats->nbGames != nbGames) { return; }
+    printf("%zu/%d games, %zu positions (+%zu =%zu -%zu)\n", stats->nbGames, nbGames, stats->nbRecords, stats->nbWhiteWins, stats->nbDraws, stats->nbBlackWins);
+    fflush(stdout);
+}
+
+/**
+ * Usage: chess_engine_selfplay <output> <games> <threads> [nodes per move] [random plies] [seed] [nnue file]
+ * 0 threads plays on every core
+ * Example: chess_engine_selfplay ./selfplay.bin 10000 8 5000 8
+*/
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <output> <games> <threads> [nodes per move] [random plies] [seed] [nnue file]\n", argv[0]);
+        return 1;
+    }
+    SelfPlayOptions options = defaultSelfPlayOptions();
+    options.outputPath = argv[1];
+    options.nbGames = atoi(argv[2]);
+    if (atoi(argv[3]) > 0) { options.nbThreads = atoi(argv[3]); }
+    if (argc > 4) { options.nodesPerMove = strtoull(argv[4], NULL, 10); }
+    if (argc > 5) { options.nbRandomPlies = atoi(argv[5]); }
+    if (argc > 6) { options.seed = strtoull(argv[6], NULL, 10); }
+
+    magicBitBoardInitialize();
+    if (argc > 7 && !nnueLoadNetwork(argv[7])) {
+        fprintf(stderr, "Could not load the network %s\n", argv[7]);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SelfPlayStats stats;
+    bool isWritten = runSelfPlay(options, printProgress, &options.nbGames, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%zu games and %zu positions in %.1fs (%.0f positions/s)\n", stats.nbGames, stats.nbRecords, seconds, stats.nbRecords / seconds);
+    if (stats.nbSkippedGames > 0) {
+        printf("%zu games skipped, every random opening ended the game\n", stats.nbSkippedGames);
+    }
+
+    nnueUnloadNetwork();
+    magicBitBoardTerminate();
+    if (!isWritten) {
+        fprintf(stderr, "Could not write %s\n", options.outputPath);
+        return 1;
+    }
+    return 0;
+}
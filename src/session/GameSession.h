@@ -0,0 +1,104 @@
+#ifndef GAME_SESSION_H
+#define GAME_SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+#include "../search/Search.h"
+
+// The transposition table of a session, created on its first search
+#define SESSION_HASH_SIZE 16 // In MB
+#define MAX_SESSION_SEARCH_THREADS 256
+
+/**
+ * A game from a starting position: the current position, the positions and moves that led to it and their hashes.
+ * The session keeps the history itself, so the callers (the Flutter app through FFI) only pass the handle around
+ * instead of a 0 terminated array of GameState on every call.
+ * A session is not thread safe, but different sessions can be used from different threads.
+ * Its search (see sessionSearchStart) runs on its own thread and can be used along with the rest
+*/
+typedef struct GameSession GameSession;
+
+typedef enum GameStatus {
+    GAME_IN_PROGRESS,
+    GAME_CHECKMATE, // The side to move is mated
+    GAME_STALEMATE,
+    GAME_DRAW_BY_REPETITION, // The position happened three times
+    GAME_DRAW_BY_FIFTY_MOVES // 100 half moves without a capture or a pawn move
+} GameStatus;
+
+/**
+ * Returns NULL if the fen string is invalid, which includes the positions without exactly one king per side or where
+ * the side that is not to move is in check (see parseFenString). Free it with destroyGameSession, which stops its search first.
+ * `magicBitBoardInitialize` needs to be called before
+*/
+GameSession* createGameSession(const char* fen);
+void destroyGameSession(GameSession* session);
+
+/**
+ * Writes the legal moves, 0 terminated, and returns their number.
+ * There are none once the game is over, so the results never have the CHECKMATE, STALEMATE or DRAW moves of getValidMoves
+*/
+int sessionLegalMoves(const GameSession* session, Move results[MAX_LEGAL_MOVES + 1]);
+
+/**
+ * Plays the move if it is one of the legal moves, with its flag. Returns false otherwise and nothing changes
+*/
+bool sessionPlay(GameSession* session, Move move);
+
+/**
+ * Same as sessionPlay with a move in UCI notation (e2e4, e7e8q), for the callers that only know the squares
+*/
+bool sessionPlayUci(GameSession* session, const char* uci);
+
+/**
+ * Goes back to the position before the last move. Returns false if no move was played since the session was created
+*/
+bool sessionUndo(GameSession* session);
+
+GameStatus sessionStatus(const GameSession* session);
+
+/**
+ * The current position, it stays valid until the next sessionPlay or sessionUndo
+*/
+const GameState* sessionState(const GameSession* session);
+
+/**
+ * The moves played since the session was created, oldest first. Sets their number in `nbMoves`
+*/
+const Move* sessionMoves(const GameSession* session, int* nbMoves);
+
+/**
+ * The positions before the current one, oldest first and 0 terminated, as getValidMoves and searchPosition expect them
+*/
+const GameState* sessionPreviousStates(const GameSession* session);
+
+/**
+ * Starts searching the current position on a thread of the engine and returns right away, so that the caller
+ * (the UI isolate through FFI) is never blocked. The search uses every core of the machine.
+ * `onIteration` can be NULL. It is called from the search thread after every depth with the depth, the score,
+ * the principal variation and the nodes per second, so it has to be thread safe.
+ * The search works on a copy of the game: playing or undoing moves meanwhile does not change what is searched.
+ * `limits.stop` and `limits.ponder` are ignored, use sessionSearchStop. Every limit set to 0 means an infinite search.
+ * Returns false if a search of this session is already running
+*/
+bool sessionSearchStart(GameSession* session, SearchLimits limits, SearchIterationCallback onIteration, void* userData);
+
+/**
+ * Asks the search to stop as soon as possible, without waiting for it
+*/
+void sessionSearchStop(GameSession* session);
+
+/**
+ * Waits for the end of the search and returns its result, with the best move found.
+ * Returns a result with no best move if no search was started since the last sessionSearchWait
+*/
+SearchResult sessionSearchWait(GameSession* session);
+
+/**
+ * True from sessionSearchStart until the search is done, even if nobody waited for it yet
+*/
+bool sessionIsSearching(const GameSession* session);
+
+#endif
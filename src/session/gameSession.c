@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "GameSession.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../utils/FenString.h"
+#include "../utils/MoveNotation.h"
+
+#define INITIAL_CAPACITY 256
+
+/**
+ * What the search thread of a session works on. It has its own copy of the game, so the session can change meanwhile
+*/
+typedef struct SessionSearch {
+    pthread_t thread;
+    bool hasThread; // Started and not joined yet
+    atomic_bool stop;
+    atomic_bool isSearching;
+    GameState root;
+    GameState* previousStates;
+    SearchLimits limits;
+    SearchOptions options;
+    TranspositionTable* table;
+    SearchResult result;
+} SessionSearch;
+
+struct GameSession {
+    GameState state;
+    // The positions before the current one and the moves played from them, with one more state for the 0 at the end
+    GameState* previousStates;
+    Move* moves;
+    // The Zobrist keys of every position of the game, the current one included, for the repetitions
+    u64* keys;
+    int nbPlies;
+    int capacity;
+    // Found once per position, so that the status and the legal moves are free to ask for
+    GameStatus status;
+    int nbLegalMoves;
+    Move legalMoves[MAX_LEGAL_MOVES + 1];
+    SessionSearch search;
+};
+
+static bool isThreefoldRepetition(const GameSession* session) {
+    // Only the positions with the same side to move since the last capture or pawn move can be the same
+    int limit = session->state.turnsForFiftyRule < session->nbPlies ? session->state.turnsForFiftyRule : session->nbPlies;
+    u64 key = session->keys[session->nbPlies];
+    int nbRepetitions = 0;
+    for (int i = 2; i <= limit; i += 2) {
+        if (session->keys[session->nbPlies - i] == key && ++nbRepetitions == 2) { return true; }
+    }
+    return false;
+}
+
+/**
+ * Finds the legal moves and the status of the new current position
+*/
+static void updateSession(GameSession* session) {
+    // The draws are found here from the keys, getValidMoves would otherwise stop at them and hide a checkmate
+    GameState state = session->state;
+    state.turnsForFiftyRule = 0;
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, state, NULL);
+
+    Flag flag = flagFromMove(moves[0]);
+    session->nbLegalMoves = 0;
+    session->legalMoves[0] = 0;
+    if (flag == CHECKMATE) {
+        session->status = GAME_CHECKMATE;
+    } else if (flag == STALEMATE) {
+        session->status = GAME_STALEMATE;
+    } else if (session->state.turnsForFiftyRule >= 100) {
+        session->status = GAME_DRAW_BY_FIFTY_MOVES;
+    } else if (isThreefoldRepetition(session)) {
+        session->status = GAME_DRAW_BY_REPETITION;
+    } else {
+        session->status = GAME_IN_PROGRESS;
+        while (moves[session->nbLegalMoves]) { session->nbLegalMoves++; }
+        memcpy(session->legalMoves, moves, sizeof(Move) * (session->nbLegalMoves + 1));
+    }
+}
+
+static void reserveSessionPlies(GameSession* session, int nbPlies) {
+    if (nbPlies < session->capacity) { return; }
+    while (nbPlies >= session->capacity) { session->capacity *= 2; }
+    session->previousStates = realloc(session->previousStates, sizeof(GameState) * (session->capacity + 1));
+    session->moves = realloc(session->moves, sizeof(Move) * session->capacity);
+    session->keys = realloc(session->keys, sizeof(u64) * (session->capacity + 1));
+    assert(session->previousStates != NULL && session->moves != NULL && session->keys != NULL && "Malloc failed so buy more RAM lol");
+}
+
+GameSession* createGameSession(const char* fen) {
+    GameState state;
+    if (!setGameStateFromFenString(fen, &state)) { return NULL; }
+
+    GameSession* session = malloc(sizeof(GameSession));
+    assert(session != NULL && "Malloc failed so buy more RAM lol");
+    session->state = state;
+    session->nbPlies = 0;
+    session->capacity = INITIAL_CAPACITY;
+    session->previousStates = malloc(sizeof(GameState) * (INITIAL_CAPACITY + 1));
+    session->moves = malloc(sizeof(Move) * INITIAL_CAPACITY);
+    session->keys = malloc(sizeof(u64) * (INITIAL_CAPACITY + 1));
+    assert(session->previousStates != NULL && session->moves != NULL && session->keys != NULL && "Malloc failed so buy more RAM lol");
+    memset(&session->previousStates[0], 0, sizeof(GameState));
+    session->keys[0] = state.zobristKey;
+    updateSession(session);
+
+    session->search.hasThread = false;
+    atomic_init(&session->search.stop, false);
+    atomic_init(&session->search.isSearching, false);
+    session->search.previousStates = NULL;
+    session->search.table = NULL;
+    return session;
+}
+
+void destroyGameSession(GameSession* session) {
+    if (session == NULL) { return; }
+    sessionSearchStop(session);
+    sessionSearchWait(session);
+    if (session->search.table != NULL) { freeTranspositionTable(session->search.table); }
+    free(session->previousStates);
+    free(session->moves);
+    free(session->keys);
+    free(session);
+}
+
+int sessionLegalMoves(const GameSession* session, Move results[MAX_LEGAL_MOVES + 1]) {
+    memcpy(results, session->legalMoves, sizeof(Move) * (session->nbLegalMoves + 1));
+    return session->nbLegalMoves;
+}
+
+bool sessionPlay(GameSession* session, Move move) {
+    bool isLegal = false;
+    for (int i = 0; i < session->nbLegalMoves && !isLegal; i++) {
+        isLegal = session->legalMoves[i] == move;
+    }
+    if (!isLegal) { return false; }
+
+    reserveSessionPlies(session, session->nbPlies + 1);
+    session->previousStates[session->nbPlies] = session->state;
+    session->moves[session->nbPlies] = move;
+    session->nbPlies++;
+    memset(&session->previousStates[session->nbPlies], 0, sizeof(GameState));
+    makeMove(move, &session->state);
+    session->keys[session->nbPlies] = session->state.zobristKey;
+    updateSession(session);
+    return true;
+}
+
+bool sessionPlayUci(GameSession* session, const char* uci) {
+    if (session->status != GAME_IN_PROGRESS) { return false; }
+    Move move = moveFromUci(&session->state, uci);
+    return move != 0 && sessionPlay(session, move);
+}
+
+bool sessionUndo(GameSession* session) {
+    if (session->nbPlies == 0) { return false; }
+    session->nbPlies--;
+    session->state = session->previousStates[session->nbPlies];
+    memset(&session->previousStates[session->nbPlies], 0, sizeof(GameState));
+    updateSession(session);
+    return true;
+}
+
+GameStatus sessionStatus(const GameSession* session) {
+    return session->status;
+}
+
+const GameState* sessionState(const GameSession* session) {
+    return &session->state;
+}
+
+const Move* sessionMoves(const GameSession* session, int* nbMoves) {
+    *nbMoves = session->nbPlies;
+    return session->moves;
+}
+
+const GameState* sessionPreviousStates(const GameSession* session) {
+    return session->previousStates;
+}
+
+static void* sessionSearchMain(void* data) {
+    SessionSearch* search = data;
+    search->result = searchPosition(&search->root, search->previousStates, search->limits, search->options, search->table);
+    atomic_store(&search->isSearching, false);
+    return NULL;
+}
+
+static int numberOfCores() {
+    long nbCores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nbCores < 1) { return 1; }
+    return nbCores < MAX_SESSION_SEARCH_THREADS ? (int) nbCores : MAX_SESSION_SEARCH_THREADS;
+}
+
+bool sessionSearchStart(GameSession* session, SearchLimits limits, SearchIterationCallback onIteration, void* userData) {
+    SessionSearch* search = &session->search;
+    if (atomic_load(&search->isSearching)) { return false; }
+    // A search that is done but that nobody waited for
+    sessionSearchWait(session);
+
+    if (search->table == NULL) { search->table = createTranspositionTable(SESSION_HASH_SIZE); }
+    search->root = session->state;
+    search->previousStates = malloc(sizeof(GameState) * (session->nbPlies + 1));
+    assert(search->previousStates != NULL && "Malloc failed so buy more RAM lol");
+    memcpy(search->previousStates, session->previousStates, sizeof(GameState) * (session->nbPlies + 1));
+
+    atomic_store(&search->stop, false);
+    search->limits = limits;
+    search->limits.stop = &search->stop;
+    search->limits.ponder = NULL;
+    search->options = defaultSearchOptions();
+    search->options.nbThreads = numberOfCores();
+    search->options.onIteration = onIteration;
+    search->options.userData = userData;
+
+    atomic_store(&search->isSearching, true);
+    int error = pthread_create(&search->thread, NULL, sessionSearchMain, search);
+    assert(error == 0 && "Could not start the search thread");
+    (void) error;
+    search->hasThread = true;
+    return true;
+}
+
+void sessionSearchStop(GameSession* session) {
+    atomic_store(&session->search.stop, true);
+}
+
+SearchResult sessionSearchWait(GameSession* session) {
+    SessionSearch* search = &session->search;
+    SearchResult result = { 0 };
+    if (!search->hasThread) { return result; }
+    pthread_join(search->thread, NULL);
+    search->hasThread = false;
+    free(search->previousStates);
+    search->previousStates = NULL;
+    return search->result;
+}
+
+bool sessionIsSearching(const GameSession* session) {
+    return atomic_load(&session->search.isSearching);
+}
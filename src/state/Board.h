@@ -8,36 +8,21 @@
 
 /**
  * A struct which holds the information of the chess board, so which piece is at which square.
- * Use the pieceAtIndex function to extract that information
+ * Use the pieceAtIndex function to extract that information.
+ * The squares of a piece are the intersection of its type and its color bitboards. That is 8 bitboards instead of
+ * one per piece, so that the board fits in a single 64 byte cache line
 */
 typedef struct Board {
-    /* Order of the bitBoard in the array 
-
-    0 -> White King
-    1 -> White Knight
-    2 -> White Bishop
-    3 -> White Queen
-    4 -> White Rook
-    5 -> White Pawn
-
-    6 -> UNUSED
-    7 -> UNUSED
-
-    8 -> Black King
-    9 -> Black Knight 
-    10 -> Black Bishop
-    11 -> Black Queen
-    12 -> Black Rook
-    13 -> Black Pawn
-    */
-   u64 bitboards[14];
-   // I put 14 total bitboards, even though we only need 12, so that I can assign each piece to a index quickly.
-   // The formula for assigning a piece to an index in the array (the hashing function) is (piece - 9)
-   // This works well for WHITE pieces, as (white piece - 9) will yield results from 0 to 5
-   // However, (black piece - 9) will yield results from 8 to 13
-   // Thus, index 6 and 7 are invalid in the array
+    // The squares of each piece type, for both colors, indexed with (type - 1): king, knight, bishop, queen, rook, pawn
+    u64 pieces[6];
+    // The squares of each color, indexed with (color >> 4): white, black
+    u64 colors[2];
 } Board;
 
+// Where a piece is in Board.pieces and Board.colors. Same as pieceType(piece) - 1 and pieceColor(piece) >> 4, without the calls
+#define PIECE_TYPE_INDEX(piece) (((piece) & 0b111) - 1)
+#define PIECE_COLOR_INDEX(piece) (((piece) >> 4) & 1)
+
 /**
  * Returns the bit board of a specific piece
 */
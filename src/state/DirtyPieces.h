@@ -0,0 +1,21 @@
+#ifndef DIRTY_PIECES_H
+#define DIRTY_PIECES_H
+
+#include <stdbool.h>
+#include "Piece.h"
+
+// Castling is the move that changes the most pieces: the king and the rook are both removed and added back
+#define MAX_DIRTY_PIECES 4
+
+/**
+ * The pieces that were added or removed from the board by the last call to makeMove.
+ * This lets the NNUE accumulators be updated with deltas instead of being recomputed from the whole board.
+*/
+typedef struct DirtyPieces {
+    unsigned char nbDirtyPieces;
+    Piece pieces[MAX_DIRTY_PIECES];
+    char indices[MAX_DIRTY_PIECES];
+    bool added[MAX_DIRTY_PIECES];
+} DirtyPieces;
+
+#endif
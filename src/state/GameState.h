@@ -2,17 +2,26 @@
 #define BDF83061_7504_461E_BCDD_602085692048
 
 #include <stddef.h>
+#include <stdint.h>
 #include "Board.h"
+#include "DirtyPieces.h"
+#include "../evaluation/PieceSquareTables.h"
 
 typedef struct {
-    Board board;
-    PieceCharacteristics colorToGo;
-    int castlingPerm, // The first bit is for white king side, second bit is for white queen side and pattern continues but for black
-        enPassantTargetSquare, 
-        turnsForFiftyRule, 
-        nbMoves;
+    Board board; // The first cache line
+    u64 zobristKey; // Zobrist hash of the whole position, kept up to date by makeMove
+    u64 pawnKey; // Zobrist hash of the pawns only, kept up to date by makeMove
+    PieceSquareScore pieceSquareScore; // Kept up to date by makeMove, use it through the evaluate function
+    DirtyPieces dirtyPieces; // What the last makeMove changed on the board
+    uint16_t nbMoves;
+    uint8_t colorToGo; // WHITE or BLACK, 0 marks the end of an array of states
+    uint8_t castlingPerm; // The first bit is for white king side, second bit is for white queen side and pattern continues but for black
+    int8_t enPassantTargetSquare; // -1 when there is none
+    uint8_t turnsForFiftyRule; // Stops at 255, the position is a draw from 100 anyway
 } GameState;
 
+_Static_assert(sizeof(GameState) <= 128, "A GameState should fit in two cache lines");
+
 /**
  * Returns the number of elements in an array of gamestates.
  * Assumes that the last element of the array is 0
@@ -0,0 +1,39 @@
+#ifndef PACKED_POSITION_H
+#define PACKED_POSITION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "GameState.h"
+
+#define NO_PACKED_EN_PASSANT BOARD_SIZE
+
+/**
+ * A position in 32 bytes, to store large numbers of them (a GameState is 112 bytes).
+ * Only the occupied squares get a piece code, so the format holds at most 32 pieces.
+ * The same position always gives the same bytes, since the unused codes and the reserved bytes are 0
+*/
+typedef struct PackedPosition {
+    u64 occupancy; // The squares with a piece
+    uint8_t pieces[16]; // One 4 bit code per occupied square, in the order of the occupancy bits and low nibble first. The code is the piece - 8
+    uint16_t nbMoves;
+    uint8_t turnsForFiftyRule;
+    uint8_t sideAndCastling; // Bits 0-3: the castling perm as in GameState, bit 4: black to move
+    uint8_t enPassantTargetSquare; // NO_PACKED_EN_PASSANT when there is none
+    uint8_t reserved[3];
+} PackedPosition;
+
+_Static_assert(sizeof(PackedPosition) == 32, "A packed position should be 32 bytes");
+
+/**
+ * Returns false if the position has more than 32 pieces, which does not fit
+*/
+bool packPosition(const GameState* state, PackedPosition* result);
+
+/**
+ * Rebuilds the whole GameState, with its hashes and its piece square score.
+ * Returns false if the packed position is not valid: a code that is not a piece, a side without exactly one king,
+ * or a non zero unused code or reserved byte
+*/
+bool unpackPosition(const PackedPosition* packed, GameState* result);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "Board.h"
+
+/**
+ * Random keys used to hash positions.
+ * The rows are indexed with (piece - 9), so the key of a piece on a square is zobristPieceKeys[piece - 9][index]:
+ * rows 0 to 5 are the white pieces and rows 8 to 13 the black ones, in the order of PIECE_TYPE_INDEX. Rows 6 and 7 are not pieces.
+ * The squares of a piece are board.pieces[PIECE_TYPE_INDEX(piece)] & board.colors[PIECE_COLOR_INDEX(piece)]
+ * The keys were generated by precomputedMasks/zobristGeneration.c
+*/
+extern u64 zobristPieceKeys[14][BOARD_SIZE];
+extern u64 zobristCastlingKeys[16]; // Indexed with the castling perm
+extern u64 zobristEnPassantKeys[BOARD_LENGTH]; // Indexed with the file of the en-passant target square
+extern u64 zobristBlackToMoveKey;
+
+/**
+ * Returns the hash of the pawns only (board.pieces[PAWN - 1] of both colors, with the key rows 5 and 13).
+ * The pawn key changes only when a pawn moves, gets captured or promotes,
+ * which makes it a good key for caching the pawn structure evaluation
+*/
+u64 pawnKeyFromBoard(Board board);
+
+/**
+ * Returns the hash of the whole position, which is what GameState.zobristKey holds
+*/
+u64 zobristKeyFromPosition(Board board, PieceCharacteristics colorToGo, int castlingPerm, int enPassantTargetSquare);
+
+#endif
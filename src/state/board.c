@@ -2,59 +2,42 @@
 
 Piece pieceAtIndex(Board board, int index) {
 
-    Piece K = ((board.bitboards[0] >> index) & 1UL) * makePiece(WHITE, KING);
-    Piece N = ((board.bitboards[1] >> index) & 1UL) * makePiece(WHITE, KNIGHT);
-    Piece B = ((board.bitboards[2] >> index) & 1UL) * makePiece(WHITE, BISHOP);
-    Piece Q = ((board.bitboards[3] >> index) & 1UL) * makePiece(WHITE, QUEEN);
-    Piece R = ((board.bitboards[4] >> index) & 1UL) * makePiece(WHITE, ROOK);
-    Piece P = ((board.bitboards[5] >> index) & 1UL) * makePiece(WHITE, PAWN);
-
-    Piece k = ((board.bitboards[8 ] >> index) & 1UL) * makePiece(BLACK, KING);
-    Piece n = ((board.bitboards[9 ] >> index) & 1UL) * makePiece(BLACK, KNIGHT);
-    Piece b = ((board.bitboards[10] >> index) & 1UL) * makePiece(BLACK, BISHOP);
-    Piece q = ((board.bitboards[11] >> index) & 1UL) * makePiece(BLACK, QUEEN);
-    Piece r = ((board.bitboards[12] >> index) & 1UL) * makePiece(BLACK, ROOK);
-    Piece p = ((board.bitboards[13] >> index) & 1UL) * makePiece(BLACK, PAWN);
-
-    return (Piece) (K + Q + N + B + R + P +
-                    k + q + n + b + r + p);
+    Piece K = ((board.pieces[0] >> index) & 1UL) * KING;
+    Piece N = ((board.pieces[1] >> index) & 1UL) * KNIGHT;
+    Piece B = ((board.pieces[2] >> index) & 1UL) * BISHOP;
+    Piece Q = ((board.pieces[3] >> index) & 1UL) * QUEEN;
+    Piece R = ((board.pieces[4] >> index) & 1UL) * ROOK;
+    Piece P = ((board.pieces[5] >> index) & 1UL) * PAWN;
+
+    Piece white = ((board.colors[0] >> index) & 1UL) * WHITE;
+    Piece black = ((board.colors[1] >> index) & 1UL) * BLACK;
+
+    // An empty square has no type and no color, so this is NOPIECE
+    return (Piece) (K + N + B + Q + R + P + white + black);
 }
 
 u64 bitBoardForPiece(Board board, Piece piece) {
-    int arrayIndex = piece - 9; // The best hash function there is!
-    return board.bitboards[arrayIndex];
+    return board.pieces[PIECE_TYPE_INDEX(piece)] & board.colors[PIECE_COLOR_INDEX(piece)];
 }
 
 u64 whitePiecesBitBoard(Board board) {
-    return 
-    board.bitboards[0] | 
-    board.bitboards[1] |
-    board.bitboards[2] | 
-    board.bitboards[3] |
-    board.bitboards[4] | 
-    board.bitboards[5];
+    return board.colors[0];
 }
 
 u64 blackPiecesBitBoard(Board board) {
-    return 
-    board.bitboards[8 ] | 
-    board.bitboards[9 ] |
-    board.bitboards[10] | 
-    board.bitboards[11] |
-    board.bitboards[12] | 
-    board.bitboards[13];
+    return board.colors[1];
 }
 
 u64 allPiecesBitBoard(Board board) {
-    return whitePiecesBitBoard(board) | blackPiecesBitBoard(board);
+    return board.colors[0] | board.colors[1];
 }
 
 void togglePieceAtIndex(Board* board, int index, Piece piece) {
     u64 toggle = (u64) 1; // I need to do this else the shift overflows the 32 bits of int
     toggle <<= index;
 
-    int arrayIndex = piece - 9; // The best hash function there is!
-    board->bitboards[arrayIndex] ^= toggle;
+    board->pieces[PIECE_TYPE_INDEX(piece)] ^= toggle;
+    board->colors[PIECE_COLOR_INDEX(piece)] ^= toggle;
 }
 
 void handleMove(Board* board, int from, int to) {
@@ -77,4 +60,4 @@ void fromArray(Board* result, Piece array[BOARD_SIZE]) {
             togglePieceAtIndex(result, index, piece);
         }
     }
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "GameState.h"
+#include "Zobrist.h"
 #include "stdlib.h"
 #include "assert.h"
 
@@ -27,5 +28,8 @@ GameState* createState(
     result->enPassantTargetSquare = enPassantTargetSquare;
     result->nbMoves = nbMoves;
     result->turnsForFiftyRule = turnsForFiftyRule;
+    result->pieceSquareScore = pieceSquareScoreFromBoard(board);
+    result->pawnKey = pawnKeyFromBoard(board);
+    result->zobristKey = zobristKeyFromPosition(board, colorToGo, castlingPerm, enPassantTargetSquare);
     return result;
 }
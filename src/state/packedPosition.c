@@ -0,0 +1,79 @@
+#include <string.h>
+#include "PackedPosition.h"
+#include "Zobrist.h"
+
+#define MAX_PACKED_PIECES 32
+#define BLACK_TO_MOVE_BIT (1 << 4)
+
+bool packPosition(const GameState* state, PackedPosition* result) {
+    memset(result, 0, sizeof(PackedPosition));
+
+    // The codes go on a mailbox first, so that they can be read in the order of the occupancy bits
+    uint8_t codes[BOARD_SIZE];
+    const Board* board = &state->board;
+    for (PieceCharacteristics color = WHITE; color <= BLACK; color += WHITE) {
+        for (PieceCharacteristics type = KING; type <= PAWN; type++) {
+            Piece piece = makePiece(color, type);
+            uint8_t code = (uint8_t) (piece - 8);
+            u64 bitboard = board->pieces[PIECE_TYPE_INDEX(piece)] & board->colors[PIECE_COLOR_INDEX(piece)];
+            while (bitboard) {
+                codes[trailingZeros_64(bitboard)] = code;
+                bitboard &= bitboard - 1;
+            }
+        }
+    }
+
+    u64 occupancy = board->colors[0] | board->colors[1];
+    int index = 0;
+    for (u64 remaining = occupancy; remaining; remaining &= remaining - 1, index++) {
+        if (index == MAX_PACKED_PIECES) { return false; }
+        result->pieces[index >> 1] |= codes[trailingZeros_64(remaining)] << ((index & 1) * 4);
+    }
+    result->occupancy = occupancy;
+    result->nbMoves = state->nbMoves;
+    result->turnsForFiftyRule = state->turnsForFiftyRule;
+    result->sideAndCastling = (uint8_t) ((state->castlingPerm & 0xF) | (state->colorToGo == BLACK ? BLACK_TO_MOVE_BIT : 0));
+    bool hasEnPassant = state->enPassantTargetSquare >= 0 && state->enPassantTargetSquare < BOARD_SIZE;
+    result->enPassantTargetSquare = (uint8_t) (hasEnPassant ? state->enPassantTargetSquare : NO_PACKED_EN_PASSANT);
+    return true;
+}
+
+bool unpackPosition(const PackedPosition* packed, GameState* result) {
+    GameState state;
+    memset(&state, 0, sizeof(GameState));
+
+    int index = 0;
+    for (u64 remaining = packed->occupancy; remaining; remaining &= remaining - 1, index++) {
+        if (index == MAX_PACKED_PIECES) { return false; }
+        int code = (packed->pieces[index >> 1] >> ((index & 1) * 4)) & 0xF;
+        // 7 and 8 are not pieces
+        if (code == 0 || code == 7 || code == 8 || code > 14) { return false; }
+        Piece piece = (Piece) (code + 8);
+        state.board.pieces[PIECE_TYPE_INDEX(piece)] |= remaining & -remaining;
+        state.board.colors[PIECE_COLOR_INDEX(piece)] |= remaining & -remaining;
+    }
+    // The codes after the last piece and the reserved bytes are 0, so that a position has a single encoding
+    for (; index < MAX_PACKED_PIECES; index++) {
+        if ((packed->pieces[index >> 1] >> ((index & 1) * 4)) & 0xF) { return false; }
+    }
+    for (int i = 0; i < (int) sizeof(packed->reserved); i++) {
+        if (packed->reserved[i] != 0) { return false; }
+    }
+    if (packed->sideAndCastling >> 5 || packed->enPassantTargetSquare > NO_PACKED_EN_PASSANT) { return false; }
+    // The move generator needs one king per side
+    u64 kings = state.board.pieces[PIECE_TYPE_INDEX(KING)];
+    for (int color = 0; color < 2; color++) {
+        if (__builtin_popcountll(kings & state.board.colors[color]) != 1) { return false; }
+    }
+
+    state.colorToGo = packed->sideAndCastling & BLACK_TO_MOVE_BIT ? BLACK : WHITE;
+    state.castlingPerm = packed->sideAndCastling & 0xF;
+    state.enPassantTargetSquare = packed->enPassantTargetSquare == NO_PACKED_EN_PASSANT ? -1 : packed->enPassantTargetSquare;
+    state.turnsForFiftyRule = packed->turnsForFiftyRule;
+    state.nbMoves = packed->nbMoves;
+    state.pieceSquareScore = pieceSquareScoreFromBoard(state.board);
+    state.pawnKey = pawnKeyFromBoard(state.board);
+    state.zobristKey = zobristKeyFromPosition(state.board, state.colorToGo, state.castlingPerm, state.enPassantTargetSquare);
+    *result = state;
+    return true;
+}
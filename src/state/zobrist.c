@@ -0,0 +1,55 @@
+#include "Zobrist.h"
+
+u64 zobristPieceKeys[14][BOARD_SIZE] = {
+    {13898507668257350876UL, 9874931141998527612UL, 12936763147494389601UL, 7639117502952287850UL, 325179382338061662UL, 17399041339907576624UL, 4115426874723844861UL, 5453732345331108626UL, 3839165049266763918UL, 15694810598937643278UL, 10817554802500690460UL, 41846630148674041UL, 16366395745596520156UL, 7133257775902314778UL, 6540083395930555764UL, 1463766826699043846UL, 8804815205429065617UL, 6143180072725862254UL, 1643515164325499881UL, 3240605236427442329UL, 14540194908635717891UL, 15492261819298327149UL, 5987859613231975873UL, 8352659552286349527UL, 1163920986496778190UL, 17588872178062459710UL, 8193804950055925015UL, 15736128439712964608UL, 5110305787111611169UL, 12842813209256687256UL, 7478506533742953657UL, 9130034581096371000UL, 10954853570616692476UL, 2226523376072239528UL, 13561805596772808438UL, 14859794972210306008UL, 2763833736329500107UL, 18237688194517164885UL, 15669862833025716218UL, 3706031098901187636UL, 1655237160514015849UL, 15743696185712264809UL, 2201407405407492126UL, 4514437693490586938UL, 11565420279436541305UL, 4929648960252679375UL, 13644661475150698044UL, 13000331490634888887UL, 565889284516074338UL, 4123754349030635032UL, 12947295821869480972UL, 7217639690680675475UL, 6087704238237761443UL, 8614800812426132541UL, 12817927922189783595UL, 5330953087010632451UL, 6783647882334439347UL, 2263086183090877979UL, 12495594931918813951UL, 16057517559715346953UL, 1015595768257846520UL, 7445656177367323755UL, 17314055458139845205UL, 16418427365271693196UL},
+    {7089947521173271468UL, 6806960399743637368UL, 7765026208686517555UL, 2993583992028408877UL, 9917281417174697615UL, 554348299859171940UL, 8452021921220907135UL, 10613172546200690764UL, 11649484749071854523UL, 18400198269550744981UL, 3649501227320078035UL, 15679016174131821905UL, 15695072713097221705UL, 4862250251420738148UL, 3529212822908849617UL, 12301152497020132102UL, 7280377845793041658UL, 5888754509200077931UL, 9406279099916342964UL, 9848948554211746299UL, 590998641885070459UL, 16349566594877954900UL, 15990372561479324463UL, 6291995806401459165UL, 13771754639177012029UL, 8446306566090771882UL, 11465221608349879959UL, 4040695586609614425UL, 15310378204631981123UL, 15597136486311239046UL, 2740414804484374611UL, 4357941799013338247UL, 10123894027787429051UL, 17098518832938053511UL, 3947811036636571417UL, 637282664094332514UL, 12428903180849491908UL, 16076593256987831527UL, 7065839892376979863UL, 4094298968889531237UL, 16652351513170380563UL, 11441057460238462268UL, 17675460351301907264UL, 7248750725659991539UL, 1841520771133231010UL, 11835413491144011927UL, 3867859799415292314UL, 3386728485527279884UL, 1540021999801762908UL, 4551849002188372409UL, 5436517761368757802UL, 11700745411359090495UL, 13233532771168008351UL, 10234028037123269897UL, 2531952789098799418UL, 7233301901896630969UL, 11260347924694380819UL, 10654969769632607648UL, 9856203830713400688UL, 8132002568138338510UL, 8842912169884158666UL, 14474140949307755496UL, 6869722121529204186UL, 15951960444715429052UL},
+    {4394417728915448936UL, 4637180434826582146UL, 5613713990462439208UL, 9720195606727480410UL, 1086078824807780454UL, 2056678507806353267UL, 2137209309430473543UL, 1770157442308019175UL, 3105987960117087743UL, 12910437103183570924UL, 11508369117039159896UL, 4429562433348552223UL, 1747842561023221652UL, 11640263149574730142UL, 7142316189960712720UL, 4443752424880735657UL, 103618768034245590UL, 18039690051055585612UL, 3012205650034114862UL, 10166251982720108968UL, 10739743558259270560UL, 9470147470384504702UL, 4640378727882507496UL, 13383269510878240153UL, 8878719750299221444UL, 5610682305600053608UL, 12047927489193178224UL, 8487262825339274771UL, 7459544358211693941UL, 18431691642159634409UL, 14335540982214530194UL, 4526887521483305774UL, 15050059173674755712UL, 5854555105197667489UL, 4838054902480923954UL, 8988805449518324298UL, 7597696977996016890UL, 15946023249614999287UL, 1153502751748303343UL, 12614866125012255170UL, 1444023475014747419UL, 14859425673586397433UL, 8519565999928546780UL, 1045407399658687716UL, 9961849235597053294UL, 3581375407725086086UL, 17658230161511677595UL, 7782858545425283209UL, 8724781253987841860UL, 13213428228203433666UL, 2007238499217382904UL, 496773753088181054UL, 18439464047038379657UL, 17472047990257159829UL, 3075237216533415864UL, 965069030643838154UL, 3093844054513899213UL, 13289170701158749230UL, 16743887505575458935UL, 12969036989450917026UL, 12433598269541733892UL, 12244940595632534792UL, 17616920880756292016UL, 11887049684648653437UL},
+    {13842852533373364613UL, 9874034327214587279UL, 15492518680004920920UL, 14184680437782906650UL, 10959610458232691924UL, 4774599669815198949UL, 546728972839697501UL, 241449089209640345UL, 16691831089425346011UL, 3691440748342801896UL, 10719004175529085284UL, 17150555858232769111UL, 13529806161099653868UL, 14229804435269148605UL, 13468663850566115042UL, 11465841161670786722UL, 4054833311031837168UL, 2234456445847813350UL, 5197352850134212060UL, 8633723309085419003UL, 11859654564340616413UL, 6693512203228965992UL, 1008071489532312692UL, 6269087344532165603UL, 6589636849405353732UL, 7921745150660377244UL, 11323527436705591561UL, 16136911879459066907UL, 12071547889568909582UL, 11280013300791621129UL, 3268867536389974801UL, 8357550599024542499UL, 16160488426592957654UL, 12931157366352418408UL, 17173282938316189084UL, 211131483792817447UL, 4886810257532153560UL, 15095885283211439654UL, 13681692168764725759UL, 17994555439778460275UL, 14830456690988301147UL, 12568974666260378709UL, 12006850008018975551UL, 15587637484478461465UL, 4877544980808613404UL, 8172523981617192551UL, 17726688002045315502UL, 11304533081683935323UL, 10258434742362971248UL, 6689608836280199800UL, 4966619549354572340UL, 4111556515464255906UL, 16134821953249763487UL, 13201221973062425177UL, 14119752456716615327UL, 4628765836781402933UL, 2559516837920442219UL, 7195670606762695043UL, 2677144869469589934UL, 15845591530796739030UL, 17580121602818078343UL, 139488861688318646UL, 9163265253871663388UL, 18252169115270108022UL},
+    {3553942473369608181UL, 11030904745098725359UL, 4496537817944350619UL, 6706398543123560538UL, 13382336223231295418UL, 10222608213467975280UL, 5395526292898474409UL, 10725128453077782861UL, 10404373567472224501UL, 12077621121540760515UL, 5407908937041377902UL, 18276862084974694344UL, 11131006468369461262UL, 12075013114846974293UL, 66508973043824629UL, 5548081805705819336UL, 3052944287273307328UL, 637568700841418209UL, 2959898277950728366UL, 14605909410089605145UL, 3413108819437465124UL, 7654961436115409048UL, 9138586502909977986UL, 18074290951918379258UL, 7575988066642825110UL, 5052645366721921944UL, 3019852129311265937UL, 3904757861484663320UL, 6789349272306047977UL, 3205758077685786487UL, 3453633228599254148UL, 17889181158723055634UL, 4991013577261392283UL, 13718598170993072613UL, 1777895545141908256UL, 647572144252681015UL, 2050966262263112021UL, 7130359273892246116UL, 5729284015075274518UL, 3224191325173128260UL, 5611515820284905097UL, 14957645878388714247UL, 9232368925412646232UL, 5857816775368059053UL, 6271101990710628753UL, 3731416803504301249UL, 4137871478866254831UL, 9264994612905759460UL, 4885158698726110331UL, 7233328245988732676UL, 9076893561378351754UL, 4465781174974196144UL, 8363574955847061997UL, 11861357715082162094UL, 13615130677336908541UL, 6191418277137300419UL, 9237843978910298088UL, 18231972874075093967UL, 9479318540466932368UL, 16395613670102403753UL, 16106200091681200260UL, 12038615189069502134UL, 1703297667409066314UL, 2841093378434826989UL},
+    {13105396942332181950UL, 16182580149916498068UL, 5323874443336537940UL, 16026787436756289038UL, 3857257263702902311UL, 277457953669765318UL, 5197069990287320471UL, 12959783720097737852UL, 11392683793040480131UL, 4968418065590476246UL, 15921263062095033799UL, 315452676657279593UL, 11411607754528993132UL, 14830508624788360958UL, 5191341559807679304UL, 3516483314558604579UL, 4826044045955710798UL, 2384671627793275765UL, 16413088081501269061UL, 3103312370304129085UL, 12323056300107446473UL, 4095499070820569390UL, 13382505941693134625UL, 13280233181235486026UL, 8034330808965157264UL, 4591804378453551032UL, 15281889607537856581UL, 4938526214934675718UL, 17153188439097238040UL, 4707245510435703815UL, 2197025677157846482UL, 16569595168211841589UL, 2218741832248965118UL, 8827706496262729741UL, 320876298407925286UL, 5373670582934378357UL, 1562995027003764824UL, 12464719121632387899UL, 18429759186104702024UL, 3789710990740579768UL, 2806278127358582165UL, 9877993789039182335UL, 8374617578765346247UL, 4052541419252099715UL, 3646985333617028709UL, 18071082399136936241UL, 8350722072852518323UL, 4080603199661533476UL, 13531851411798710500UL, 7438326053172555936UL, 10900777964192342390UL, 17126366918274967541UL, 16684298085375415923UL, 11302657040583433276UL, 17836639200194098573UL, 3884036541821808672UL, 4309164237269050571UL, 12320892525100829007UL, 14129691989521799064UL, 13461531755054295514UL, 14511197140508300751UL, 7339046271560468944UL, 6195287174735264824UL, 11731494207769599934UL},
+    {0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL},
+    {0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL, 0UL},
+    {8341766627684089370UL, 12823271258405637026UL, 12873790880483620564UL, 3543233952470397088UL, 18441642257294828953UL, 11303702376350284672UL, 18243076078299667311UL, 5511631814855571468UL, 3634266814471416973UL, 11694874509593863154UL, 18021281635148165502UL, 14646517571013638450UL, 5708279895922398651UL, 1128819123890192069UL, 10957430503815079838UL, 4493140265602167532UL, 17235202155048817566UL, 18407249469010803663UL, 782621491953260990UL, 12112933819078968483UL, 11945684535467408864UL, 9399017288035585527UL, 4597239860854803884UL, 13750950055956121797UL, 16996936268218699533UL, 459357438159123841UL, 7642754841772139449UL, 6348973767460511324UL, 5869230685140332734UL, 8634544762431841928UL, 2096317793283618657UL, 7293148738974768382UL, 12508548795014419038UL, 743096728054977598UL, 18113189781569346055UL, 4893773602738830538UL, 17667497975299714924UL, 6330932983777940688UL, 12960213936046891257UL, 13978633344827813964UL, 884425026562731354UL, 1742229975042185897UL, 8449680335014716459UL, 6597038299794065192UL, 8834033568840762182UL, 12199855246742850570UL, 6860261033973112475UL, 15710742798368955370UL, 17244152989049755458UL, 14025072533552710251UL, 102985763631233477UL, 15944657209125880440UL, 13599527163374456256UL, 4972133197611674378UL, 1547411523105935073UL, 7966207008786344093UL, 7192283164581390983UL, 2220721079455955725UL, 7825776357406658073UL, 6016379491498714424UL, 15190297335225422597UL, 2951878786614231508UL, 3136051995161539157UL, 11591738834739746085UL},
+    {11888516309879366242UL, 1725093063116222764UL, 18276818079491709319UL, 7693357456191555317UL, 16336459392902101935UL, 13927470563257764956UL, 1700277383499643458UL, 6663282945340409977UL, 5943070334023535128UL, 17250859128993762497UL, 12811562668409931367UL, 16266293928040368289UL, 15303629323330661660UL, 16280805850355294637UL, 17042257765593289443UL, 2725703451694270287UL, 13879346173611472352UL, 12859086663859162114UL, 14084954614059602330UL, 2113697295057295640UL, 15130692383687768248UL, 17836184229322371059UL, 13660434994667688300UL, 2664122685386802646UL, 3118095084589003110UL, 2625687677437908518UL, 14632798345394450142UL, 12642121934867662736UL, 13385739265767912932UL, 488888779404187806UL, 9477431166624888375UL, 6052449938144371290UL, 16119010943985520334UL, 16597499144555116157UL, 12498200635906629128UL, 17885695579245100789UL, 5716029903291919981UL, 3490537618481535202UL, 2220712551761149624UL, 17836467965582943700UL, 564156677154720473UL, 18281544758586638653UL, 17199398098148363083UL, 16078115459149176669UL, 6177333410969122018UL, 8955301716485771477UL, 8435592187465407447UL, 8818039625927321572UL, 567453433694548113UL, 11772583598657584481UL, 10848691896656981858UL, 11118673998162971357UL, 570094523099128161UL, 332134325766993363UL, 16083954509246861229UL, 6349626964336303060UL, 12621347446315148711UL, 6809268278692938881UL, 14209264155141846269UL, 1239687510597462127UL, 711954940029851890UL, 15341441342780088172UL, 2083927901477425874UL, 18252358403405261829UL},
+    {6612277524351420153UL, 8390843518741740294UL, 2696509993483756627UL, 17151941889256495384UL, 7783315316345791687UL, 7431074339670710870UL, 1540477429185056908UL, 4729435341492082829UL, 2797276624434498137UL, 11901808388151735711UL, 8519634019277697528UL, 327894393122113759UL, 9420394734446530551UL, 16048194985368833828UL, 15599378964173828455UL, 6940449134801548303UL, 9037509177188709897UL, 12723065402921675570UL, 9774386542318305774UL, 8294906124823889433UL, 1487808338635441483UL, 10697653309961539468UL, 8772996800660781366UL, 250067367960221448UL, 11639975328327777546UL, 8728119677272662725UL, 7819031299265638625UL, 16477637406088037760UL, 2400738536446966600UL, 11253589902535733984UL, 17601530883350460633UL, 2848836472334624194UL, 13109638663007453198UL, 15017586265209277625UL, 3980867825190070514UL, 16499004690874731807UL, 4858149996156975486UL, 18207526611253077824UL, 11127376896878090806UL, 11161603944311028154UL, 6794722258676593321UL, 8423786876951089926UL, 8498994100062442199UL, 5492997309311206572UL, 10834232665785678886UL, 13646645145439717940UL, 3005235166373606843UL, 4857358169172632151UL, 5434841455487108249UL, 1166507884454155025UL, 12734425829625643404UL, 5227316750985693861UL, 7919201578123695005UL, 18296477404697036378UL, 1365077675349158422UL, 2338945644994773367UL, 15643006224070119838UL, 11630122000281600448UL, 10140411323803848380UL, 2617035652504435884UL, 15544777968245876088UL, 14337502929841739993UL, 1541698716950590217UL, 1888865256034597144UL},
+    {16055516099020957744UL, 7017999311426358550UL, 10876045715613915859UL, 6106620635492345991UL, 16127784148215545251UL, 16888574045377846531UL, 1745400989407949972UL, 10990917124697286892UL, 813713788701979619UL, 8349642991894604811UL, 12205415018271127111UL, 6209438852616383195UL, 2732671443834813832UL, 11956157905159738218UL, 2950775307813475810UL, 1143609561822537432UL, 11715098753962471611UL, 3364458680457906708UL, 13654624177788462252UL, 16581603377749657069UL, 12022535011558950493UL, 11106188289511454534UL, 12062418383973536911UL, 16208271055900910476UL, 18376460943936876436UL, 742818325409918023UL, 15634821930690319347UL, 6836128554892812818UL, 11444285924863367059UL, 14900450848923950082UL, 1529608353855523492UL, 7276372005498953743UL, 7940092176707855259UL, 9314937686909527654UL, 18188335491243632389UL, 2886809718236554805UL, 829608086408782240UL, 15980175290839211090UL, 4649957692223629676UL, 5680050959259759539UL, 11665968157629852474UL, 9912564423281491746UL, 9335249706926688854UL, 12598461820570180798UL, 10209191830309467943UL, 13786955567907488306UL, 5402742815512855380UL, 8068449981063384589UL, 15250156244986183656UL, 17560584409350042754UL, 6950743566140002299UL, 17695340256960151602UL, 11500326698204510750UL, 16300487479314283523UL, 5074512462475548506UL, 10745928962838188697UL, 596637575591826895UL, 16230951383571558609UL, 10455072466179423108UL, 1499420297317562111UL, 12972630395909853795UL, 8676273369502997377UL, 14210912789484380398UL, 12159538991094849484UL},
+    {7029176040948758884UL, 2020803355298225012UL, 12450868250474449937UL, 4499434602343136238UL, 2901576489692459891UL, 173175914784575914UL, 15637652632073999400UL, 13655292013117965649UL, 13561766144336791413UL, 8261668950426540419UL, 4040129761372004205UL, 2316903453560006823UL, 10875779832638629291UL, 6904850670729743214UL, 5023029168999847257UL, 14049356067821668449UL, 5838965960494645858UL, 17095357068982247173UL, 12976968389495750006UL, 7356091074804917635UL, 770778026574287887UL, 17271042224789452720UL, 1976043275790856425UL, 592555199869147995UL, 14380908740681312538UL, 11438572985586524398UL, 6368928417082833193UL, 2204538451666491803UL, 11347535850278455155UL, 8205605394201863907UL, 7630402062357599190UL, 13326824830894655723UL, 13484621687537535955UL, 18372273298230482313UL, 3366542921502956950UL, 15356202005702796554UL, 17236348098005869516UL, 6149644955433209062UL, 1443143111043519803UL, 8846477948297965818UL, 1129670874405620629UL, 5439011805156535954UL, 10412646618061288539UL, 16509232774873112235UL, 605558240362825132UL, 3594828017708050364UL, 1149350092458225921UL, 15137130254155365529UL, 15191319853774002059UL, 3526458277002697216UL, 14055165296187779381UL, 2156574819118221847UL, 18313612125520204327UL, 15764277523473652125UL, 7081501773879613703UL, 7498293206433215219UL, 9641585855344316845UL, 10358732745650962776UL, 2898459169478280912UL, 7912184182382961635UL, 16440489924008375554UL, 17916318425937265164UL, 93064316967297979UL, 15599537680133797627UL},
+    {11903098784004172057UL, 6508860601790636616UL, 12602216079895484244UL, 11123904772731593978UL, 3679474187533699278UL, 12462149768178297866UL, 621238300805850409UL, 1374041381482573725UL, 6385459060620353173UL, 9982461456969482798UL, 6935222183095244008UL, 1874108631967953415UL, 16175390700108817106UL, 14116526197196069193UL, 13154501843180748643UL, 6796946712227507171UL, 13645995334429883138UL, 7973141867471912310UL, 5347594478091347692UL, 16184841923677491789UL, 4505695254322251406UL, 10346478629600368847UL, 8734421380155823602UL, 15251709624064425932UL, 14002281874116874562UL, 2124782507311921161UL, 2066730044418430666UL, 6447972743933920641UL, 16757126864016250296UL, 1842470168922163624UL, 5999764239220580487UL, 6562643455796594431UL, 11878588495336859646UL, 13597729871204835328UL, 5862731805963643891UL, 1505072790241658020UL, 9342030714817883676UL, 9386630274387473605UL, 9631633024664480164UL, 3453091903528810436UL, 11320938710365863027UL, 15811223532005294310UL, 8816514833416855038UL, 14128234028954119233UL, 14228994922644210594UL, 3008881118112936709UL, 1486302005424857589UL, 5738910635305942360UL, 11356597948965611282UL, 6437894375726119970UL, 272333810952700013UL, 2410939236087724510UL, 7674322347955739062UL, 997867740457638974UL, 10771040308621712184UL, 11389602974464429305UL, 2131868671281551895UL, 9813409566040531246UL, 660902725067764732UL, 2186413961797550643UL, 17561782697825661742UL, 1374051799068637806UL, 13226311470110373716UL, 4637887001007560413UL}
+};
+u64 zobristCastlingKeys[16] = {0UL, 4242846683540456790UL, 5729398092942968517UL, 300430373015078298UL, 15437458372333345869UL, 16174202891918215728UL, 6207453742026885725UL, 2637021002607336449UL, 15311984676139918146UL, 3302393932823054052UL, 17015436123592252735UL, 16113157226527344639UL, 15261975441092364217UL, 520743706928868386UL, 10003633391489975281UL, 1501538955432320060UL};
+u64 zobristEnPassantKeys[BOARD_LENGTH] = {2549456579761413471UL, 17561802144244184527UL, 4773102837958094198UL, 10508139033268158486UL, 11533167103192138229UL, 12469858919744829600UL, 14546904047671257774UL, 14015174875412207397UL};
+u64 zobristBlackToMoveKey = 3771107577050506387UL;
+
+u64 pawnKeyFromBoard(Board board) {
+    u64 key = 0;
+    const int pawnBitBoardIndices[2] = { WHITE + PAWN - 9, BLACK + PAWN - 9 };
+    for (int i = 0; i < 2; i++) {
+        u64 bitboard = board.pieces[PAWN - 1] & board.colors[i];
+        while (bitboard) {
+            key ^= zobristPieceKeys[pawnBitBoardIndices[i]][trailingZeros_64(bitboard)];
+            bitboard &= bitboard - 1;
+        }
+    }
+    return key;
+}
+
+u64 zobristKeyFromPosition(Board board, PieceCharacteristics colorToGo, int castlingPerm, int enPassantTargetSquare) {
+    u64 key = 0;
+    for (int i = 0; i < 14; i++) {
+        if ((i & 7) >= 6) { continue; }
+        Piece piece = (Piece) (i + 9); // The rows of the keys are indexed with (piece - 9)
+        u64 bitboard = board.pieces[PIECE_TYPE_INDEX(piece)] & board.colors[PIECE_COLOR_INDEX(piece)];
+        while (bitboard) {
+            key ^= zobristPieceKeys[i][trailingZeros_64(bitboard)];
+            bitboard &= bitboard - 1;
+        }
+    }
+    key ^= zobristCastlingKeys[castlingPerm];
+    if (enPassantTargetSquare != -1) {
+        key ^= zobristEnPassantKeys[enPassantTargetSquare % 8];
+    }
+    if (colorToGo == BLACK) {
+        key ^= zobristBlackToMoveKey;
+    }
+    return key;
+}
@@ -0,0 +1,151 @@
+#ifndef ENDGAME_TABLE_H
+#define ENDGAME_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/GameState.h"
+#include "../utils/MappedFile.h"
+
+/*
+Endgame tables made by the tablebase generator, with the win/draw/loss and the distance to mate of every position.
+
+A table covers one material (like KQvKR) and both sides to move. The stronger side is always white in the table,
+positions where black is stronger are probed with the colors flipped.
+Positions are indexed with the squares of the pieces, using the symmetries of the board to reduce the size:
+- without pawns, the white king is moved in the a1-d1-d4 triangle (10 squares) by mirroring and flipping the board
+- with pawns, the white king is moved on the files a to d (32 squares) by mirroring the board
+The index is kingIndex * 64^(nbPieces - 1) + the squares of the other pieces, in the order of the material.
+
+The file format (all values are little endian):
+- a 64 bytes header, see EndgameTableHeader
+- the win/draw/loss: 2 bits per position (0: draw, 1: win, 2: loss, 3: not a legal position), side to move first
+- the index of the distance to mate blocks: one u32 offset per block of ENDGAME_DTM_BLOCK_SIZE positions,
+  the highest bit is set when the block is not compressed
+- the distance to mate blocks: moves to mate (1 byte, 0 for draws) run length encoded as (run length, value) pairs
+
+Probing reads 2 bits and decodes one block at most, so it takes a constant time.
+En passant and castling are not part of the tables.
+*/
+
+#define MAX_ENDGAME_PIECES 5
+#define ENDGAME_TABLE_EXTENSION ".ctb"
+#define ENDGAME_DTM_BLOCK_SIZE 64
+#define ENDGAME_DTM_RAW_BLOCK (1U << 31)
+
+typedef enum {
+    ENDGAME_DRAW = 0,
+    ENDGAME_WIN = 1,
+    ENDGAME_LOSS = 2,
+    ENDGAME_ILLEGAL = 3
+} EndgameWdl;
+
+typedef struct EndgameMaterial {
+    int nbPieces;
+    Piece pieces[MAX_ENDGAME_PIECES]; // White king, white pieces, black king, black pieces (queen, rook, bishop, knight, pawn)
+    bool hasPawns;
+    u64 nbPositionsPerSide;
+} EndgameMaterial;
+
+typedef struct EndgameTableHeader {
+    char magic[4]; // CTB1
+    uint32_t version;
+    uint32_t nbPieces;
+    uint32_t blockSize;
+    char pieces[8];
+    uint64_t nbPositionsPerSide;
+    uint64_t wdlOffset;
+    uint64_t dtmIndexOffset;
+    uint64_t dtmDataOffset;
+    uint64_t nbBlocks;
+} EndgameTableHeader;
+
+typedef struct EndgameTable {
+    MappedFile file;
+    EndgameMaterial material;
+    const unsigned char* wdl;
+    const unsigned char* dtmIndex;
+    const unsigned char* dtmData;
+    size_t dtmDataSize; // Up to the end of the file
+} EndgameTable;
+
+typedef struct EndgameProbe {
+    EndgameWdl wdl; // From the point of view of the side to move
+    int movesToMate; // 0 for draws and when the side to move is checkmated
+} EndgameProbe;
+
+/**
+ * Builds the material from a list of pieces, in any order. The colors are flipped if black is stronger,
+ * `colorsFlipped` tells if it happened (can be NULL). Returns false if there are not exactly one king per side or
+ * more than MAX_ENDGAME_PIECES pieces
+*/
+bool makeEndgameMaterial(const Piece* pieces, int nbPieces, EndgameMaterial* result, bool* colorsFlipped);
+
+/**
+ * Parses a material like KQvKR, returns false if it is invalid
+*/
+bool parseEndgameMaterial(const char* name, EndgameMaterial* result);
+
+/**
+ * Writes the name of the material (like KQvKR) in `name`, which needs at least 16 bytes
+*/
+void endgameMaterialName(const EndgameMaterial* material, char* name);
+
+bool isSameEndgameMaterial(const EndgameMaterial* a, const EndgameMaterial* b);
+
+/**
+ * The size of the win/draw/loss section and the number of distance to mate blocks of the table of `material`,
+ * both sides to move included
+*/
+u64 endgameWdlBytes(const EndgameMaterial* material);
+u64 endgameDtmBlocks(const EndgameMaterial* material);
+
+/**
+ * Returns the index of the position in the table of `material`.
+ * `colorsFlipped` must be the value given by makeEndgameMaterial for the pieces of the board
+*/
+u64 endgamePositionIndex(const EndgameMaterial* material, const Board* board, bool colorsFlipped);
+
+/**
+ * Writes the square of each piece of the material (in the order of material->pieces) for the index.
+ * Several indices can give the same position, only the one returned by endgamePositionIndex is used in the table
+*/
+void endgamePositionFromIndex(const EndgameMaterial* material, u64 index, int squares[MAX_ENDGAME_PIECES]);
+
+/**
+ * Maps the table in memory, returns false if the file is missing, is not a valid table or is too short for its material
+*/
+bool openEndgameTable(const char* path, EndgameTable* table);
+void closeEndgameTable(EndgameTable* table);
+
+/**
+ * Returns false if the board does not have the material of the table, or if the distance to mate block of the
+ * position goes past the end of a corrupted file
+*/
+bool probeEndgameTableBoard(const EndgameTable* table, const Board* board, PieceCharacteristics colorToGo, EndgameProbe* result);
+
+/**
+ * Same as probeEndgameTableBoard, but also returns false for positions with castling or en passant rights
+*/
+bool probeEndgameTable(const EndgameTable* table, const GameState* state, EndgameProbe* result);
+
+/**
+ * Forgets the previous tables and opens every ENDGAME_TABLE_EXTENSION file of `directory` for probeEndgameTables.
+ * NULL or an empty string removes all the tables. Must not be called while a search is probing.
+ * Returns the number of tables opened
+*/
+int endgameTablesInitialize(const char* directory);
+
+void endgameTablesFree();
+
+/**
+ * The number of pieces (kings included) of the biggest opened table, 0 when there are none
+*/
+int endgameTablesLargest();
+
+/**
+ * Probes the opened table that has the material of the position, can be called from several search threads at
+ * the same time. Returns false if there is no such table, or if the position has castling or en passant rights
+*/
+bool probeEndgameTables(const GameState* state, EndgameProbe* result);
+
+#endif
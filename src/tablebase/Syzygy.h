@@ -0,0 +1,59 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <stdbool.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+
+/*
+Probing of the Syzygy tablebases (the .rtbw win/draw/loss files and the .rtbz distance to zeroing files).
+
+syzygyInitialize only lists the files of the directories, each file is mapped in memory the first time a position
+needs it. Every probe can be called from several search threads at the same time.
+Positions with castling rights cannot be probed.
+*/
+
+#define SYZYGY_MAX_PIECES 7
+
+typedef enum {
+    SYZYGY_LOSS = -2,
+    SYZYGY_BLESSED_LOSS = -1, // Lost, but the fifty move rule saves the side to move
+    SYZYGY_DRAW = 0,
+    SYZYGY_CURSED_WIN = 1, // Won, but the fifty move rule ends the game first
+    SYZYGY_WIN = 2
+} SyzygyWdl;
+
+/**
+ * Forgets the previous tables and lists the tables of `paths`, a list of directories separated by ':' (';' on windows).
+ * NULL or an empty string removes all the tables. Must not be called while a search is probing.
+ * Returns the number of tables found
+*/
+int syzygyInitialize(const char* paths);
+
+void syzygyFree();
+
+/**
+ * The number of pieces (kings included) of the biggest table found, 0 when there are none
+*/
+int syzygyLargestTable();
+
+/**
+ * Win/draw/loss of the position for the side to move, assuming that the fifty move counter was just reset.
+ * Returns false if a table is missing
+*/
+bool syzygyProbeWdl(const GameState* state, SyzygyWdl* result);
+
+/**
+ * Distance to zeroing of the position in plies: positive when the side to move wins, negative when it loses,
+ * 0 for draws. 100 is added to the cursed wins and blessed losses. Returns false if a table is missing
+*/
+bool syzygyProbeDtz(const GameState* state, int* result);
+
+/**
+ * Writes the legal moves that keep the best outcome in `results` (0 terminated), using the distance to zeroing
+ * and the fifty move counter of the position: when winning, only the moves that still win, when losing the moves
+ * that resist the longest. Returns the number of moves, 0 if the position cannot be probed
+*/
+int syzygyRootMoves(const GameState* state, Move results[MAX_LEGAL_MOVES + 1]);
+
+#endif
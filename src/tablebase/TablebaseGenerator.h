@@ -0,0 +1,17 @@
+#ifndef TABLEBASE_GENERATOR_H
+#define TABLEBASE_GENERATOR_H
+
+#include <stdbool.h>
+
+/**
+ * Generates the endgame table of `materialName` (like KQvKR) in `directory`, as directory/KQvKR.ctb.
+ * The tables of the materials reachable with a capture or a promotion are generated first when they are not already
+ * in the directory, since the table needs them to score these moves.
+ * The retrograde passes are split between `nbThreads` threads. The magic bit boards must be initialized.
+ *
+ * Memory: 5 bytes per position during the generation, so ~1.7GB for 5 pieces without pawns and ~5.4GB with pawns.
+ * Returns false if the material is invalid or if a file cannot be written
+*/
+bool generateEndgameTable(const char* materialName, const char* directory, int nbThreads);
+
+#endif
@@ -0,0 +1,412 @@
+#include <assert.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "EndgameTable.h"
+
+#define PAWNLESS_KING_SQUARES 10
+#define PAWN_KING_SQUARES 32
+
+// The order of the pieces in a material, indexed with the piece type: queen, rook, bishop, knight then pawn
+static const int endgamePieceOrder[7] = { -1, -1, 3, 2, 0, 1, 4 };
+static const char endgamePieceLetters[7] = { '?', 'K', 'N', 'B', 'Q', 'R', 'P' };
+
+// Squares of the white king in the table, and the reverse mapping (-1 for squares that are not used)
+static int pawnlessKingSquares[PAWNLESS_KING_SQUARES];
+static int pawnKingSquares[PAWN_KING_SQUARES];
+static int pawnlessKingIndices[BOARD_SIZE];
+static int pawnKingIndices[BOARD_SIZE];
+static pthread_once_t kingSquaresOnce = PTHREAD_ONCE_INIT;
+
+// The tables opened by endgameTablesInitialize for the search, they are only read after that
+static EndgameTable* searchTables = NULL;
+static int nbSearchTables = 0;
+static int largestSearchTable = 0;
+
+// Files and ranks go from 0 to 7, starting from a1 (our squares start at a8)
+static int squareFile(int square) { return square % BOARD_LENGTH; }
+static int squareRank(int square) { return BOARD_LENGTH - 1 - square / BOARD_LENGTH; }
+static int squareFromFileAndRank(int file, int rank) { return (BOARD_LENGTH - 1 - rank) * BOARD_LENGTH + file; }
+
+static void computeKingSquares() {
+    int nbPawnless = 0;
+    int nbPawn = 0;
+    for (int square = 0; square < BOARD_SIZE; square++) {
+        int file = squareFile(square);
+        int rank = squareRank(square);
+        pawnlessKingIndices[square] = -1;
+        pawnKingIndices[square] = -1;
+        if (file <= 3 && rank <= 3 && rank <= file) {
+            pawnlessKingIndices[square] = nbPawnless;
+            pawnlessKingSquares[nbPawnless++] = square;
+        }
+        if (file <= 3) {
+            pawnKingIndices[square] = nbPawn;
+            pawnKingSquares[nbPawn++] = square;
+        }
+    }
+}
+
+// The tables are read by the search threads and the generator threads, pthread_once makes the first use safe
+static void initializeKingSquares() {
+    pthread_once(&kingSquaresOnce, computeKingSquares);
+}
+
+// Bits of a symmetry: 1 mirrors the files, 2 mirrors the ranks, 4 swaps the files and the ranks (applied last)
+static int symmetryForKing(int kingSquare, bool hasPawns) {
+    int file = squareFile(kingSquare);
+    int rank = squareRank(kingSquare);
+    int symmetry = 0;
+    if (file > 3) {
+        symmetry |= 1;
+        file = 7 - file;
+    }
+    if (hasPawns) { return symmetry; } // Pawns only go one way, so the board can only be mirrored horizontally
+    if (rank > 3) {
+        symmetry |= 2;
+        rank = 7 - rank;
+    }
+    if (rank > file) {
+        symmetry |= 4;
+    }
+    return symmetry;
+}
+
+static int applySymmetry(int square, int symmetry) {
+    if (symmetry & 1) { square ^= 7; }
+    if (symmetry & 2) { square ^= 56; }
+    if (symmetry & 4) { square = squareFromFileAndRank(squareRank(square), squareFile(square)); }
+    return square;
+}
+
+static Piece swapPieceColor(Piece piece) {
+    return makePiece(pieceColor(piece) == WHITE ? BLACK : WHITE, pieceType(piece));
+}
+
+static void sortByPieceOrder(Piece* pieces, int nbPieces) {
+    for (int i = 1; i < nbPieces; i++) {
+        Piece piece = pieces[i];
+        int j = i - 1;
+        while (j >= 0 && endgamePieceOrder[(int) pieceType(pieces[j])] > endgamePieceOrder[(int) pieceType(piece)]) {
+            pieces[j + 1] = pieces[j];
+            j--;
+        }
+        pieces[j + 1] = piece;
+    }
+}
+
+/**
+ * Returns true if the pieces of `a` are stronger than the pieces of `b`: more pieces, or better pieces first
+*/
+static bool isStrongerSide(const Piece* a, int nbA, const Piece* b, int nbB) {
+    if (nbA != nbB) { return nbA > nbB; }
+    for (int i = 0; i < nbA; i++) {
+        int orderA = endgamePieceOrder[(int) pieceType(a[i])];
+        int orderB = endgamePieceOrder[(int) pieceType(b[i])];
+        if (orderA != orderB) { return orderA < orderB; }
+    }
+    return false;
+}
+
+bool makeEndgameMaterial(const Piece* pieces, int nbPieces, EndgameMaterial* result, bool* colorsFlipped) {
+    if (nbPieces > MAX_ENDGAME_PIECES) { return false; }
+    Piece white[MAX_ENDGAME_PIECES];
+    Piece black[MAX_ENDGAME_PIECES];
+    int nbWhite = 0, nbBlack = 0, nbWhiteKings = 0, nbBlackKings = 0;
+    for (int i = 0; i < nbPieces; i++) {
+        bool isWhite = pieceColor(pieces[i]) == WHITE;
+        if (pieceType(pieces[i]) == KING) {
+            if (isWhite) { nbWhiteKings++; } else { nbBlackKings++; }
+        } else if (isWhite) {
+            white[nbWhite++] = pieces[i];
+        } else {
+            black[nbBlack++] = pieces[i];
+        }
+    }
+    if (nbWhiteKings != 1 || nbBlackKings != 1) { return false; }
+    sortByPieceOrder(white, nbWhite);
+    sortByPieceOrder(black, nbBlack);
+
+    bool flipped = isStrongerSide(black, nbBlack, white, nbWhite);
+    if (colorsFlipped != NULL) { *colorsFlipped = flipped; }
+    const Piece* strong = flipped ? black : white;
+    const Piece* weak = flipped ? white : black;
+    int nbStrong = flipped ? nbBlack : nbWhite;
+    int nbWeak = flipped ? nbWhite : nbBlack;
+
+    int count = 0;
+    result->pieces[count++] = makePiece(WHITE, KING);
+    for (int i = 0; i < nbStrong; i++) { result->pieces[count++] = makePiece(WHITE, pieceType(strong[i])); }
+    result->pieces[count++] = makePiece(BLACK, KING);
+    for (int i = 0; i < nbWeak; i++) { result->pieces[count++] = makePiece(BLACK, pieceType(weak[i])); }
+    result->nbPieces = count;
+
+    result->hasPawns = false;
+    for (int i = 0; i < count; i++) {
+        if (pieceType(result->pieces[i]) == PAWN) { result->hasPawns = true; }
+    }
+    result->nbPositionsPerSide = result->hasPawns ? PAWN_KING_SQUARES : PAWNLESS_KING_SQUARES;
+    for (int i = 1; i < count; i++) {
+        result->nbPositionsPerSide *= BOARD_SIZE;
+    }
+    return true;
+}
+
+bool parseEndgameMaterial(const char* name, EndgameMaterial* result) {
+    Piece pieces[MAX_ENDGAME_PIECES];
+    int nbPieces = 0;
+    PieceCharacteristics color = WHITE;
+    for (const char* c = name; *c != '\0'; c++) {
+        if (*c == 'v') {
+            if (color == BLACK) { return false; }
+            color = BLACK;
+            continue;
+        }
+        PieceCharacteristics type = NOPIECE;
+        for (int i = KING; i <= PAWN; i++) {
+            if (endgamePieceLetters[i] == *c) { type = i; }
+        }
+        if (type == NOPIECE || nbPieces == MAX_ENDGAME_PIECES) { return false; }
+        pieces[nbPieces++] = makePiece(color, type);
+    }
+    return color == BLACK && makeEndgameMaterial(pieces, nbPieces, result, NULL);
+}
+
+void endgameMaterialName(const EndgameMaterial* material, char* name) {
+    int length = 0;
+    for (int i = 0; i < material->nbPieces; i++) {
+        if (i > 0 && material->pieces[i] == makePiece(BLACK, KING)) { name[length++] = 'v'; }
+        name[length++] = endgamePieceLetters[(int) pieceType(material->pieces[i])];
+    }
+    name[length] = '\0';
+}
+
+bool isSameEndgameMaterial(const EndgameMaterial* a, const EndgameMaterial* b) {
+    return a->nbPieces == b->nbPieces && memcmp(a->pieces, b->pieces, a->nbPieces * sizeof(Piece)) == 0;
+}
+
+u64 endgameWdlBytes(const EndgameMaterial* material) {
+    return (2 * material->nbPositionsPerSide + 3) / 4;
+}
+
+u64 endgameDtmBlocks(const EndgameMaterial* material) {
+    return (2 * material->nbPositionsPerSide + ENDGAME_DTM_BLOCK_SIZE - 1) / ENDGAME_DTM_BLOCK_SIZE;
+}
+
+static u64 indexWithSymmetry(const EndgameMaterial* material, const Board* board, bool colorsFlipped, int symmetry) {
+    int flip = colorsFlipped ? 56 : 0;
+    Piece whiteKing = colorsFlipped ? makePiece(BLACK, KING) : makePiece(WHITE, KING);
+    int kingSquare = applySymmetry(trailingZeros_64(bitBoardForPiece(*board, whiteKing)) ^ flip, symmetry);
+    u64 index = material->hasPawns ? pawnKingIndices[kingSquare] : pawnlessKingIndices[kingSquare];
+
+    int i = 1;
+    while (i < material->nbPieces) {
+        // Identical pieces are sorted by square, so that swapping them does not give another index
+        Piece piece = material->pieces[i];
+        Piece boardPiece = colorsFlipped ? swapPieceColor(piece) : piece;
+        int squares[MAX_ENDGAME_PIECES];
+        int nbSquares = 0;
+        u64 bitBoard = bitBoardForPiece(*board, boardPiece);
+        while (bitBoard) {
+            int square = applySymmetry(trailingZeros_64(bitBoard) ^ flip, symmetry);
+            int j = nbSquares++;
+            while (j > 0 && squares[j - 1] > square) {
+                squares[j] = squares[j - 1];
+                j--;
+            }
+            squares[j] = square;
+            bitBoard &= bitBoard - 1;
+        }
+        for (int j = 0; j < nbSquares; j++) {
+            index = index * BOARD_SIZE + squares[j];
+        }
+        i += nbSquares;
+    }
+    return index;
+}
+
+u64 endgamePositionIndex(const EndgameMaterial* material, const Board* board, bool colorsFlipped) {
+    initializeKingSquares();
+    Piece whiteKing = colorsFlipped ? makePiece(BLACK, KING) : makePiece(WHITE, KING);
+    int kingSquare = trailingZeros_64(bitBoardForPiece(*board, whiteKing)) ^ (colorsFlipped ? 56 : 0);
+    int symmetry = symmetryForKing(kingSquare, material->hasPawns);
+    u64 index = indexWithSymmetry(material, board, colorsFlipped, symmetry);
+
+    // A king on the a1-d4 diagonal stays there when the board is flipped along it, so both sides are tried
+    int symmetricKingSquare = applySymmetry(kingSquare, symmetry);
+    if (!material->hasPawns && squareFile(symmetricKingSquare) == squareRank(symmetricKingSquare)) {
+        u64 transposedIndex = indexWithSymmetry(material, board, colorsFlipped, symmetry | 4);
+        if (transposedIndex < index) { index = transposedIndex; }
+    }
+    return index;
+}
+
+void endgamePositionFromIndex(const EndgameMaterial* material, u64 index, int squares[MAX_ENDGAME_PIECES]) {
+    initializeKingSquares();
+    for (int i = material->nbPieces - 1; i > 0; i--) {
+        squares[i] = index % BOARD_SIZE;
+        index /= BOARD_SIZE;
+    }
+    squares[0] = material->hasPawns ? pawnKingSquares[index] : pawnlessKingSquares[index];
+}
+
+static uint32_t readEndgameUint32(const unsigned char* data) {
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+bool openEndgameTable(const char* path, EndgameTable* table) {
+    if (!mapFile(path, &table->file)) { return false; }
+    EndgameTableHeader header;
+    bool isValid = table->file.size >= sizeof(EndgameTableHeader);
+    if (isValid) {
+        memcpy(&header, table->file.data, sizeof(EndgameTableHeader));
+        isValid = memcmp(header.magic, "CTB1", 4) == 0 &&
+            header.version == 1 &&
+            header.blockSize == ENDGAME_DTM_BLOCK_SIZE &&
+            header.nbPieces <= MAX_ENDGAME_PIECES;
+    }
+    if (isValid) {
+        Piece pieces[MAX_ENDGAME_PIECES];
+        for (uint32_t i = 0; i < header.nbPieces; i++) { pieces[i] = header.pieces[i]; }
+        isValid = makeEndgameMaterial(pieces, header.nbPieces, &table->material, NULL) &&
+            table->material.nbPositionsPerSide == header.nbPositionsPerSide;
+    }
+    // The sizes come from the material, so the sections of a truncated or corrupted file cannot be read past its end
+    if (isValid) {
+        isValid = header.nbBlocks == endgameDtmBlocks(&table->material) &&
+            header.wdlOffset >= sizeof(EndgameTableHeader) &&
+            header.wdlOffset <= table->file.size &&
+            header.dtmIndexOffset <= table->file.size &&
+            header.dtmDataOffset <= table->file.size &&
+            header.wdlOffset + endgameWdlBytes(&table->material) <= header.dtmIndexOffset &&
+            header.dtmIndexOffset + header.nbBlocks * sizeof(uint32_t) <= header.dtmDataOffset;
+    }
+    if (!isValid) {
+        unmapFile(&table->file);
+        return false;
+    }
+    table->wdl = table->file.data + header.wdlOffset;
+    table->dtmIndex = table->file.data + header.dtmIndexOffset;
+    table->dtmData = table->file.data + header.dtmDataOffset;
+    table->dtmDataSize = table->file.size - header.dtmDataOffset;
+    return true;
+}
+
+void closeEndgameTable(EndgameTable* table) {
+    unmapFile(&table->file);
+}
+
+/**
+ * Returns -1 if the block of the position goes past the end of the file
+*/
+static int dtmAtPosition(const EndgameTable* table, u64 position) {
+    uint32_t blockOffset = readEndgameUint32(table->dtmIndex + (position / ENDGAME_DTM_BLOCK_SIZE) * sizeof(uint32_t));
+    int indexInBlock = position % ENDGAME_DTM_BLOCK_SIZE;
+    if (blockOffset & ENDGAME_DTM_RAW_BLOCK) {
+        size_t offset = (size_t) (blockOffset & ~ENDGAME_DTM_RAW_BLOCK) + indexInBlock;
+        return offset < table->dtmDataSize ? table->dtmData[offset] : -1;
+    }
+    size_t offset = blockOffset;
+    while (offset + 1 < table->dtmDataSize && indexInBlock >= table->dtmData[offset]) {
+        indexInBlock -= table->dtmData[offset];
+        offset += 2;
+    }
+    return offset + 1 < table->dtmDataSize ? table->dtmData[offset + 1] : -1;
+}
+
+bool probeEndgameTableBoard(const EndgameTable* table, const Board* board, PieceCharacteristics colorToGo, EndgameProbe* result) {
+    Piece pieces[MAX_ENDGAME_PIECES];
+    int nbPieces = 0;
+    for (PieceCharacteristics color = WHITE; color <= BLACK; color += WHITE) {
+        for (PieceCharacteristics type = KING; type <= PAWN; type++) {
+            u64 bitBoard = bitBoardForPiece(*board, makePiece(color, type));
+            while (bitBoard) {
+                if (nbPieces == MAX_ENDGAME_PIECES) { return false; }
+                pieces[nbPieces++] = makePiece(color, type);
+                bitBoard &= bitBoard - 1;
+            }
+        }
+    }
+    EndgameMaterial material;
+    bool colorsFlipped;
+    if (!makeEndgameMaterial(pieces, nbPieces, &material, &colorsFlipped)) { return false; }
+    if (!isSameEndgameMaterial(&material, &table->material)) { return false; }
+
+    bool isWhiteToGo = (colorToGo == WHITE) != colorsFlipped;
+    u64 position = endgamePositionIndex(&material, board, colorsFlipped) + (isWhiteToGo ? 0 : material.nbPositionsPerSide);
+    EndgameWdl wdl = (table->wdl[position / 4] >> ((position % 4) * 2)) & 0b11;
+    if (wdl == ENDGAME_ILLEGAL) { return false; }
+
+    int movesToMate = dtmAtPosition(table, position);
+    if (movesToMate < 0) { return false; }
+    result->wdl = wdl;
+    result->movesToMate = movesToMate;
+    return true;
+}
+
+bool probeEndgameTable(const EndgameTable* table, const GameState* state, EndgameProbe* result) {
+    if (state->castlingPerm != 0 || state->enPassantTargetSquare != -1) { return false; }
+    return probeEndgameTableBoard(table, &state->board, state->colorToGo, result);
+}
+
+void endgameTablesFree() {
+    for (int i = 0; i < nbSearchTables; i++) { closeEndgameTable(&searchTables[i]); }
+    free(searchTables);
+    searchTables = NULL;
+    nbSearchTables = 0;
+    largestSearchTable = 0;
+}
+
+int endgameTablesInitialize(const char* directory) {
+    endgameTablesFree();
+    initializeKingSquares(); // Before the search threads probe the tables
+    DIR* dir = directory != NULL && directory[0] != '\0' ? opendir(directory) : NULL;
+    if (dir == NULL) { return 0; }
+
+    int extensionLength = strlen(ENDGAME_TABLE_EXTENSION);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int nameLength = strlen(entry->d_name);
+        if (nameLength <= extensionLength || strcmp(entry->d_name + nameLength - extensionLength, ENDGAME_TABLE_EXTENSION) != 0) {
+            continue;
+        }
+        size_t pathLength = strlen(directory) + nameLength + 2;
+        char* path = malloc(pathLength);
+        assert(path != NULL && "Malloc failed so buy more RAM lol");
+        snprintf(path, pathLength, "%s/%s", directory, entry->d_name);
+
+        EndgameTable table;
+        bool isOpened = openEndgameTable(path, &table);
+        free(path);
+        if (!isOpened) { continue; }
+        bool isDuplicate = false;
+        for (int i = 0; i < nbSearchTables; i++) {
+            if (isSameEndgameMaterial(&searchTables[i].material, &table.material)) { isDuplicate = true; }
+        }
+        if (isDuplicate) {
+            closeEndgameTable(&table);
+            continue;
+        }
+        searchTables = realloc(searchTables, sizeof(EndgameTable) * (nbSearchTables + 1));
+        assert(searchTables != NULL && "Malloc failed so buy more RAM lol");
+        searchTables[nbSearchTables++] = table;
+        if (table.material.nbPieces > largestSearchTable) { largestSearchTable = table.material.nbPieces; }
+    }
+    closedir(dir);
+    return nbSearchTables;
+}
+
+int endgameTablesLargest() {
+    return largestSearchTable;
+}
+
+bool probeEndgameTables(const GameState* state, EndgameProbe* result) {
+    if (__builtin_popcountll(allPiecesBitBoard(state->board)) > largestSearchTable) { return false; }
+    for (int i = 0; i < nbSearchTables; i++) {
+        // probeEndgameTable returns false when the material is not the one of the table
+        if (probeEndgameTable(&searchTables[i], state, result)) { return true; }
+    }
+    return false;
+}
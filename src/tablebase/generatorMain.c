@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "TablebaseGenerator.h"
+#include "../magicBitBoard/MagicBitBoard.h"
+
+/**
+ * Usage: chess_engine_tablebase_generator <directory> <threads> <materials...>
+ * Example: chess_engine_tablebase_generator ./tables 4 KQvK KRvK KQvKR
+*/
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <directory> <threads> <materials...>\n", argv[0]);
+        return 1;
+    }
+    int nbThreads = atoi(argv[2]);
+    if (nbThreads < 1) { nbThreads = 1; }
+
+    magicBitBoardInitialize();
+    int status = 0;
+    for (int i = 3; i < argc; i++) {
+        if (!generateEndgameTable(argv[i], argv[1], nbThreads)) {
+            fprintf(stderr, "Could not generate %s\n", argv[i]);
+            status = 1;
+        }
+    }
+    magicBitBoardTerminate();
+    return status;
+}
@@ -0,0 +1,1042 @@
+#include <assert.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Syzygy.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../utils/MappedFile.h"
+
+/*
+The decoding follows the layout of the files made by the Syzygy generator. Inside this file the squares and the pieces
+use the numbering of the tables: a1 is 0 and h8 is 63, and the piece codes are pawn 1, knight 2, bishop 3, rook 4,
+queen 5, king 6, plus 8 for black.
+*/
+
+#ifdef _WIN32
+#define SYZYGY_PATH_SEPARATOR ';'
+#else
+#define SYZYGY_PATH_SEPARATOR ':'
+#endif
+
+#define TABLE_HASH_BITS 12
+#define TABLE_HASH_SIZE (1 << TABLE_HASH_BITS)
+#define MAX_DTZ (1 << 18)
+
+// Flags of a PairsData
+#define FLAG_SIDE_TO_MOVE 1
+#define FLAG_MAPPED 2
+#define FLAG_WIN_PLIES 4
+#define FLAG_LOSS_PLIES 8
+#define FLAG_WIDE 16
+#define FLAG_SINGLE_VALUE 128
+
+typedef enum {
+    PROBE_CHANGE_SIDE = -1, // The DTZ table only has the other side to move
+    PROBE_FAIL = 0,
+    PROBE_OK = 1,
+    PROBE_ZEROING_BEST_MOVE = 2 // The best move is a capture or a pawn move, so the DTZ is the one before it
+} ProbeState;
+
+/**
+ * One compressed table, there is one per side to move and per file of the leading pawn
+*/
+typedef struct PairsData {
+    uint8_t flags;
+    int minSymbolLength;
+    int maxSymbolLength;
+    u64 blockSize;
+    u64 span; // Number of positions between two entries of the sparse index
+    u64 sparseIndexSize;
+    u64 blockLengthSize;
+    uint32_t nbBlocks;
+    const uint8_t* lowestSymbols; // u16 per symbol length
+    u64* base64; // Smallest code of each symbol length, left aligned on 64 bits
+    uint8_t* symbolLengths; // Number of values - 1 that each symbol expands to
+    int nbSymbols;
+    const uint8_t* symbolTree; // 12 bits left and right children per symbol
+    const uint8_t* sparseIndex; // u32 block and u16 offset per entry
+    const uint8_t* blockLengths; // u16 per block
+    const uint8_t* data;
+    u64 groupIndex[SYZYGY_MAX_PIECES + 1];
+    int groupLength[SYZYGY_MAX_PIECES + 1];
+    uint8_t pieces[SYZYGY_MAX_PIECES];
+    uint16_t mapIndex[4]; // DTZ only
+} PairsData;
+
+typedef struct TableFile {
+    atomic_bool ready; // Set once the file was mapped, or failed to be
+    bool isValid;
+    MappedFile file;
+    const uint8_t* map; // DTZ only, the values of the DTZ are mapped through it
+    PairsData items[2][4]; // [side to move][file of the leading pawn]
+} TableFile;
+
+typedef struct SyzygyTable {
+    char* path; // Without the extension
+    u64 key; // Material with the first side of the name as white
+    u64 key2; // Material with the first side of the name as black
+    int nbPieces;
+    bool hasPawns;
+    bool hasUniquePieces;
+    int pawnCount[2]; // The leading color first
+    TableFile wdl;
+    TableFile dtz;
+} SyzygyTable;
+
+static SyzygyTable* syzygyTables = NULL;
+static int nbSyzygyTables = 0;
+static int syzygyLargest = 0;
+static int tableHash[TABLE_HASH_SIZE]; // Index of the table + 1, 0 for empty slots
+static pthread_mutex_t tableMappingMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int mapPawns[64];
+static int mapB1H1H7[64];
+static int mapA1D1D4[64];
+static int mapKK[10][64];
+static u64 binomial[SYZYGY_MAX_PIECES][64];
+static int leadPawnIndex[6][64];
+static int leadPawnsSize[6][4];
+static bool areEncodingTablesInitialized = false;
+
+// Indexed with our piece type: NOPIECE, KING, KNIGHT, BISHOP, QUEEN, ROOK, PAWN
+static const int syzygyPieceTypes[7] = { 0, 6, 2, 3, 5, 4, 1 };
+static const char syzygyPieceLetters[] = " PNBRQK";
+
+static int fileOf(int square) { return square & 7; }
+static int rankOf(int square) { return square >> 3; }
+static int offDiagonal(int square) { return rankOf(square) - fileOf(square); }
+static int edgeDistance(int file) { return file < 7 - file ? file : 7 - file; }
+
+static uint16_t readLe16(const uint8_t* data) { return data[0] | (data[1] << 8); }
+static uint32_t readLe32(const uint8_t* data) { return readLe16(data) | ((uint32_t) readLe16(data + 2) << 16); }
+static uint32_t readBe32(const uint8_t* data) {
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+static u64 readBe64(const uint8_t* data) { return ((u64) readBe32(data) << 32) | readBe32(data + 4); }
+
+static int leftSymbol(const uint8_t* tree, int symbol) {
+    const uint8_t* entry = tree + 3 * symbol;
+    return ((entry[1] & 0xF) << 8) | entry[0];
+}
+
+static int rightSymbol(const uint8_t* tree, int symbol) {
+    const uint8_t* entry = tree + 3 * symbol;
+    return (entry[2] << 4) | (entry[1] >> 4);
+}
+
+static void initializeEncodingTables() {
+    if (areEncodingTablesInitialized) { return; }
+
+    int code = 0;
+    for (int square = 0; square < 64; square++) {
+        if (offDiagonal(square) < 0) { mapB1H1H7[square] = code++; }
+    }
+
+    // The a1-d1-d4 triangle, with the squares of the diagonal last
+    int diagonal[4];
+    int nbDiagonal = 0;
+    code = 0;
+    for (int square = 0; square <= 27; square++) {
+        if (offDiagonal(square) < 0 && fileOf(square) <= 3) {
+            mapA1D1D4[square] = code++;
+        } else if (offDiagonal(square) == 0 && fileOf(square) <= 3) {
+            diagonal[nbDiagonal++] = square;
+        }
+    }
+    for (int i = 0; i < nbDiagonal; i++) { mapA1D1D4[diagonal[i]] = code++; }
+
+    // The 462 legal placements of the two kings, the first one in the triangle. If the first one is on the
+    // diagonal, the other one is not above it. Both kings on the diagonal come last
+    int bothOnDiagonal[64][2];
+    int nbBothOnDiagonal = 0;
+    code = 0;
+    for (int index = 0; index < 10; index++) {
+        for (int first = 0; first <= 27; first++) {
+            if (mapA1D1D4[first] != index || (index == 0 && first != 1)) { continue; } // b1 is the index 0
+            for (int second = 0; second < 64; second++) {
+                int fileDistance = abs(fileOf(first) - fileOf(second));
+                int rankDistance = abs(rankOf(first) - rankOf(second));
+                if (fileDistance <= 1 && rankDistance <= 1) { continue; }
+                if (offDiagonal(first) == 0 && offDiagonal(second) > 0) { continue; }
+                if (offDiagonal(first) == 0 && offDiagonal(second) == 0) {
+                    bothOnDiagonal[nbBothOnDiagonal][0] = index;
+                    bothOnDiagonal[nbBothOnDiagonal++][1] = second;
+                } else {
+                    mapKK[index][second] = code++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < nbBothOnDiagonal; i++) {
+        mapKK[bothOnDiagonal[i][0]][bothOnDiagonal[i][1]] = code++;
+    }
+
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++) {
+        for (int k = 0; k < SYZYGY_MAX_PIECES && k <= n; k++) {
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+        }
+    }
+
+    // mapPawns gives the number of squares left for the other pawns when the leading pawn is on the square,
+    // the leading pawn is the one with the highest value: closest to the edge, then lowest rank
+    int availableSquares = 47;
+    for (int nbLeadPawns = 1; nbLeadPawns <= 5; nbLeadPawns++) {
+        for (int file = 0; file <= 3; file++) {
+            int index = 0;
+            for (int rank = 1; rank <= 6; rank++) {
+                int square = rank * 8 + file;
+                if (nbLeadPawns == 1) {
+                    mapPawns[square] = availableSquares--;
+                    mapPawns[square ^ 7] = availableSquares--;
+                }
+                leadPawnIndex[nbLeadPawns][square] = index;
+                index += binomial[nbLeadPawns - 1][mapPawns[square]];
+            }
+            leadPawnsSize[nbLeadPawns][file] = index;
+        }
+    }
+    areEncodingTablesInitialized = true;
+}
+
+/**
+ * Material key with 3 bits for the number of each piece
+*/
+static u64 materialKeyFromCounts(const int counts[2][7]) {
+    u64 key = 0;
+    for (int color = 0; color < 2; color++) {
+        for (int type = 1; type <= 6; type++) {
+            key |= (u64) counts[color][type] << (3 * (color * 6 + type - 1));
+        }
+    }
+    return key;
+}
+
+static u64 materialKeyFromBoard(const Board* board) {
+    int counts[2][7] = { { 0 } };
+    for (PieceCharacteristics type = KING; type <= PAWN; type++) {
+        counts[0][syzygyPieceTypes[type]] += __builtin_popcountll(bitBoardForPiece(*board, makePiece(WHITE, type)));
+        counts[1][syzygyPieceTypes[type]] += __builtin_popcountll(bitBoardForPiece(*board, makePiece(BLACK, type)));
+    }
+    return materialKeyFromCounts(counts);
+}
+
+static int pieceCountOfBoard(const Board* board) {
+    return __builtin_popcountll(allPiecesBitBoard(*board));
+}
+
+static int tableHashSlot(u64 key) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - TABLE_HASH_BITS);
+}
+
+static SyzygyTable* findTable(u64 key) {
+    for (int slot = tableHashSlot(key); tableHash[slot] != 0; slot = (slot + 1) & (TABLE_HASH_SIZE - 1)) {
+        SyzygyTable* table = &syzygyTables[tableHash[slot] - 1];
+        if (table->key == key || table->key2 == key) { return table; }
+    }
+    return NULL;
+}
+
+static void insertTableKey(u64 key, int index) {
+    int slot = tableHashSlot(key);
+    while (tableHash[slot] != 0) { slot = (slot + 1) & (TABLE_HASH_SIZE - 1); }
+    tableHash[slot] = index + 1;
+}
+
+/**
+ * Adds the table of `name` (like KRvK, without the extension), returns false if the name is not a valid material
+*/
+static bool addTable(const char* directory, const char* name, int nameLength) {
+    int counts[2][7] = { { 0 } };
+    int side = 0;
+    int nbPieces = 0;
+    for (int i = 0; i < nameLength; i++) {
+        if (name[i] == 'v') {
+            if (side == 1) { return false; }
+            side = 1;
+            continue;
+        }
+        const char* letter = name[i] == '\0' ? NULL : strchr(syzygyPieceLetters + 1, name[i]);
+        if (letter == NULL) { return false; }
+        counts[side][letter - syzygyPieceLetters]++;
+        nbPieces++;
+    }
+    if (side != 1 || counts[0][6] != 1 || counts[1][6] != 1 || nbPieces > SYZYGY_MAX_PIECES) { return false; }
+    if (nbSyzygyTables * 2 + 2 > TABLE_HASH_SIZE / 2) { return false; }
+
+    int swappedCounts[2][7];
+    memcpy(swappedCounts[0], counts[1], sizeof(counts[1]));
+    memcpy(swappedCounts[1], counts[0], sizeof(counts[0]));
+    u64 key = materialKeyFromCounts(counts);
+    if (findTable(key) != NULL) { return true; } // Already found in another directory
+
+    syzygyTables = realloc(syzygyTables, sizeof(SyzygyTable) * (nbSyzygyTables + 1));
+    assert(syzygyTables != NULL && "Malloc failed so buy more RAM lol");
+    SyzygyTable* table = &syzygyTables[nbSyzygyTables];
+    memset(table, 0, sizeof(SyzygyTable));
+    table->key = key;
+    table->key2 = materialKeyFromCounts(swappedCounts);
+    table->nbPieces = nbPieces;
+    table->hasPawns = counts[0][1] + counts[1][1] > 0;
+    for (int color = 0; color < 2; color++) {
+        for (int type = 1; type < 6; type++) {
+            if (counts[color][type] == 1) { table->hasUniquePieces = true; }
+        }
+    }
+    // The leading color is the one with the fewest pawns, but not none
+    bool isWhiteLeading = counts[1][1] == 0 || (counts[0][1] > 0 && counts[1][1] >= counts[0][1]);
+    table->pawnCount[0] = counts[isWhiteLeading ? 0 : 1][1];
+    table->pawnCount[1] = counts[isWhiteLeading ? 1 : 0][1];
+
+    size_t pathLength = strlen(directory) + nameLength + 2;
+    table->path = malloc(pathLength);
+    assert(table->path != NULL && "Malloc failed so buy more RAM lol");
+    snprintf(table->path, pathLength, "%s/%.*s", directory, nameLength, name);
+
+    insertTableKey(table->key, nbSyzygyTables);
+    if (table->key2 != table->key) { insertTableKey(table->key2, nbSyzygyTables); }
+    nbSyzygyTables++;
+    if (nbPieces > syzygyLargest) { syzygyLargest = nbPieces; }
+    return true;
+}
+
+static void freeTableFile(TableFile* file) {
+    for (int side = 0; side < 2; side++) {
+        for (int f = 0; f < 4; f++) {
+            free(file->items[side][f].base64);
+            free(file->items[side][f].symbolLengths);
+        }
+    }
+    if (file->isValid) { unmapFile(&file->file); }
+}
+
+void syzygyFree() {
+    for (int i = 0; i < nbSyzygyTables; i++) {
+        freeTableFile(&syzygyTables[i].wdl);
+        freeTableFile(&syzygyTables[i].dtz);
+        free(syzygyTables[i].path);
+    }
+    free(syzygyTables);
+    syzygyTables = NULL;
+    nbSyzygyTables = 0;
+    syzygyLargest = 0;
+    memset(tableHash, 0, sizeof(tableHash));
+}
+
+int syzygyInitialize(const char* paths) {
+    syzygyFree();
+    initializeEncodingTables();
+    if (paths == NULL) { return 0; }
+
+    const char* start = paths;
+    while (*start != '\0') {
+        const char* end = strchr(start, SYZYGY_PATH_SEPARATOR);
+        if (end == NULL) { end = start + strlen(start); }
+        char directory[1024];
+        int length = end - start < (int) sizeof(directory) - 1 ? end - start : (int) sizeof(directory) - 1;
+        memcpy(directory, start, length);
+        directory[length] = '\0';
+
+        DIR* dir = length > 0 ? opendir(directory) : NULL;
+        struct dirent* entry;
+        while (dir != NULL && (entry = readdir(dir)) != NULL) {
+            // Only the WDL files are listed, a missing DTZ file is noticed when it is needed
+            int nameLength = strlen(entry->d_name);
+            if (nameLength > 5 && strcmp(entry->d_name + nameLength - 5, ".rtbw") == 0) {
+                addTable(directory, entry->d_name, nameLength - 5);
+            }
+        }
+        if (dir != NULL) { closedir(dir); }
+        start = *end == '\0' ? end : end + 1;
+    }
+    return nbSyzygyTables;
+}
+
+int syzygyLargestTable() {
+    return syzygyLargest;
+}
+
+static PairsData* tableItem(SyzygyTable* table, TableFile* file, int sideToMove, int leadFile) {
+    int nbSides = file == &table->wdl ? 2 : 1;
+    return &file->items[sideToMove % nbSides][table->hasPawns ? leadFile : 0];
+}
+
+/**
+ * Splits the pieces in groups (the leading group, the remaining pawns, then one group per kind of piece) and
+ * computes the factor of each group in the index
+*/
+static void setGroups(SyzygyTable* table, PairsData* d, const int order[2], int leadFile) {
+    int n = 0;
+    int firstLength = table->hasPawns ? 0 : (table->hasUniquePieces ? 3 : 2);
+    d->groupLength[n] = 1;
+    for (int i = 1; i < table->nbPieces; i++) {
+        if (--firstLength > 0 || d->pieces[i] == d->pieces[i - 1]) {
+            d->groupLength[n]++;
+        } else {
+            d->groupLength[++n] = 1;
+        }
+    }
+    d->groupLength[++n] = 0;
+
+    // The groups are not always encoded in this order, order[0] is the position of the leading group and order[1]
+    // the one of the remaining pawns
+    bool pawnsOnBothSides = table->hasPawns && table->pawnCount[1] > 0;
+    int next = pawnsOnBothSides ? 2 : 1;
+    int freeSquares = 64 - d->groupLength[0] - (pawnsOnBothSides ? d->groupLength[1] : 0);
+    u64 index = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d->groupIndex[0] = index;
+            index *= table->hasPawns ? (u64) leadPawnsSize[d->groupLength[0]][leadFile] : (table->hasUniquePieces ? 31332 : 462);
+        } else if (k == order[1]) {
+            d->groupIndex[1] = index;
+            index *= binomial[d->groupLength[1]][48 - d->groupLength[0]];
+        } else {
+            d->groupIndex[next] = index;
+            index *= binomial[d->groupLength[next]][freeSquares];
+            freeSquares -= d->groupLength[next++];
+        }
+    }
+    d->groupIndex[n] = index;
+}
+
+static int setSymbolLength(PairsData* d, int symbol, bool* visited) {
+    visited[symbol] = true;
+    int right = rightSymbol(d->symbolTree, symbol);
+    if (right == 0xFFF) { return 0; }
+    int left = leftSymbol(d->symbolTree, symbol);
+    if (!visited[left]) { d->symbolLengths[left] = setSymbolLength(d, left, visited); }
+    if (!visited[right]) { d->symbolLengths[right] = setSymbolLength(d, right, visited); }
+    return d->symbolLengths[left] + d->symbolLengths[right] + 1;
+}
+
+/**
+ * Reads the sizes and the Huffman code of the table, returns the address after them
+*/
+static const uint8_t* setSizes(PairsData* d, const uint8_t* data) {
+    d->flags = *data++;
+    if (d->flags & FLAG_SINGLE_VALUE) {
+        d->minSymbolLength = *data++; // The value of every position
+        return data;
+    }
+
+    int nbGroups = 0;
+    while (d->groupLength[nbGroups] != 0) { nbGroups++; }
+    u64 tableSize = d->groupIndex[nbGroups];
+
+    d->blockSize = (u64) 1 << *data++;
+    d->span = (u64) 1 << *data++;
+    d->sparseIndexSize = (tableSize + d->span - 1) / d->span;
+    int padding = *data++;
+    d->nbBlocks = readLe32(data);
+    data += 4;
+    d->blockLengthSize = d->nbBlocks + padding;
+    d->maxSymbolLength = *data++;
+    d->minSymbolLength = *data++;
+    d->lowestSymbols = data;
+
+    // Canonical Huffman code: the longer codes have the lower values
+    int nbLengths = d->maxSymbolLength - d->minSymbolLength + 1;
+    d->base64 = calloc(nbLengths, sizeof(u64));
+    assert(d->base64 != NULL && "Malloc failed so buy more RAM lol");
+    for (int i = nbLengths - 2; i >= 0; i--) {
+        d->base64[i] = (d->base64[i + 1] + readLe16(d->lowestSymbols + 2 * i) - readLe16(d->lowestSymbols + 2 * (i + 1))) / 2;
+    }
+    for (int i = 0; i < nbLengths; i++) {
+        int shift = 64 - i - d->minSymbolLength;
+        d->base64[i] = shift >= 64 ? 0 : d->base64[i] << shift;
+    }
+    data += nbLengths * 2;
+
+    d->nbSymbols = readLe16(data);
+    data += 2;
+    d->symbolTree = data;
+    d->symbolLengths = calloc(d->nbSymbols > 0 ? d->nbSymbols : 1, 1);
+    bool* visited = calloc(d->nbSymbols > 0 ? d->nbSymbols : 1, sizeof(bool));
+    assert(d->symbolLengths != NULL && visited != NULL && "Malloc failed so buy more RAM lol");
+    for (int symbol = 0; symbol < d->nbSymbols; symbol++) {
+        if (!visited[symbol]) { d->symbolLengths[symbol] = setSymbolLength(d, symbol, visited); }
+    }
+    free(visited);
+    return data + d->nbSymbols * 3 + (d->nbSymbols & 1);
+}
+
+static const uint8_t* setDtzMap(SyzygyTable* table, TableFile* file, const uint8_t* data, int maxFile) {
+    file->map = data;
+    for (int f = 0; f <= maxFile; f++) {
+        PairsData* d = tableItem(table, file, 0, f);
+        if (!(d->flags & FLAG_MAPPED)) { continue; }
+        if (d->flags & FLAG_WIDE) {
+            data += (uintptr_t) data & 1;
+            for (int i = 0; i < 4; i++) {
+                d->mapIndex[i] = (data - file->map) / 2 + 1;
+                data += 2 * readLe16(data) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                d->mapIndex[i] = data - file->map + 1;
+                data += *data + 1;
+            }
+        }
+    }
+    return data + ((uintptr_t) data & 1);
+}
+
+/**
+ * Reads the description of the tables in the file, returns false if the file does not match the material
+*/
+static bool initializeTableFile(SyzygyTable* table, TableFile* file, bool isDtz) {
+    const uint8_t* data = file->file.data + 4;
+    const uint8_t* end = file->file.data + file->file.size;
+    bool isSplit = (*data & 1) != 0;
+    bool hasPawns = (*data & 2) != 0;
+    if (hasPawns != table->hasPawns || (!isDtz && isSplit != (table->key != table->key2))) { return false; }
+    data++;
+
+    int nbSides = !isDtz && table->key != table->key2 ? 2 : 1;
+    int maxFile = table->hasPawns ? 3 : 0;
+    bool pawnsOnBothSides = table->hasPawns && table->pawnCount[1] > 0;
+
+    for (int f = 0; f <= maxFile; f++) {
+        int order[2][2] = {
+            { data[0] & 0xF, pawnsOnBothSides ? data[1] & 0xF : 0xF },
+            { data[0] >> 4, pawnsOnBothSides ? data[1] >> 4 : 0xF }
+        };
+        data += 1 + pawnsOnBothSides;
+        for (int k = 0; k < table->nbPieces; k++, data++) {
+            for (int side = 0; side < nbSides; side++) {
+                tableItem(table, file, side, f)->pieces[k] = side ? *data >> 4 : *data & 0xF;
+            }
+        }
+        for (int side = 0; side < nbSides; side++) {
+            setGroups(table, tableItem(table, file, side, f), order[side], f);
+        }
+    }
+    data += (uintptr_t) data & 1;
+
+    for (int f = 0; f <= maxFile; f++) {
+        for (int side = 0; side < nbSides; side++) {
+            data = setSizes(tableItem(table, file, side, f), data);
+        }
+    }
+    if (isDtz) { data = setDtzMap(table, file, data, maxFile); }
+
+    for (int f = 0; f <= maxFile; f++) {
+        for (int side = 0; side < nbSides; side++) {
+            PairsData* d = tableItem(table, file, side, f);
+            d->sparseIndex = data;
+            data += d->sparseIndexSize * 6;
+        }
+    }
+    for (int f = 0; f <= maxFile; f++) {
+        for (int side = 0; side < nbSides; side++) {
+            PairsData* d = tableItem(table, file, side, f);
+            d->blockLengths = data;
+            data += d->blockLengthSize * 2;
+        }
+    }
+    for (int f = 0; f <= maxFile; f++) {
+        for (int side = 0; side < nbSides; side++) {
+            PairsData* d = tableItem(table, file, side, f);
+            data = (const uint8_t*) (((uintptr_t) data + 0x3F) & ~(uintptr_t) 0x3F);
+            d->data = data;
+            data += d->nbBlocks * d->blockSize;
+        }
+    }
+    return data <= end;
+}
+
+/**
+ * Maps the file the first time it is needed. Several threads can ask for the same table, the first one maps it
+*/
+static bool mapTableFile(SyzygyTable* table, bool isDtz) {
+    TableFile* file = isDtz ? &table->dtz : &table->wdl;
+    if (atomic_load_explicit(&file->ready, memory_order_acquire)) { return file->isValid; }
+
+    pthread_mutex_lock(&tableMappingMutex);
+    if (!atomic_load_explicit(&file->ready, memory_order_relaxed)) {
+        static const uint8_t magics[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+        char path[1100];
+        snprintf(path, sizeof(path), "%s%s", table->path, isDtz ? ".rtbz" : ".rtbw");
+        file->isValid = mapFile(path, &file->file);
+        if (file->isValid) {
+            file->isValid = file->file.size % 64 == 16 &&
+                memcmp(file->file.data, magics[isDtz], 4) == 0 &&
+                initializeTableFile(table, file, isDtz);
+            if (!file->isValid) { unmapFile(&file->file); }
+        }
+        atomic_store_explicit(&file->ready, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&tableMappingMutex);
+    return file->isValid;
+}
+
+/**
+ * Returns the value stored at `index`
+*/
+static int decompressPairs(const PairsData* d, u64 index) {
+    if (d->flags & FLAG_SINGLE_VALUE) { return d->minSymbolLength; }
+
+    // The sparse index gives the block and the offset of every `span` positions, from there the block lengths
+    // are walked to find the block of the index
+    uint32_t k = index / d->span;
+    uint32_t block = readLe32(d->sparseIndex + 6 * k);
+    int offset = readLe16(d->sparseIndex + 6 * k + 4);
+    offset += (int) (index % d->span) - (int) (d->span / 2);
+    while (offset < 0) {
+        offset += readLe16(d->blockLengths + 2 * --block) + 1;
+    }
+    while (offset > readLe16(d->blockLengths + 2 * block)) {
+        offset -= readLe16(d->blockLengths + 2 * block++) + 1;
+    }
+
+    // Reads the Huffman symbols of the block until the one that covers the offset
+    const uint8_t* pointer = d->data + (u64) block * d->blockSize;
+    u64 buffer = readBe64(pointer);
+    pointer += 8;
+    int bufferSize = 64;
+    int symbol;
+    while (true) {
+        int length = 0;
+        while (buffer < d->base64[length]) { length++; }
+        symbol = (buffer - d->base64[length]) >> (64 - length - d->minSymbolLength);
+        symbol += readLe16(d->lowestSymbols + 2 * length);
+        if (offset < d->symbolLengths[symbol] + 1) { break; }
+
+        offset -= d->symbolLengths[symbol] + 1;
+        length += d->minSymbolLength;
+        buffer <<= length;
+        bufferSize -= length;
+        if (bufferSize <= 32) {
+            bufferSize += 32;
+            buffer |= (u64) readBe32(pointer) << (64 - bufferSize);
+            pointer += 4;
+        }
+    }
+
+    // The symbol is a pair of symbols that expand recursively, the value is in one of the leaves
+    while (d->symbolLengths[symbol]) {
+        int left = leftSymbol(d->symbolTree, symbol);
+        if (offset < d->symbolLengths[left] + 1) {
+            symbol = left;
+        } else {
+            offset -= d->symbolLengths[left] + 1;
+            symbol = rightSymbol(d->symbolTree, symbol);
+        }
+    }
+    return leftSymbol(d->symbolTree, symbol);
+}
+
+static int mapDtzScore(SyzygyTable* table, int leadFile, int value, SyzygyWdl wdl) {
+    static const int wdlMap[5] = { 1, 3, 0, 2, 0 };
+    const PairsData* d = tableItem(table, &table->dtz, 0, leadFile);
+    if (d->flags & FLAG_MAPPED) {
+        int index = d->mapIndex[wdlMap[wdl + 2]] + value;
+        value = (d->flags & FLAG_WIDE) ? readLe16(table->dtz.map + 2 * index) : table->dtz.map[index];
+    }
+    // The distance is stored in moves or in plies
+    if ((wdl == SYZYGY_WIN && !(d->flags & FLAG_WIN_PLIES)) ||
+        (wdl == SYZYGY_LOSS && !(d->flags & FLAG_LOSS_PLIES)) ||
+        wdl == SYZYGY_CURSED_WIN ||
+        wdl == SYZYGY_BLESSED_LOSS) {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+static int compareMapPawns(int a, int b) {
+    return mapPawns[a] - mapPawns[b];
+}
+
+/**
+ * Computes the index of the position in the table, and the part of the table that has it (`data`, `leadFile`).
+ * Sets `result` to PROBE_CHANGE_SIDE when the DTZ table does not have the side to move
+*/
+static u64 encodePosition(SyzygyTable* table, TableFile* file, const GameState* state, PairsData** data, int* leadFileResult, ProbeState* result) {
+    bool isDtz = file == &table->dtz;
+    const Board* board = &state->board;
+    int squares[SYZYGY_MAX_PIECES] = { 0 };
+    int pieces[SYZYGY_MAX_PIECES] = { 0 };
+    int size = 0;
+    int nbLeadPawns = 0;
+    int leadFile = 0;
+    u64 leadPawns = 0;
+
+    // The tables have the stronger side as white, and only white to move when both sides have the same pieces,
+    // so the colors and the board are flipped for the other positions
+    bool isBlackToMove = state->colorToGo == BLACK;
+    bool isSymmetricBlackToMove = table->key == table->key2 && isBlackToMove;
+    bool isBlackStronger = materialKeyFromBoard(board) != table->key;
+    bool flip = isSymmetricBlackToMove || isBlackStronger;
+    int flipColor = flip ? 8 : 0;
+    int flipSquares = flip ? 56 : 0;
+    int sideToMove = flip != isBlackToMove;
+
+    if (table->hasPawns) {
+        // The leading pawns are the pawns of the color of the first piece of the table
+        int leadPiece = file->items[0][0].pieces[0] ^ flipColor;
+        Piece pawn = makePiece((leadPiece & 8) ? BLACK : WHITE, PAWN);
+        leadPawns = bitBoardForPiece(*board, pawn);
+        for (u64 b = leadPawns; b; b &= b - 1) {
+            squares[size++] = (trailingZeros_64(b) ^ 56) ^ flipSquares;
+        }
+        nbLeadPawns = size;
+        int leader = 0;
+        for (int i = 1; i < nbLeadPawns; i++) {
+            if (compareMapPawns(squares[leader], squares[i]) < 0) { leader = i; }
+        }
+        int swap = squares[0];
+        squares[0] = squares[leader];
+        squares[leader] = swap;
+        leadFile = edgeDistance(fileOf(squares[0]));
+    }
+
+    // The DTZ tables only have one side to move, the caller has to search one ply when it is the other one
+    if (isDtz) {
+        const PairsData* d = tableItem(table, file, sideToMove, leadFile);
+        if ((d->flags & FLAG_SIDE_TO_MOVE) != sideToMove && !(table->key == table->key2 && !table->hasPawns)) {
+            *result = PROBE_CHANGE_SIDE;
+            return 0;
+        }
+    }
+
+    for (PieceCharacteristics color = WHITE; color <= BLACK; color += WHITE) {
+        for (PieceCharacteristics type = KING; type <= PAWN; type++) {
+            u64 b = bitBoardForPiece(*board, makePiece(color, type));
+            if (type == PAWN) { b &= ~leadPawns; }
+            int code = syzygyPieceTypes[type] + (color == BLACK ? 8 : 0);
+            for (; b; b &= b - 1) {
+                squares[size] = (trailingZeros_64(b) ^ 56) ^ flipSquares;
+                pieces[size++] = code ^ flipColor;
+            }
+        }
+    }
+
+    PairsData* d = tableItem(table, file, sideToMove, leadFile);
+
+    // Same order as the pieces of the table
+    for (int i = nbLeadPawns; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (d->pieces[i] == pieces[j]) {
+                int swap = pieces[i]; pieces[i] = pieces[j]; pieces[j] = swap;
+                swap = squares[i]; squares[i] = squares[j]; squares[j] = swap;
+                break;
+            }
+        }
+    }
+
+    // The leading piece goes on the files a to d
+    if (fileOf(squares[0]) > 3) {
+        for (int i = 0; i < size; i++) { squares[i] ^= 7; }
+    }
+
+    u64 index;
+    if (table->hasPawns) {
+        index = leadPawnIndex[nbLeadPawns][squares[0]];
+        for (int i = 2; i < nbLeadPawns; i++) {
+            int square = squares[i];
+            int j = i;
+            while (j > 1 && compareMapPawns(squares[j - 1], square) > 0) {
+                squares[j] = squares[j - 1];
+                j--;
+            }
+            squares[j] = square;
+        }
+        for (int i = 1; i < nbLeadPawns; i++) {
+            index += binomial[i][mapPawns[squares[i]]];
+        }
+    } else {
+        // Without pawns, the leading piece also goes on the ranks 1 to 4, and the first piece of the leading group
+        // that is not on the a1-h8 diagonal goes below it
+        if (rankOf(squares[0]) > 3) {
+            for (int i = 0; i < size; i++) { squares[i] ^= 56; }
+        }
+        for (int i = 0; i < d->groupLength[0]; i++) {
+            if (offDiagonal(squares[i]) == 0) { continue; }
+            if (offDiagonal(squares[i]) > 0) {
+                for (int j = i; j < size; j++) {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (table->hasUniquePieces) {
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offDiagonal(squares[0])) {
+                index = ((u64) mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            } else if (offDiagonal(squares[1])) {
+                index = ((u64) 6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            } else if (offDiagonal(squares[2])) {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 +
+                    (rankOf(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]];
+            } else {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 +
+                    (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+            }
+        } else {
+            index = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The other groups, each one sorted by square, skipping the squares already taken by the previous groups
+    index *= d->groupIndex[0];
+    int groupStart = d->groupLength[0];
+    bool hasRemainingPawns = table->hasPawns && table->pawnCount[1] > 0;
+    for (int next = 1; d->groupLength[next]; next++) {
+        int* group = squares + groupStart;
+        int length = d->groupLength[next];
+        for (int i = 1; i < length; i++) {
+            int square = group[i];
+            int j = i;
+            while (j > 0 && group[j - 1] > square) {
+                group[j] = group[j - 1];
+                j--;
+            }
+            group[j] = square;
+        }
+        u64 n = 0;
+        for (int i = 0; i < length; i++) {
+            int adjust = 0;
+            for (int j = 0; j < groupStart; j++) { adjust += group[i] > squares[j]; }
+            n += binomial[i + 1][group[i] - adjust - (hasRemainingPawns ? 8 : 0)];
+        }
+        hasRemainingPawns = false;
+        index += n * d->groupIndex[next];
+        groupStart += length;
+    }
+
+    *data = d;
+    *leadFileResult = leadFile;
+    return index;
+}
+
+/**
+ * Reads the value of the position: the WDL, or the DTZ for `wdl`
+*/
+static int probeTableEntry(SyzygyTable* table, bool isDtz, const GameState* state, SyzygyWdl wdl, ProbeState* result) {
+    PairsData* d;
+    int leadFile;
+    u64 index = encodePosition(table, isDtz ? &table->dtz : &table->wdl, state, &d, &leadFile, result);
+    if (*result == PROBE_CHANGE_SIDE) { return 0; }
+    int value = decompressPairs(d, index);
+    return isDtz ? mapDtzScore(table, leadFile, value, wdl) : value - 2;
+}
+
+static int probeTable(const GameState* state, bool isDtz, SyzygyWdl wdl, ProbeState* result) {
+    if (pieceCountOfBoard(&state->board) == 2) { return SYZYGY_DRAW; }
+    SyzygyTable* table = findTable(materialKeyFromBoard(&state->board));
+    if (table == NULL || !mapTableFile(table, isDtz)) {
+        *result = PROBE_FAIL;
+        return 0;
+    }
+    return probeTableEntry(table, isDtz, state, wdl, result);
+}
+
+static bool isGameOver(Move move) {
+    Flag flag = flagFromMove(move);
+    return flag == STALEMATE || flag == CHECKMATE || flag == DRAW;
+}
+
+/**
+ * Lists the legal moves, returns their number. Checkmates and stalemates have none
+*/
+static int legalMoves(const GameState* state, Move moves[MAX_LEGAL_MOVES + 1]) {
+    memset(moves, 0, sizeof(Move) * (MAX_LEGAL_MOVES + 1));
+    getValidMoves(moves, *state, NULL);
+    if (isGameOver(moves[0])) { return 0; }
+    int nbMoves = 0;
+    while (moves[nbMoves]) { nbMoves++; }
+    return nbMoves;
+}
+
+static bool isCaptureMove(const GameState* state, Move move) {
+    return flagFromMove(move) == EN_PASSANT || pieceAtIndex(state->board, toSquareFromMove(move)) != NOPIECE;
+}
+
+static bool isZeroingMove(const GameState* state, Move move) {
+    return isCaptureMove(state, move) || pieceType(pieceAtIndex(state->board, fromSquareFromMove(move))) == PAWN;
+}
+
+/**
+ * The fifty move counter is not part of the tables, and getValidMoves would see a draw when it is too high
+*/
+static void playMove(const GameState* state, Move move, GameState* child) {
+    *child = *state;
+    makeMove(move, child);
+    child->turnsForFiftyRule = 0;
+}
+
+static bool isCheckmate(const GameState* state) {
+    Move moves[MAX_LEGAL_MOVES + 1];
+    return isInCheck(*state) && legalMoves(state, moves) == 0;
+}
+
+/**
+ * The tables can store anything for the positions where a capture is the best move (and they ignore en passant),
+ * so the captures (and the pawn moves for the DTZ) are searched before probing
+*/
+static SyzygyWdl probeSearch(const GameState* state, bool checkZeroingMoves, ProbeState* result) {
+    Move moves[MAX_LEGAL_MOVES + 1];
+    int nbMoves = legalMoves(state, moves);
+    int nbSearched = 0;
+    int bestValue = SYZYGY_LOSS;
+
+    for (int i = 0; i < nbMoves; i++) {
+        bool isPawnMove = pieceType(pieceAtIndex(state->board, fromSquareFromMove(moves[i]))) == PAWN;
+        if (!isCaptureMove(state, moves[i]) && (!checkZeroingMoves || !isPawnMove)) { continue; }
+        nbSearched++;
+
+        GameState child;
+        playMove(state, moves[i], &child);
+        int value = -probeSearch(&child, false, result);
+        if (*result == PROBE_FAIL) { return SYZYGY_DRAW; }
+        if (value > bestValue) {
+            bestValue = value;
+            if (value >= SYZYGY_WIN) {
+                *result = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // When every move was searched, the table is not needed (and could be wrong because of en passant)
+    bool isEverythingSearched = nbSearched > 0 && nbSearched == nbMoves;
+    int value;
+    if (isEverythingSearched) {
+        value = bestValue;
+    } else {
+        value = probeTable(state, false, SYZYGY_DRAW, result);
+        if (*result == PROBE_FAIL) { return SYZYGY_DRAW; }
+    }
+
+    if (bestValue >= value) {
+        *result = (bestValue > SYZYGY_DRAW || isEverythingSearched) ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return bestValue;
+    }
+    *result = PROBE_OK;
+    return value;
+}
+
+static int dtzBeforeZeroing(SyzygyWdl wdl) {
+    switch (wdl) {
+        case SYZYGY_WIN: return 1;
+        case SYZYGY_CURSED_WIN: return 101;
+        case SYZYGY_BLESSED_LOSS: return -101;
+        case SYZYGY_LOSS: return -1;
+        default: return 0;
+    }
+}
+
+static int signOf(int value) {
+    return (value > 0) - (value < 0);
+}
+
+static int probeDtz(const GameState* state, ProbeState* result) {
+    *result = PROBE_OK;
+    SyzygyWdl wdl = probeSearch(state, true, result);
+    if (*result == PROBE_FAIL || wdl == SYZYGY_DRAW) { return 0; } // The DTZ tables do not have the draws
+    if (*result == PROBE_ZEROING_BEST_MOVE) { return dtzBeforeZeroing(wdl); }
+
+    int dtz = probeTable(state, true, wdl, result);
+    if (*result == PROBE_FAIL) { return 0; }
+    if (*result != PROBE_CHANGE_SIDE) {
+        return (dtz + 100 * (wdl == SYZYGY_BLESSED_LOSS || wdl == SYZYGY_CURSED_WIN)) * signOf(wdl);
+    }
+
+    // The table has the other side to move: the DTZ is the best one after one move
+    int minDtz = 0xFFFF;
+    Move moves[MAX_LEGAL_MOVES + 1];
+    int nbMoves = legalMoves(state, moves);
+    for (int i = 0; i < nbMoves; i++) {
+        bool isZeroing = isZeroingMove(state, moves[i]);
+        GameState child;
+        playMove(state, moves[i], &child);
+
+        // For zeroing moves, the DTZ is the one before the move, with the sign of the position after it
+        if (isZeroing) {
+            *result = PROBE_OK;
+            dtz = -dtzBeforeZeroing(probeSearch(&child, false, result));
+        } else {
+            dtz = -probeDtz(&child, result);
+        }
+        if (*result == PROBE_FAIL) { return 0; }
+
+        if (dtz == 1 && isCheckmate(&child)) { minDtz = 1; }
+        if (!isZeroing) { dtz += signOf(dtz); }
+        if (dtz < minDtz && signOf(dtz) == signOf(wdl)) { minDtz = dtz; }
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz; // No legal move: mated
+}
+
+static bool canProbe(const GameState* state) {
+    return state->castlingPerm == 0 && pieceCountOfBoard(&state->board) <= syzygyLargest;
+}
+
+bool syzygyProbeWdl(const GameState* state, SyzygyWdl* result) {
+    if (!canProbe(state)) { return false; }
+    GameState position = *state;
+    position.turnsForFiftyRule = 0;
+    ProbeState probeState = PROBE_OK;
+    *result = probeSearch(&position, false, &probeState);
+    return probeState != PROBE_FAIL;
+}
+
+bool syzygyProbeDtz(const GameState* state, int* result) {
+    if (!canProbe(state)) { return false; }
+    GameState position = *state;
+    position.turnsForFiftyRule = 0;
+    ProbeState probeState;
+    *result = probeDtz(&position, &probeState);
+    return probeState != PROBE_FAIL;
+}
+
+int syzygyRootMoves(const GameState* state, Move results[MAX_LEGAL_MOVES + 1]) {
+    memset(results, 0, sizeof(Move) * (MAX_LEGAL_MOVES + 1));
+    if (!canProbe(state)) { return 0; }
+    GameState position = *state;
+    position.turnsForFiftyRule = 0;
+    int fiftyMoveCounter = state->turnsForFiftyRule;
+
+    Move moves[MAX_LEGAL_MOVES + 1];
+    int ranks[MAX_LEGAL_MOVES];
+    int nbMoves = legalMoves(&position, moves);
+    int bestRank = -MAX_DTZ - 1;
+    for (int i = 0; i < nbMoves; i++) {
+        GameState child;
+        playMove(&position, moves[i], &child);
+        ProbeState probeState = PROBE_OK;
+        int dtz;
+        if (isZeroingMove(&position, moves[i])) {
+            dtz = dtzBeforeZeroing(-probeSearch(&child, false, &probeState));
+        } else {
+            dtz = -probeDtz(&child, &probeState);
+            dtz = dtz > 0 ? dtz + 1 : (dtz < 0 ? dtz - 1 : dtz);
+        }
+        if (probeState == PROBE_FAIL) { return 0; }
+        if (dtz == 2 && isCheckmate(&child)) { dtz = 1; }
+
+        // The wins that come before the fifty move rule are all as good, then the closer the zeroing the better.
+        // The losses are all as bad, unless the fifty move rule can save the game
+        if (dtz > 0) {
+            ranks[i] = dtz + fiftyMoveCounter <= 99 ? MAX_DTZ : MAX_DTZ - (dtz + fiftyMoveCounter);
+        } else if (dtz < 0) {
+            ranks[i] = -dtz * 2 + fiftyMoveCounter < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + fiftyMoveCounter);
+        } else {
+            ranks[i] = 0;
+        }
+        if (ranks[i] > bestRank) { bestRank = ranks[i]; }
+    }
+
+    int nbResults = 0;
+    for (int i = 0; i < nbMoves; i++) {
+        if (ranks[i] == bestRank) { results[nbResults++] = moves[i]; }
+    }
+    return nbResults;
+}
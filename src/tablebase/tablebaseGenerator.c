@@ -0,0 +1,633 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "TablebaseGenerator.h"
+#include "EndgameTable.h"
+#include "../MoveGenerator.h"
+#include "../magicBitBoard/MagicBitBoard.h"
+
+/*
+Retrograde generation of an endgame table.
+
+While generating, each position has a 16 bits value:
+- UNKNOWN_VALUE until the position is solved
+- an odd number d: the side to move mates in d plies
+- an even number d: the side to move is mated in d plies
+- DRAW_VALUE or INVALID_VALUE
+
+Captures and promotions leave the table, so their outcomes are looked up once in the smaller tables and kept in
+`conversions` (the best one for the side to move). Then, for d = 1, 2, 3...:
+- odd d: the predecessors of the positions lost in d - 1 plies (found with unmoves) are won in d plies
+- even d: the predecessors of the positions won in d - 1 plies become candidates, and a candidate is lost in d plies
+  when all of its moves lead to positions won by the opponent
+Positions that are still unknown when nothing changes anymore are draws.
+*/
+
+#define UNKNOWN_VALUE 0xFFFF
+#define INVALID_VALUE 0xFFFE
+#define DRAW_VALUE 0xFFFD
+#define MAX_GENERATOR_MOVES 256
+#define MAX_SUB_TABLES 32
+
+typedef struct Generator {
+    EndgameMaterial material;
+    u64 nbPositions; // Both sides, white to move first
+    uint16_t* values;
+    uint16_t* conversions;
+    unsigned char* candidates;
+    EndgameTable subTables[MAX_SUB_TABLES];
+    int nbSubTables;
+    int nbThreads;
+    int ply;
+} Generator;
+
+typedef struct GeneratorThread {
+    Generator* generator;
+    u64 start;
+    u64 end;
+    u64 nbChanges;
+    int maxConversion;
+    void (*phase)(struct GeneratorThread*);
+} GeneratorThread;
+
+static const PieceCharacteristics promotionTypes[4] = { QUEEN, ROOK, BISHOP, KNIGHT };
+
+static uint16_t loadValue(const uint16_t* values, u64 position) {
+    return __atomic_load_n(&values[position], __ATOMIC_RELAXED);
+}
+
+static void storeValue(uint16_t* values, u64 position, uint16_t value) {
+    __atomic_store_n(&values[position], value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Orders the values for the side to move: quick wins first, then slow wins, draws, slow losses and quick losses
+*/
+static int valueRank(uint16_t value) {
+    if (value == UNKNOWN_VALUE) { return -1000000; }
+    if (value == DRAW_VALUE) { return 0; }
+    return (value & 1) ? 100000 - value : -100000 + value;
+}
+
+static PieceCharacteristics sideColor(int side) {
+    return side == 0 ? WHITE : BLACK;
+}
+
+static void boardFromSquares(const EndgameMaterial* material, const int* squares, Board* board) {
+    memset(board, 0, sizeof(Board));
+    for (int i = 0; i < material->nbPieces; i++) {
+        togglePieceAtIndex(board, squares[i], material->pieces[i]);
+    }
+}
+
+static u64 pieceAttacks(PieceCharacteristics type, int square, u64 occupancy) {
+    switch (type) {
+        case KING: return kingMovementMask[square];
+        case KNIGHT: return knightMovementMask[square];
+        case BISHOP: return getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square]);
+        case ROOK: return getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square]);
+        case QUEEN:
+            return getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square]) |
+                getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square]);
+        default: return 0;
+    }
+}
+
+static bool isKingAttacked(const Board* board, PieceCharacteristics kingColor) {
+    int kingSquare = trailingZeros_64(bitBoardForPiece(*board, makePiece(kingColor, KING)));
+    PieceCharacteristics attackerColor = kingColor == WHITE ? BLACK : WHITE;
+    return attackersOfSquare(*board, kingSquare, allPiecesBitBoard(*board), attackerColor) != 0;
+}
+
+/**
+ * Decodes the position, returns false if it is not a legal position or if it is not the canonical index of its position
+*/
+static bool decodePosition(const Generator* generator, u64 position, int* squares, int* side, Board* board) {
+    const EndgameMaterial* material = &generator->material;
+    *side = position >= material->nbPositionsPerSide;
+    u64 index = position - (*side ? material->nbPositionsPerSide : 0);
+    endgamePositionFromIndex(material, index, squares);
+
+    u64 occupancy = 0;
+    for (int i = 0; i < material->nbPieces; i++) {
+        u64 bit = ((u64) 1) << squares[i];
+        if (occupancy & bit) { return false; }
+        occupancy |= bit;
+        int row = squares[i] / BOARD_LENGTH;
+        if (pieceType(material->pieces[i]) == PAWN && (row == 0 || row == 7)) { return false; }
+    }
+    boardFromSquares(material, squares, board);
+    if (endgamePositionIndex(material, board, false) != index) { return false; }
+    return !isKingAttacked(board, sideColor(!*side));
+}
+
+/**
+ * Returns the value of the position reached with a capture or a promotion, for the opponent, from the smaller tables
+*/
+static uint16_t conversionValue(const Generator* generator, const Board* child, PieceCharacteristics opponentColor) {
+    if (__builtin_popcountll(allPiecesBitBoard(*child)) == 2) { return DRAW_VALUE; }
+
+    EndgameProbe probe;
+    for (int i = 0; i < generator->nbSubTables; i++) {
+        if (probeEndgameTableBoard(&generator->subTables[i], child, opponentColor, &probe)) {
+            if (probe.wdl == ENDGAME_WIN) { return 2 * probe.movesToMate - 1; }
+            if (probe.wdl == ENDGAME_LOSS) { return 2 * probe.movesToMate; }
+            return DRAW_VALUE;
+        }
+    }
+    assert(false && "Missing sub table");
+    return DRAW_VALUE;
+}
+
+/**
+ * Plays all the legal moves of the position. The positions reached without a capture or a promotion are written in
+ * `children`, the best outcome of the other moves in `conversion` when it is not NULL.
+ * Returns the number of legal moves
+*/
+static int generateChildren(const Generator* generator, const int* squares, int side, const Board* board, u64* children, int* nbChildren, uint16_t* conversion) {
+    const EndgameMaterial* material = &generator->material;
+    PieceCharacteristics color = sideColor(side);
+    PieceCharacteristics opponentColor = sideColor(!side);
+    u64 own = color == WHITE ? whitePiecesBitBoard(*board) : blackPiecesBitBoard(*board);
+    u64 occupancy = allPiecesBitBoard(*board);
+    u64 childOffset = side == 0 ? material->nbPositionsPerSide : 0;
+    int nbLegalMoves = 0;
+    *nbChildren = 0;
+
+    for (int i = 0; i < material->nbPieces; i++) {
+        Piece piece = material->pieces[i];
+        if (pieceColor(piece) != color) { continue; }
+        int from = squares[i];
+        PieceCharacteristics type = pieceType(piece);
+
+        u64 targets;
+        if (type == PAWN) {
+            int forward = color == WHITE ? -BOARD_LENGTH : BOARD_LENGTH;
+            int startRow = color == WHITE ? 6 : 1;
+            u64 opponents = occupancy & ~own;
+            targets = 0;
+            if (!(occupancy & (((u64) 1) << (from + forward)))) {
+                targets |= ((u64) 1) << (from + forward);
+                if (from / BOARD_LENGTH == startRow && !(occupancy & (((u64) 1) << (from + 2 * forward)))) {
+                    targets |= ((u64) 1) << (from + 2 * forward);
+                }
+            }
+            int file = from % BOARD_LENGTH;
+            if (file > 0) { targets |= opponents & (((u64) 1) << (from + forward - 1)); }
+            if (file < 7) { targets |= opponents & (((u64) 1) << (from + forward + 1)); }
+        } else {
+            targets = pieceAttacks(type, from, occupancy) & ~own;
+        }
+
+        while (targets) {
+            int to = trailingZeros_64(targets);
+            targets &= targets - 1;
+            Piece captured = pieceAtIndex(*board, to);
+            int toRow = to / BOARD_LENGTH;
+            bool isPromotion = type == PAWN && (toRow == 0 || toRow == 7);
+
+            for (int p = 0; p < (isPromotion ? 4 : 1); p++) {
+                Board child = *board;
+                togglePieceAtIndex(&child, from, piece);
+                if (captured != NOPIECE) { togglePieceAtIndex(&child, to, captured); }
+                togglePieceAtIndex(&child, to, isPromotion ? makePiece(color, promotionTypes[p]) : piece);
+                if (isKingAttacked(&child, color)) { break; } // The promotion piece does not change the legality
+                nbLegalMoves++;
+
+                if (captured == NOPIECE && !isPromotion) {
+                    children[(*nbChildren)++] = childOffset + endgamePositionIndex(material, &child, false);
+                } else if (conversion != NULL) {
+                    uint16_t value = conversionValue(generator, &child, opponentColor);
+                    // Turn the value for the opponent into the value for the side to move
+                    if (value != DRAW_VALUE) { value++; }
+                    if (valueRank(value) > valueRank(*conversion)) { *conversion = value; }
+                }
+            }
+        }
+    }
+    return nbLegalMoves;
+}
+
+/**
+ * Writes the positions from which the side that just moved could have reached this position without a capture or
+ * a promotion. Returns the number of predecessors
+*/
+static int generatePredecessors(const Generator* generator, const int* squares, int side, const Board* board, u64* predecessors) {
+    const EndgameMaterial* material = &generator->material;
+    PieceCharacteristics color = sideColor(!side); // The side that just moved
+    u64 occupancy = allPiecesBitBoard(*board);
+    u64 predecessorOffset = side == 0 ? material->nbPositionsPerSide : 0;
+    int nbPredecessors = 0;
+
+    for (int i = 0; i < material->nbPieces; i++) {
+        Piece piece = material->pieces[i];
+        if (pieceColor(piece) != color) { continue; }
+        int to = squares[i];
+        PieceCharacteristics type = pieceType(piece);
+
+        u64 origins;
+        if (type == PAWN) {
+            int backward = color == WHITE ? BOARD_LENGTH : -BOARD_LENGTH;
+            int doublePushRow = color == WHITE ? 4 : 3;
+            origins = 0;
+            int origin = to + backward;
+            int originRow = origin / BOARD_LENGTH;
+            if (originRow != 0 && originRow != 7 && !(occupancy & (((u64) 1) << origin))) {
+                origins |= ((u64) 1) << origin;
+                if (to / BOARD_LENGTH == doublePushRow && !(occupancy & (((u64) 1) << (origin + backward)))) {
+                    assert((origin + backward) / BOARD_LENGTH == (color == WHITE ? 6 : 1) && "A double push starts from the start row");
+                    origins |= ((u64) 1) << (origin + backward);
+                }
+            }
+        } else {
+            origins = pieceAttacks(type, to, occupancy) & ~occupancy;
+        }
+
+        while (origins) {
+            int from = trailingZeros_64(origins);
+            origins &= origins - 1;
+            Board predecessor = *board;
+            togglePieceAtIndex(&predecessor, to, piece);
+            togglePieceAtIndex(&predecessor, from, piece);
+            u64 position = predecessorOffset + endgamePositionIndex(material, &predecessor, false);
+            if (loadValue(generator->values, position) != INVALID_VALUE) {
+                predecessors[nbPredecessors++] = position;
+            }
+        }
+    }
+    return nbPredecessors;
+}
+
+static void initializationPhase(GeneratorThread* thread) {
+    Generator* generator = thread->generator;
+    int squares[MAX_ENDGAME_PIECES];
+    int side;
+    Board board;
+    u64 children[MAX_GENERATOR_MOVES];
+    int nbChildren;
+    for (u64 position = thread->start; position < thread->end; position++) {
+        generator->conversions[position] = UNKNOWN_VALUE;
+        generator->candidates[position] = 0;
+        if (!decodePosition(generator, position, squares, &side, &board)) {
+            generator->values[position] = INVALID_VALUE;
+            continue;
+        }
+        uint16_t conversion = UNKNOWN_VALUE;
+        int nbLegalMoves = generateChildren(generator, squares, side, &board, children, &nbChildren, &conversion);
+        generator->conversions[position] = conversion;
+        if (nbLegalMoves == 0) {
+            generator->values[position] = isKingAttacked(&board, sideColor(side)) ? 0 : DRAW_VALUE;
+        } else {
+            generator->values[position] = UNKNOWN_VALUE;
+        }
+        if (conversion != UNKNOWN_VALUE && conversion != DRAW_VALUE && conversion > thread->maxConversion) {
+            thread->maxConversion = conversion;
+        }
+    }
+}
+
+/**
+ * Odd plies: the predecessors of the positions lost in ply - 1 are won in ply
+*/
+static void winningPhase(GeneratorThread* thread) {
+    Generator* generator = thread->generator;
+    uint16_t ply = generator->ply;
+    int squares[MAX_ENDGAME_PIECES];
+    int side;
+    Board board;
+    u64 predecessors[MAX_GENERATOR_MOVES];
+    for (u64 position = thread->start; position < thread->end; position++) {
+        uint16_t value = loadValue(generator->values, position);
+        if (value == UNKNOWN_VALUE && generator->conversions[position] == ply) {
+            storeValue(generator->values, position, ply);
+            thread->nbChanges++;
+        }
+        if (value != ply - 1) { continue; }
+        decodePosition(generator, position, squares, &side, &board);
+        int nbPredecessors = generatePredecessors(generator, squares, side, &board, predecessors);
+        for (int i = 0; i < nbPredecessors; i++) {
+            if (loadValue(generator->values, predecessors[i]) == UNKNOWN_VALUE) {
+                storeValue(generator->values, predecessors[i], ply);
+                thread->nbChanges++;
+            }
+        }
+    }
+}
+
+/**
+ * Even plies, first half: the predecessors of the positions won in ply - 1 might be lost in ply
+*/
+static void candidatePhase(GeneratorThread* thread) {
+    Generator* generator = thread->generator;
+    uint16_t ply = generator->ply;
+    int squares[MAX_ENDGAME_PIECES];
+    int side;
+    Board board;
+    u64 predecessors[MAX_GENERATOR_MOVES];
+    for (u64 position = thread->start; position < thread->end; position++) {
+        if (loadValue(generator->values, position) != ply - 1) { continue; }
+        decodePosition(generator, position, squares, &side, &board);
+        int nbPredecessors = generatePredecessors(generator, squares, side, &board, predecessors);
+        for (int i = 0; i < nbPredecessors; i++) {
+            __atomic_store_n(&generator->candidates[predecessors[i]], 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Even plies, second half: a candidate is lost in ply if all of its moves lose
+*/
+static void losingPhase(GeneratorThread* thread) {
+    Generator* generator = thread->generator;
+    uint16_t ply = generator->ply;
+    int squares[MAX_ENDGAME_PIECES];
+    int side;
+    Board board;
+    u64 children[MAX_GENERATOR_MOVES];
+    int nbChildren;
+    for (u64 position = thread->start; position < thread->end; position++) {
+        uint16_t conversion = generator->conversions[position];
+        bool isCandidate = __atomic_load_n(&generator->candidates[position], __ATOMIC_RELAXED);
+        if (!isCandidate && conversion != ply) { continue; }
+        __atomic_store_n(&generator->candidates[position], 0, __ATOMIC_RELAXED);
+        if (loadValue(generator->values, position) != UNKNOWN_VALUE) { continue; }
+        // A capture or a promotion that does not lose (or loses slower) saves the position for now
+        if (conversion != UNKNOWN_VALUE && (conversion == DRAW_VALUE || (conversion & 1) || conversion > ply)) { continue; }
+
+        decodePosition(generator, position, squares, &side, &board);
+        generateChildren(generator, squares, side, &board, children, &nbChildren, NULL);
+        bool isLost = true;
+        for (int i = 0; i < nbChildren && isLost; i++) {
+            uint16_t value = loadValue(generator->values, children[i]);
+            isLost = value != UNKNOWN_VALUE && value != DRAW_VALUE && (value & 1) && value < ply;
+        }
+        if (isLost) {
+            storeValue(generator->values, position, ply);
+            thread->nbChanges++;
+        }
+    }
+}
+
+static void* runGeneratorThread(void* arg) {
+    GeneratorThread* thread = arg;
+    thread->phase(thread);
+    return NULL;
+}
+
+/**
+ * Runs the phase on all the positions, split in one range per thread. Returns the number of changed positions
+*/
+static u64 runPhase(Generator* generator, void (*phase)(GeneratorThread*), int* maxConversion) {
+    int nbThreads = generator->nbThreads;
+    GeneratorThread threads[nbThreads];
+    pthread_t handles[nbThreads];
+    u64 rangeSize = (generator->nbPositions + nbThreads - 1) / nbThreads;
+    for (int i = 0; i < nbThreads; i++) {
+        threads[i] = (GeneratorThread) { generator, i * rangeSize, (i + 1) * rangeSize, 0, 0, phase };
+        if (threads[i].start > generator->nbPositions) { threads[i].start = generator->nbPositions; }
+        if (threads[i].end > generator->nbPositions) { threads[i].end = generator->nbPositions; }
+    }
+    // The first range is done on this thread
+    for (int i = 1; i < nbThreads; i++) {
+        int error = pthread_create(&handles[i], NULL, runGeneratorThread, &threads[i]);
+        assert(error == 0 && "Could not create a generator thread");
+        (void) error;
+    }
+    phase(&threads[0]);
+    u64 nbChanges = threads[0].nbChanges;
+    for (int i = 1; i < nbThreads; i++) {
+        pthread_join(handles[i], NULL);
+        nbChanges += threads[i].nbChanges;
+    }
+    if (maxConversion != NULL) {
+        for (int i = 0; i < nbThreads; i++) {
+            if (threads[i].maxConversion > *maxConversion) { *maxConversion = threads[i].maxConversion; }
+        }
+    }
+    return nbChanges;
+}
+
+static void buildTablePath(const char* directory, const EndgameMaterial* material, char* path, size_t size) {
+    char name[16];
+    endgameMaterialName(material, name);
+    snprintf(path, size, "%s/%s%s", directory, name, ENDGAME_TABLE_EXTENSION);
+}
+
+/**
+ * Adds the materials reachable with one capture or one promotion (with or without a capture)
+*/
+static int subMaterials(const EndgameMaterial* material, EndgameMaterial* results) {
+    int nbResults = 0;
+    for (int i = 0; i < material->nbPieces; i++) {
+        PieceCharacteristics type = pieceType(material->pieces[i]);
+        if (type == KING) { continue; }
+        int nbReplacements = type == PAWN ? 5 : 1;
+        for (int r = 0; r < nbReplacements; r++) {
+            // r == 0 is the capture of the piece, the others are promotions which can also capture another piece
+            for (int j = -1; j < (r == 0 ? 0 : material->nbPieces); j++) {
+                if (j == i || (j >= 0 && (pieceType(material->pieces[j]) == KING || pieceColor(material->pieces[j]) == pieceColor(material->pieces[i])))) {
+                    continue;
+                }
+                Piece pieces[MAX_ENDGAME_PIECES];
+                int nbPieces = 0;
+                for (int k = 0; k < material->nbPieces; k++) {
+                    if (k == j) { continue; }
+                    if (k == i) {
+                        if (r == 0) { continue; }
+                        pieces[nbPieces++] = makePiece(pieceColor(material->pieces[i]), promotionTypes[r - 1]);
+                    } else {
+                        pieces[nbPieces++] = material->pieces[k];
+                    }
+                }
+                EndgameMaterial result;
+                if (nbPieces <= 2 || !makeEndgameMaterial(pieces, nbPieces, &result, NULL)) { continue; }
+                bool isNew = true;
+                for (int k = 0; k < nbResults; k++) {
+                    if (isSameEndgameMaterial(&results[k], &result)) { isNew = false; }
+                }
+                if (isNew) {
+                    assert(nbResults < MAX_SUB_TABLES);
+                    results[nbResults++] = result;
+                }
+            }
+        }
+    }
+    return nbResults;
+}
+
+static bool writeBytes(FILE* file, const void* data, size_t size) {
+    return fwrite(data, 1, size, file) == size;
+}
+
+static unsigned char movesToMate(uint16_t value) {
+    if (value == UNKNOWN_VALUE || value == INVALID_VALUE || value == DRAW_VALUE) { return 0; }
+    int moves = (value & 1) ? (value + 1) / 2 : value / 2;
+    return moves > 255 ? 255 : moves;
+}
+
+/**
+ * Run length encodes a block of distances to mate, returns the encoded size
+*/
+static int encodeBlock(const unsigned char* block, int size, unsigned char* result) {
+    int length = 0;
+    for (int i = 0; i < size;) {
+        int run = 1;
+        while (i + run < size && block[i + run] == block[i]) { run++; }
+        result[length++] = run;
+        result[length++] = block[i];
+        i += run;
+    }
+    return length;
+}
+
+/**
+ * Fills the DTM block at `blockIndex`, returns its size
+*/
+static int dtmBlock(const Generator* generator, u64 blockIndex, unsigned char* block) {
+    u64 start = blockIndex * ENDGAME_DTM_BLOCK_SIZE;
+    int size = 0;
+    for (u64 position = start; position < generator->nbPositions && size < ENDGAME_DTM_BLOCK_SIZE; position++) {
+        block[size++] = movesToMate(generator->values[position]);
+    }
+    return size;
+}
+
+static bool writeTable(const Generator* generator, const char* path) {
+    char temporaryPath[512 + sizeof(".tmp")]; // The paths are built in 512 bytes buffers
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+    FILE* file = fopen(temporaryPath, "wb");
+    if (file == NULL) { return false; }
+
+    const EndgameMaterial* material = &generator->material;
+    u64 nbWdlBytes = endgameWdlBytes(material);
+    u64 nbBlocks = endgameDtmBlocks(material);
+    EndgameTableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "CTB1", 4);
+    header.version = 1;
+    header.nbPieces = material->nbPieces;
+    header.blockSize = ENDGAME_DTM_BLOCK_SIZE;
+    for (int i = 0; i < material->nbPieces; i++) { header.pieces[i] = material->pieces[i]; }
+    header.nbPositionsPerSide = material->nbPositionsPerSide;
+    header.wdlOffset = sizeof(header);
+    header.dtmIndexOffset = header.wdlOffset + nbWdlBytes;
+    header.dtmDataOffset = header.dtmIndexOffset + nbBlocks * sizeof(uint32_t);
+    header.nbBlocks = nbBlocks;
+    bool isWritten = writeBytes(file, &header, sizeof(header));
+
+    unsigned char buffer[4096];
+    size_t bufferSize = 0;
+    for (u64 i = 0; i < nbWdlBytes && isWritten; i++) {
+        unsigned char byte = 0;
+        for (int j = 0; j < 4 && i * 4 + j < generator->nbPositions; j++) {
+            uint16_t value = generator->values[i * 4 + j];
+            EndgameWdl wdl = ENDGAME_DRAW;
+            if (value == INVALID_VALUE) { wdl = ENDGAME_ILLEGAL; }
+            else if (value != UNKNOWN_VALUE && value != DRAW_VALUE) { wdl = (value & 1) ? ENDGAME_WIN : ENDGAME_LOSS; }
+            byte |= wdl << (j * 2);
+        }
+        buffer[bufferSize++] = byte;
+        if (bufferSize == sizeof(buffer)) {
+            isWritten = writeBytes(file, buffer, bufferSize);
+            bufferSize = 0;
+        }
+    }
+    isWritten = isWritten && writeBytes(file, buffer, bufferSize);
+
+    // The index needs the size of every block, so the blocks are encoded twice instead of being kept in memory
+    unsigned char block[ENDGAME_DTM_BLOCK_SIZE];
+    unsigned char encoded[2 * ENDGAME_DTM_BLOCK_SIZE];
+    uint32_t offset = 0;
+    for (u64 i = 0; i < nbBlocks && isWritten; i++) {
+        int size = dtmBlock(generator, i, block);
+        int encodedSize = encodeBlock(block, size, encoded);
+        uint32_t entry = encodedSize < size ? offset : (offset | ENDGAME_DTM_RAW_BLOCK);
+        unsigned char bytes[4] = { entry, entry >> 8, entry >> 16, entry >> 24 };
+        isWritten = writeBytes(file, bytes, sizeof(bytes));
+        offset += encodedSize < size ? encodedSize : size;
+    }
+    for (u64 i = 0; i < nbBlocks && isWritten; i++) {
+        int size = dtmBlock(generator, i, block);
+        int encodedSize = encodeBlock(block, size, encoded);
+        isWritten = encodedSize < size ? writeBytes(file, encoded, encodedSize) : writeBytes(file, block, size);
+    }
+
+    isWritten = fclose(file) == 0 && isWritten;
+    if (!isWritten || rename(temporaryPath, path) != 0) {
+        remove(temporaryPath);
+        return false;
+    }
+    return true;
+}
+
+static bool generateMaterial(const EndgameMaterial* material, const char* directory, int nbThreads) {
+    char path[512];
+    buildTablePath(directory, material, path, sizeof(path));
+    if (access(path, F_OK) == 0) { return true; }
+
+    Generator* generator = calloc(1, sizeof(Generator));
+    assert(generator != NULL && "Malloc failed so buy more RAM lol");
+    generator->material = *material;
+    generator->nbPositions = 2 * material->nbPositionsPerSide;
+    generator->nbThreads = nbThreads < 1 ? 1 : nbThreads;
+
+    EndgameMaterial subs[MAX_SUB_TABLES];
+    int nbSubs = subMaterials(material, subs);
+    bool isGenerated = true;
+    for (int i = 0; i < nbSubs && isGenerated; i++) {
+        char subPath[512];
+        buildTablePath(directory, &subs[i], subPath, sizeof(subPath));
+        isGenerated = generateMaterial(&subs[i], directory, nbThreads) &&
+            openEndgameTable(subPath, &generator->subTables[generator->nbSubTables]);
+        if (isGenerated) { generator->nbSubTables++; }
+    }
+
+    if (isGenerated) {
+        char name[16];
+        endgameMaterialName(material, name);
+        u64 startTime = time(NULL);
+        generator->values = malloc(generator->nbPositions * sizeof(uint16_t));
+        generator->conversions = malloc(generator->nbPositions * sizeof(uint16_t));
+        generator->candidates = malloc(generator->nbPositions);
+        assert(generator->values != NULL && generator->conversions != NULL && generator->candidates != NULL && "Malloc failed so buy more RAM lol");
+
+        int maxConversion = 0;
+        runPhase(generator, initializationPhase, &maxConversion);
+        int nbStepsWithoutChanges = 0;
+        int maxPly = 0;
+        for (generator->ply = 1; nbStepsWithoutChanges < 2 || generator->ply <= maxConversion; generator->ply++) {
+            u64 nbChanges;
+            if (generator->ply & 1) {
+                nbChanges = runPhase(generator, winningPhase, NULL);
+            } else {
+                runPhase(generator, candidatePhase, NULL);
+                nbChanges = runPhase(generator, losingPhase, NULL);
+            }
+            nbStepsWithoutChanges = nbChanges ? 0 : nbStepsWithoutChanges + 1;
+            if (nbChanges) { maxPly = generator->ply; }
+        }
+        isGenerated = writeTable(generator, path);
+        printf("%s: %" PRIu64 " positions, longest mate in %d moves, %" PRIu64 "s\n", name, generator->nbPositions, (maxPly + 1) / 2, (u64) time(NULL) - startTime);
+        fflush(stdout);
+        free(generator->values);
+        free(generator->conversions);
+        free(generator->candidates);
+    }
+
+    for (int i = 0; i < generator->nbSubTables; i++) {
+        closeEndgameTable(&generator->subTables[i]);
+    }
+    free(generator);
+    return isGenerated;
+}
+
+bool generateEndgameTable(const char* materialName, const char* directory, int nbThreads) {
+    EndgameMaterial material;
+    if (!parseEndgameMaterial(materialName, &material)) { return false; }
+    return generateMaterial(&material, directory, nbThreads);
+}
@@ -0,0 +1,386 @@
+// UCI front end of the engine: https://www.wbec-ridderkerk.nl/html/UCIProtocol.html
+// The input loop never waits for the search, which runs on its own thread
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <assert.h>
+#include "../magicBitBoard/MagicBitBoard.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../utils/FenString.h"
+#include "../utils/MoveNotation.h"
+#include "../search/Search.h"
+#include "../search/TranspositionTable.h"
+#include "../search/TimeManager.h"
+#include "../book/PolyglotBook.h"
+#include "../tablebase/Syzygy.h"
+#include "../tablebase/EndgameTable.h"
+#include "../nnue/Nnue.h"
+
+#define ENGINE_NAME "C_ChessEngine"
+#define ENGINE_AUTHOR "C_ChessEngine contributors"
+
+#define STARTING_POSITION "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define DEFAULT_HASH_SIZE 16 // In MB
+#define MAX_HASH_SIZE 65536
+#define MAX_THREADS 256
+#define MAX_UCI_LINE_LENGTH 16384 // Enough for a position command with a few thousand moves
+
+GameState position;
+// The positions before the current one, oldest first and 0 terminated like getValidMoves expects
+GameState* history;
+int nbHistoryStates;
+int historyCapacity;
+
+TranspositionTable* table;
+int nbThreads = 1;
+int multiPv = 1;
+PolyglotBook book; // Empty until the BookFile option is set
+u64 bookRandomState;
+
+pthread_t searchThread;
+bool isSearching = false;
+SearchLimits searchLimits;
+bool isInfiniteSearch;
+atomic_bool stopSearchFlag;
+atomic_bool ponderFlag; // True from `go ponder` until ponderhit
+// An infinite or ponder search must not send its best move before stop or ponderhit, even when it is done searching
+pthread_mutex_t stopMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t stopCondition = PTHREAD_COND_INITIALIZER;
+
+void pushHistoryState(const GameState* state) {
+    if (nbHistoryStates + 1 >= historyCapacity) {
+        historyCapacity = historyCapacity == 0 ? 256 : historyCapacity * 2;
+        history = realloc(history, sizeof(GameState) * historyCapacity);
+        assert(history != NULL && "Malloc failed so buy more RAM lol");
+    }
+    history[nbHistoryStates++] = *state;
+    memset(&history[nbHistoryStates], 0, sizeof(GameState));
+}
+
+void clearHistory() {
+    nbHistoryStates = 0;
+    if (history != NULL) {
+        memset(&history[0], 0, sizeof(GameState));
+    }
+}
+
+void wakeUpSearch(atomic_bool* flag, bool value) {
+    pthread_mutex_lock(&stopMutex);
+    atomic_store(flag, value);
+    pthread_cond_broadcast(&stopCondition);
+    pthread_mutex_unlock(&stopMutex);
+}
+
+/**
+ * Stops the current search, if any, and waits for it to send its best move
+*/
+void stopSearch() {
+    if (!isSearching) { return; }
+    wakeUpSearch(&stopSearchFlag, true);
+    pthread_join(searchThread, NULL);
+    isSearching = false;
+}
+
+void printIteration(const SearchResult* result, void* userData) {
+    (void) userData;
+    char line[64 + MAX_PLY * 6];
+    int length = 0;
+
+    length += sprintf(line + length, "info depth %d seldepth %d multipv %d ", result->depth, result->selectiveDepth, result->multiPv);
+    if (isMateScore(result->score)) {
+        int plies = MATE_SCORE - abs(result->score);
+        int moves = (plies + 1) / 2;
+        length += sprintf(line + length, "score mate %d ", result->score > 0 ? moves : -moves);
+    } else {
+        length += sprintf(line + length, "score cp %d ", result->score);
+    }
+    length += sprintf(line + length, "nodes %" PRIu64 " nps %" PRIu64 " time %" PRIu64 " hashfull %d tbhits %" PRIu64 " pv",
+        result->nodes, result->nodesPerSecond, result->time, transpositionTableHashFull(table), result->tablebaseHits);
+    for (int i = 0; i < result->principalVariationLength; i++) {
+        char move[6];
+        moveToUci(result->principalVariation[i], move);
+        length += sprintf(line + length, " %s", move);
+    }
+    printf("%s\n", line);
+    fflush(stdout);
+}
+
+void* searchThreadMain(void* data) {
+    (void) data;
+    SearchOptions options = defaultSearchOptions();
+    options.nbThreads = nbThreads;
+    options.multiPv = multiPv;
+    options.onIteration = printIteration;
+    SearchResult result = searchPosition(&position, history, searchLimits, options, table);
+
+    pthread_mutex_lock(&stopMutex);
+    while (!atomic_load(&stopSearchFlag) && (isInfiniteSearch || atomic_load(&ponderFlag))) {
+        pthread_cond_wait(&stopCondition, &stopMutex);
+    }
+    pthread_mutex_unlock(&stopMutex);
+
+    if (result.bestMove == 0) {
+        printf("bestmove 0000\n");
+    } else {
+        char move[6];
+        moveToUci(result.bestMove, move);
+        if (result.principalVariationLength >= 2) {
+            // The expected reply, which the GUI can give back with go ponder
+            char ponderMove[6];
+            moveToUci(result.principalVariation[1], ponderMove);
+            printf("bestmove %s ponder %s\n", move, ponderMove);
+        } else {
+            printf("bestmove %s\n", move);
+        }
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+void setPosition(char* arguments) {
+    char* savePointer;
+    char* token = strtok_r(arguments, " ", &savePointer);
+    char fenString[MAX_FEN_LENGTH] = STARTING_POSITION;
+    bool isTooLong = false;
+
+    if (token != NULL && strcmp(token, "fen") == 0) {
+        // The fen string is everything up to the moves, the counters are optional
+        int nbFields = 0;
+        fenString[0] = '\0';
+        while ((token = strtok_r(NULL, " ", &savePointer)) != NULL && strcmp(token, "moves") != 0) {
+            // The separator and the 0 at the end
+            if (strlen(fenString) + strlen(token) + 2 > MAX_FEN_LENGTH) { isTooLong = true; }
+            if (isTooLong) { continue; }
+            if (nbFields > 0) { strcat(fenString, " "); }
+            strcat(fenString, token);
+            nbFields++;
+        }
+        if (nbFields == 4 && strlen(fenString) + strlen(" 0 1") + 1 <= MAX_FEN_LENGTH) { strcat(fenString, " 0 1"); }
+    } else {
+        token = strtok_r(NULL, " ", &savePointer);
+    }
+
+    GameState newPosition;
+    if (isTooLong || !setGameStateFromFenString(fenString, &newPosition)) {
+        printf("info string invalid position\n");
+        fflush(stdout);
+        return;
+    }
+    position = newPosition;
+    clearHistory();
+
+    if (token == NULL || strcmp(token, "moves") != 0) { return; }
+    while ((token = strtok_r(NULL, " ", &savePointer)) != NULL) {
+        Move move = moveFromUci(&position, token);
+        if (move == 0) {
+            printf("info string illegal move %s\n", token);
+            fflush(stdout);
+            return;
+        }
+        pushHistoryState(&position);
+        makeMove(move, &position);
+    }
+}
+
+// xorshift64, only used to vary the book moves
+u64 nextBookRandom() {
+    bookRandomState ^= bookRandomState << 13;
+    bookRandomState ^= bookRandomState >> 7;
+    bookRandomState ^= bookRandomState << 17;
+    return bookRandomState;
+}
+
+void go(char* arguments) {
+    SearchLimits limits = { 0 };
+    bool isWhite = position.colorToGo == WHITE;
+    isInfiniteSearch = false;
+    atomic_store(&ponderFlag, false);
+
+    char* savePointer;
+    char* token = strtok_r(arguments, " ", &savePointer);
+    while (token != NULL) {
+        char* value = strtok_r(NULL, " ", &savePointer);
+        if (strcmp(token, "infinite") == 0 || strcmp(token, "ponder") == 0) {
+            if (strcmp(token, "infinite") == 0) {
+                isInfiniteSearch = true;
+            } else {
+                atomic_store(&ponderFlag, true);
+            }
+            token = value;
+            continue;
+        }
+        if (value == NULL) { break; }
+
+        if (strcmp(token, "depth") == 0) {
+            limits.depth = atoi(value);
+        } else if (strcmp(token, "nodes") == 0) {
+            limits.nodes = strtoull(value, NULL, 10);
+        } else if (strcmp(token, "movetime") == 0) {
+            limits.moveTime = atoi(value);
+        } else if (strcmp(token, isWhite ? "wtime" : "btime") == 0) {
+            // A clock can be negative when the engine is already late, it still has to move as fast as possible
+            limits.timeLeft = atoi(value) > 1 ? atoi(value) : 1;
+        } else if (strcmp(token, isWhite ? "winc" : "binc") == 0) {
+            limits.increment = atoi(value);
+        } else if (strcmp(token, "movestogo") == 0) {
+            limits.movesToGo = atoi(value);
+        }
+        token = strtok_r(NULL, " ", &savePointer);
+    }
+
+    // A book move is played right away, there is nothing to search
+    if (!isInfiniteSearch && !atomic_load(&ponderFlag)) {
+        Move bookMove = pickPolyglotBookMove(&book, &position, nextBookRandom());
+        if (bookMove != 0) {
+            char move[6];
+            moveToUci(bookMove, move);
+            printf("bestmove %s\n", move);
+            fflush(stdout);
+            return;
+        }
+    }
+
+    atomic_store(&stopSearchFlag, false);
+    limits.stop = &stopSearchFlag;
+    limits.ponder = &ponderFlag;
+    searchLimits = limits;
+    isSearching = pthread_create(&searchThread, NULL, searchThreadMain, NULL) == 0;
+    assert(isSearching && "Could not start the search thread");
+}
+
+void setOption(char* arguments) {
+    // setoption name <name> value <value>
+    char* name = strstr(arguments, "name ");
+    char* value = strstr(arguments, " value ");
+    if (name == NULL || value == NULL) { return; }
+    name += strlen("name ");
+    *value = '\0';
+    value += strlen(" value ");
+
+    if (strcmp(name, "Hash") == 0) {
+        int megabytes = atoi(value);
+        if (megabytes < 1) { megabytes = 1; }
+        if (megabytes > MAX_HASH_SIZE) { megabytes = MAX_HASH_SIZE; }
+        resizeTranspositionTable(table, megabytes);
+    } else if (strcmp(name, "Threads") == 0) {
+        nbThreads = atoi(value);
+        if (nbThreads < 1) { nbThreads = 1; }
+        if (nbThreads > MAX_THREADS) { nbThreads = MAX_THREADS; }
+    } else if (strcmp(name, "MultiPV") == 0) {
+        multiPv = atoi(value);
+        if (multiPv < 1) { multiPv = 1; }
+        if (multiPv > MAX_LEGAL_MOVES) { multiPv = MAX_LEGAL_MOVES; }
+    } else if (strcmp(name, "BookFile") == 0) {
+        closePolyglotBook(&book);
+        if (strcmp(value, "<empty>") != 0 && !openPolyglotBook(value, &book)) {
+            printf("info string could not open the book %s\n", value);
+            fflush(stdout);
+        }
+    } else if (strcmp(name, "EvalFile") == 0) {
+        // Without a network the search uses the hand written evaluation. The search is stopped, so nothing holds it
+        if (strcmp(value, "<empty>") == 0) {
+            nnueUnloadNetwork();
+        } else if (!nnueLoadNetwork(value)) {
+            printf("info string could not load the network %s\n", value);
+            fflush(stdout);
+        }
+    } else if (strcmp(name, "SyzygyPath") == 0) {
+        int nbTables = syzygyInitialize(strcmp(value, "<empty>") != 0 ? value : NULL);
+        printf("info string found %d tablebases\n", nbTables);
+        fflush(stdout);
+    } else if (strcmp(name, "EndgamePath") == 0) {
+        int nbTables = endgameTablesInitialize(strcmp(value, "<empty>") != 0 ? value : NULL);
+        printf("info string found %d endgame tables\n", nbTables);
+        fflush(stdout);
+    }
+}
+
+void printIdentity() {
+    printf("id name %s\n", ENGINE_NAME);
+    printf("id author %s\n", ENGINE_AUTHOR);
+    printf("option name Hash type spin default %d min 1 max %d\n", DEFAULT_HASH_SIZE, MAX_HASH_SIZE);
+    printf("option name Threads type spin default 1 min 1 max %d\n", MAX_THREADS);
+    printf("option name Ponder type check default false\n");
+    printf("option name MultiPV type spin default 1 min 1 max %d\n", MAX_LEGAL_MOVES);
+    printf("option name BookFile type string default <empty>\n");
+    printf("option name EvalFile type string default <empty>\n");
+    printf("option name SyzygyPath type string default <empty>\n");
+    printf("option name EndgamePath type string default <empty>\n");
+    printf("uciok\n");
+    fflush(stdout);
+}
+
+int main() {
+    magicBitBoardInitialize();
+    table = createTranspositionTable(DEFAULT_HASH_SIZE);
+    bookRandomState = currentTimeNanoseconds() | 1;
+    char startingPosition[] = STARTING_POSITION;
+    setGameStateFromFenString(startingPosition, &position);
+
+    static char line[MAX_UCI_LINE_LENGTH];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        size_t length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            // The rest of the line does not fit, so the command is skipped instead of being cut
+            int character;
+            while ((character = getchar()) != EOF && character != '\n') {}
+            printf("info string the command is longer than %d characters\n", MAX_UCI_LINE_LENGTH - 1);
+            fflush(stdout);
+            continue;
+        }
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        char* arguments = strchr(line, ' ');
+        if (arguments != NULL) {
+            *arguments = '\0';
+            arguments++;
+        } else {
+            arguments = line + length;
+        }
+        char* command = line;
+
+        if (strcmp(command, "uci") == 0) {
+            printIdentity();
+        } else if (strcmp(command, "isready") == 0) {
+            printf("readyok\n");
+            fflush(stdout);
+        } else if (strcmp(command, "ucinewgame") == 0) {
+            stopSearch();
+            clearTranspositionTable(table);
+        } else if (strcmp(command, "position") == 0) {
+            stopSearch();
+            setPosition(arguments);
+        } else if (strcmp(command, "go") == 0) {
+            stopSearch();
+            go(arguments);
+        } else if (strcmp(command, "stop") == 0) {
+            stopSearch();
+        } else if (strcmp(command, "ponderhit") == 0) {
+            // The expected move was played: the search carries on with the clock of the go command
+            if (isSearching) {
+                wakeUpSearch(&ponderFlag, false);
+            }
+        } else if (strcmp(command, "setoption") == 0) {
+            stopSearch();
+            setOption(arguments);
+        } else if (strcmp(command, "quit") == 0) {
+            break;
+        }
+    }
+
+    stopSearch();
+    free(history);
+    closePolyglotBook(&book);
+    syzygyFree();
+    endgameTablesFree();
+    nnueUnloadNetwork();
+    freeTranspositionTable(table);
+    magicBitBoardTerminate();
+    return 0;
+}
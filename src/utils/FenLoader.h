@@ -0,0 +1,26 @@
+#ifndef FEN_LOADER_H
+#define FEN_LOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/GameState.h"
+
+/**
+ * The positions of a FEN or EPD file, in the order of the file
+*/
+typedef struct LoadedPositions {
+    GameState* states; // NULL when there are none
+    size_t nbStates;
+    size_t nbInvalidLines; // The lines that are not empty, not a comment (#) and do not start with a valid fen string
+} LoadedPositions;
+
+/**
+ * Maps the file in memory and parses one position per line, splitting the file between `nbThreads` threads.
+ * Only the fen string at the start of each line is read, so the EPD operations after it are ignored.
+ * Returns false if the file cannot be read, an empty file gives no positions. The states are freed with freeLoadedPositions
+*/
+bool loadPositionsFromFile(const char* path, int nbThreads, LoadedPositions* result);
+
+void freeLoadedPositions(LoadedPositions* positions);
+
+#endif
@@ -2,8 +2,32 @@
 #define FEN_STRING_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "../state/GameState.h"
 
-bool setGameStateFromFenString(char* fenString, GameState* result);
+/**
+ * Parses the fen string in the first `length` characters of `fen`, which does not need to be 0 terminated.
+ * The two move counters are optional (0 and 1 by default), so the start of an EPD line can be given as is.
+ * Nothing is shared between calls, so several threads can parse at the same time.
+ * Returns the number of characters read, up to the end of the last field, or 0 if the fen string is invalid.
+ * A position without exactly one king per side, or where the side that is not to move is in check, is invalid too.
+ * So is a castling right without its king and rook on their starting squares, or an en passant square that is not
+ * behind a pawn that was just pushed two squares (6th rank with white to move, 3rd rank with black to move)
+*/
+size_t parseFenString(const char* fen, size_t length, GameState* result);
 
-#endif
\ No newline at end of file
+/**
+ * Same as parseFenString on a 0 terminated string, returns false if the fen string is invalid
+*/
+bool setGameStateFromFenString(const char* fenString, GameState* result);
+
+// Enough for every position, with the 0 at the end
+#define MAX_FEN_LENGTH 128
+
+/**
+ * Writes the fen string of the position in `buffer`, 0 terminated. Does not allocate and does not use stdio.
+ * Returns the length of the fen string, or 0 if it does not fit in `length` characters (MAX_FEN_LENGTH always fits)
+*/
+size_t gameStateToFen(const GameState* state, char* buffer, size_t length);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A read only view of a whole file mapped in memory.
+ * Reading from `data` only costs page faults, the file is never copied on the heap.
+*/
+typedef struct MappedFile {
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+} MappedFile;
+
+/**
+ * Maps the file at `path` in memory.
+ * Returns false if the file cannot be opened or is empty
+*/
+bool mapFile(const char* path, MappedFile* result);
+
+void unmapFile(MappedFile* file);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MOVE_NOTATION_H
+#define MOVE_NOTATION_H
+
+#include <stddef.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+
+/**
+ * Returns the legal move written in standard algebraic notation (like Nf3, exd6, O-O or e8=Q+) in the first `length` characters of `san`,
+ * or 0 if there is no such move or if the notation is ambiguous.
+ * The check and mate suffixes and the annotations (!, ?) are optional, castling can also be written with zeros (0-0).
+ * The fifty move rule is ignored, so a move is still found in a position that could be claimed as a draw
+*/
+Move moveFromSan(const GameState* state, const char* san, size_t length);
+
+// The longest moves in standard algebraic notation are like Qa1xb2# or exd8=Q+, with the 0 at the end
+#define MAX_SAN_LENGTH 8
+
+/**
+ * Writes the legal move `move` of `state` in standard algebraic notation, 0 terminated, and returns its length.
+ * The disambiguation comes from the attacks on the target square instead of the move generator,
+ * which only runs for the moves that give check, to tell a check from a mate
+*/
+int moveToSan(const GameState* state, Move move, char result[MAX_SAN_LENGTH]);
+
+// Like e2e4, e1g1 for castling or a7a8q, with the 0 at the end
+#define MAX_UCI_LENGTH 6
+
+void moveToUci(Move move, char result[MAX_UCI_LENGTH]);
+
+/**
+ * Returns the legal move written as `uci` (0 terminated), or 0 if there is none. The fifty move rule is ignored like in moveFromSan
+*/
+Move moveFromUci(const GameState* state, const char* uci);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PACKED_POSITION_FILE_H
+#define PACKED_POSITION_FILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/PackedPosition.h"
+
+/**
+ * A packed position file is an 8 byte header followed by the 32 byte positions, with the numbers in little endian.
+ * The files can be concatenated after removing the header of the second one
+*/
+#define PACKED_POSITION_FILE_MAGIC "CEPACK01"
+#define PACKED_POSITION_FILE_MAGIC_LENGTH 8
+
+typedef struct PackedPositionWriter {
+    FILE* file;
+    PackedPosition* buffer; // The positions are written in blocks
+    size_t nbBuffered;
+    u64 nbPositions; // Written since the file was opened
+    bool hasFailed;
+} PackedPositionWriter;
+
+typedef struct PackedPositionReader {
+    FILE* file;
+} PackedPositionReader;
+
+/**
+ * Creates (or truncates) the file and writes its header. Returns false if the file cannot be written
+*/
+bool openPackedPositionWriter(const char* path, PackedPositionWriter* writer);
+
+/**
+ * Returns false if a write failed, the positions after a failure are dropped
+*/
+bool writePackedPosition(PackedPositionWriter* writer, const PackedPosition* position);
+
+/**
+ * Writes the last positions and closes the file. Returns false if any write failed
+*/
+bool closePackedPositionWriter(PackedPositionWriter* writer);
+
+/**
+ * Returns false if the file cannot be opened or does not start with the header
+*/
+bool openPackedPositionReader(const char* path, PackedPositionReader* reader);
+
+/**
+ * Reads the next positions of the file, up to `maxPositions`. Returns the number of positions read, 0 at the end of the file
+*/
+size_t readPackedPositions(PackedPositionReader* reader, PackedPosition* positions, size_t maxPositions);
+
+void closePackedPositionReader(PackedPositionReader* reader);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PGN_READER_H
+#define PGN_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../state/GameState.h"
+#include "../state/Move.h"
+
+typedef enum PgnResult {
+    PGN_UNKNOWN_RESULT, // *
+    PGN_WHITE_WINS,
+    PGN_BLACK_WINS,
+    PGN_DRAW
+} PgnResult;
+
+/**
+ * A position of an imported game, given to the callback with the move that was played from it
+*/
+typedef struct PgnPosition {
+    const GameState* state; // Only valid during the callback
+    Move move; // 0 for the last position of the game
+    int ply; // 0 for the first position of the game
+    PgnResult result; // The result of the whole game
+    size_t gameOffset; // Where the game starts in the file, which gives the order of the games
+} PgnPosition;
+
+/**
+ * Called from the import threads at the same time, so it has to be thread safe.
+ * The positions of a game are given in order by one thread, but the games are not in the order of the file
+*/
+typedef void (*PgnPositionCallback)(const PgnPosition* position, void* userData);
+
+typedef struct PgnImportStats {
+    size_t nbGames; // The valid games, whose positions were given to the callback
+    size_t nbInvalidGames; // Games with a move that is not legal or cannot be read, none of their positions are given
+    size_t nbPositions;
+} PgnImportStats;
+
+/**
+ * Maps the PGN file in memory and replays its games on `nbThreads` threads, which take the file piece by piece.
+ * The games start from the FEN tag when there is one. The comments, the variations and the annotations are skipped.
+ * Needs the magic bitboards to be initialized. Returns false if the file cannot be read
+*/
+bool importPgnFile(const char* path, int nbThreads, PgnPositionCallback onPosition, void* userData, PgnImportStats* stats);
+
+#endif
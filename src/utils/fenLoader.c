@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "FenLoader.h"
+#include "FenString.h"
+#include "MappedFile.h"
+
+// Smaller files are not worth another thread
+#define MIN_CHUNK_SIZE (1 << 16)
+
+/**
+ * The lines of the file between `start` and `end`, which are line boundaries.
+ * The first pass counts the lines, the second one parses them at `firstState`
+*/
+typedef struct FenChunk {
+    const char* start;
+    const char* end;
+    size_t nbLines;
+    GameState* firstState;
+    size_t nbStates;
+    size_t nbInvalidLines;
+} FenChunk;
+
+static void* countFenLines(void* data) {
+    FenChunk* chunk = data;
+    chunk->nbLines = 0;
+    const char* cursor = chunk->start;
+    while (cursor < chunk->end) {
+        const char* newLine = memchr(cursor, '\n', chunk->end - cursor);
+        chunk->nbLines++;
+        cursor = newLine != NULL ? newLine + 1 : chunk->end;
+    }
+    return NULL;
+}
+
+static void* parseFenLines(void* data) {
+    FenChunk* chunk = data;
+    const char* cursor = chunk->start;
+    while (cursor < chunk->end) {
+        const char* newLine = memchr(cursor, '\n', chunk->end - cursor);
+        const char* lineEnd = newLine != NULL ? newLine : chunk->end;
+
+        const char* lineStart = cursor;
+        while (lineStart < lineEnd && (*lineStart == ' ' || *lineStart == '\t' || *lineStart == '\r')) { lineStart++; }
+        if (lineStart < lineEnd && *lineStart != '#') {
+            if (parseFenString(lineStart, lineEnd - lineStart, &chunk->firstState[chunk->nbStates])) {
+                chunk->nbStates++;
+            } else {
+                chunk->nbInvalidLines++;
+            }
+        }
+        cursor = lineEnd < chunk->end ? lineEnd + 1 : chunk->end;
+    }
+    return NULL;
+}
+
+/**
+ * Runs `function` on every chunk, the first one on the calling thread
+*/
+static void runOnChunks(void* (*function)(void*), FenChunk* chunks, int nbChunks) {
+    pthread_t threads[nbChunks];
+    for (int i = 1; i < nbChunks; i++) {
+        int error = pthread_create(&threads[i], NULL, function, &chunks[i]);
+        assert(error == 0 && "Could not start a fen loader thread");
+        (void) error;
+    }
+    function(&chunks[0]);
+    for (int i = 1; i < nbChunks; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static bool isEmptyFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) { return false; }
+    bool isEmpty = fgetc(file) == EOF && !ferror(file);
+    fclose(file);
+    return isEmpty;
+}
+
+bool loadPositionsFromFile(const char* path, int nbThreads, LoadedPositions* result) {
+    memset(result, 0, sizeof(LoadedPositions));
+    MappedFile file;
+    // mapFile refuses empty files, which have no positions but can be read
+    if (!mapFile(path, &file)) { return isEmptyFile(path); }
+
+    const char* data = (const char*) file.data;
+    const char* end = data + file.size;
+    int nbChunks = nbThreads > 1 ? nbThreads : 1;
+    if ((size_t) nbChunks > file.size / MIN_CHUNK_SIZE) { nbChunks = file.size / MIN_CHUNK_SIZE > 0 ? file.size / MIN_CHUNK_SIZE : 1; }
+
+    // Every chunk starts right after a new line, so that no line is split
+    FenChunk chunks[nbChunks];
+    memset(chunks, 0, sizeof(chunks));
+    const char* chunkStart = data;
+    for (int i = 0; i < nbChunks; i++) {
+        const char* chunkEnd = i == nbChunks - 1 ? end : data + file.size / nbChunks * (i + 1);
+        if (chunkEnd < chunkStart) { chunkEnd = chunkStart; }
+        if (chunkEnd < end) {
+            const char* newLine = memchr(chunkEnd, '\n', end - chunkEnd);
+            chunkEnd = newLine != NULL ? newLine + 1 : end;
+        }
+        chunks[i].start = chunkStart;
+        chunks[i].end = chunkEnd;
+        chunkStart = chunkEnd;
+    }
+
+    runOnChunks(countFenLines, chunks, nbChunks);
+    size_t nbLines = 0;
+    for (int i = 0; i < nbChunks; i++) { nbLines += chunks[i].nbLines; }
+    GameState* states = malloc(sizeof(GameState) * (nbLines > 0 ? nbLines : 1));
+    assert(states != NULL && "Malloc failed so buy more RAM lol");
+
+    size_t firstLine = 0;
+    for (int i = 0; i < nbChunks; i++) {
+        chunks[i].firstState = states + firstLine;
+        firstLine += chunks[i].nbLines;
+    }
+    runOnChunks(parseFenLines, chunks, nbChunks);
+    unmapFile(&file);
+
+    // The invalid lines, comments and empty lines left gaps at the end of each chunk
+    for (int i = 0; i < nbChunks; i++) {
+        memmove(states + result->nbStates, chunks[i].firstState, sizeof(GameState) * chunks[i].nbStates);
+        result->nbStates += chunks[i].nbStates;
+        result->nbInvalidLines += chunks[i].nbInvalidLines;
+    }
+    if (result->nbStates == 0) {
+        free(states);
+        return true;
+    }
+    if (result->nbStates < nbLines) {
+        GameState* shrunk = realloc(states, sizeof(GameState) * result->nbStates);
+        if (shrunk != NULL) { states = shrunk; }
+    }
+    result->states = states;
+    return true;
+}
+
+void freeLoadedPositions(LoadedPositions* positions) {
+    free(positions->states);
+    memset(positions, 0, sizeof(LoadedPositions));
+}
@@ -1,127 +1,303 @@
-#include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
-#include <assert.h>
 #include "FenString.h"
+#include "../state/Zobrist.h"
+#include "../magicBitBoard/MagicBitBoard.h"
 
-int getCastlingPermFromFenString(char* fen) {
-    int result = 0;
-    if (strcmp(fen, "-") == 0) return result;
-    for (size_t i = 0; i < strlen(fen); i++) {
-        char c = fen[i];
-        if (c == 'K') {
-            result |= (1 << 3);
-        } else if (c == 'Q') {
-            result |= (1 << 2);
-        } else if (c == 'k') {
-            result |= (1 << 1);
-        } else if (c == 'q') {
-            result |= (1 << 0);
+// The biggest move counter that is read, the digits after it are still skipped
+#define MAX_FEN_COUNTER 1000000
+
+static bool isFenSeparator(char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * A field ends with a space, the end of the string or the start of the EPD operations
+*/
+static bool isFenFieldEnd(const char* cursor, const char* end) {
+    return cursor == end || isFenSeparator(*cursor) || *cursor == ';' || *cursor == '\r' || *cursor == '\n';
+}
+
+static const char* skipFenSeparators(const char* cursor, const char* end) {
+    while (cursor < end && isFenSeparator(*cursor)) { cursor++; }
+    return cursor;
+}
+
+// NOPIECE for the characters that are not pieces
+static const Piece fenPieces[128] = {
+    ['K'] = WHITE | KING, ['Q'] = WHITE | QUEEN, ['R'] = WHITE | ROOK,
+    ['B'] = WHITE | BISHOP, ['N'] = WHITE | KNIGHT, ['P'] = WHITE | PAWN,
+    ['k'] = BLACK | KING, ['q'] = BLACK | QUEEN, ['r'] = BLACK | ROOK,
+    ['b'] = BLACK | BISHOP, ['n'] = BLACK | KNIGHT, ['p'] = BLACK | PAWN,
+};
+
+/**
+ * Reads the 8 ranks, from the 8th to the 1st. Returns NULL if they are not exactly 8 squares each
+*/
+static const char* parseFenBoard(const char* cursor, const char* end, Board* board) {
+    int rank = 0, file = 0;
+    for (; !isFenFieldEnd(cursor, end); cursor++) {
+        char c = *cursor;
+        if (c == '/') {
+            if (file != BOARD_LENGTH || rank == BOARD_LENGTH - 1) { return NULL; }
+            rank++;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > BOARD_LENGTH) { return NULL; }
+        } else {
+            Piece piece = (unsigned char) c < 128 ? fenPieces[(unsigned char) c] : NOPIECE;
+            if (piece == NOPIECE || file >= BOARD_LENGTH) { return NULL; }
+            u64 square = (u64) 1 << (rank * BOARD_LENGTH + file);
+            board->pieces[PIECE_TYPE_INDEX(piece)] |= square;
+            board->colors[PIECE_COLOR_INDEX(piece)] |= square;
+            file++;
         }
     }
-    return result;
+    return (rank == BOARD_LENGTH - 1 && file == BOARD_LENGTH) ? cursor : NULL;
 }
 
-void setBoardArrayFromFenString(char* fen, Piece* board) {
-  int row = 0, col = 0;
-  for (size_t i = 0; i < strlen(fen); i++) {
-    char fenChar = fen[i];
-    if (fenChar == '/') {
-      row++;
-      col = 0;
-    } else if (fenChar >= '1' && fenChar <= '8') {
-      int emptySquares = fenChar - '0';
-      for (int j = 0; j < emptySquares; j++) {
-        board[row * 8 + col] = NOPIECE;
-        col++;
-      }
-    } else {
-      switch (fenChar) {
-        case 'P':
-          board[row * 8 + col] = WHITE | PAWN;
-          break;
-        case 'N':
-          board[row * 8 + col] = WHITE | KNIGHT;
-          break;
-        case 'B':
-          board[row * 8 + col] = WHITE | BISHOP;
-          break;
-        case 'R':
-          board[row * 8 + col] = WHITE | ROOK;
-          break;
-        case 'Q':
-          board[row * 8 + col] = WHITE | QUEEN;
-          break;
-        case 'K':
-          board[row * 8 + col] = WHITE | KING;
-          break;
-        case 'p':
-          board[row * 8 + col] = BLACK | PAWN;
-          break;
-        case 'n':
-          board[row * 8 + col] = BLACK | KNIGHT;
-          break;
-        case 'b':
-          board[row * 8 + col] = BLACK | BISHOP;
-          break;
-        case 'r':
-          board[row * 8 + col] = BLACK | ROOK;
-          break;
-        case 'q':
-          board[row * 8 + col] = BLACK | QUEEN;
-          break;
-        case 'k':
-          board[row * 8 + col] = BLACK | KING;
-          break;
-      }
-      col++;
+static const char* parseFenCastling(const char* cursor, const char* end, uint8_t* castlingPerm) {
+    *castlingPerm = 0;
+    if (cursor < end && *cursor == '-') { return isFenFieldEnd(cursor + 1, end) ? cursor + 1 : NULL; }
+    const char* start = cursor;
+    for (; !isFenFieldEnd(cursor, end); cursor++) {
+        switch (*cursor) {
+            case 'K': *castlingPerm |= 1 << 3; break;
+            case 'Q': *castlingPerm |= 1 << 2; break;
+            case 'k': *castlingPerm |= 1 << 1; break;
+            case 'q': *castlingPerm |= 1 << 0; break;
+            default: return NULL;
+        }
     }
-  }
+    return cursor != start ? cursor : NULL;
 }
 
-int convertSquareToIndex(char* square) {
-    if (strcmp(square,"-") == 0) { return -1; }
-    int file = square[0] - 'a';
-    int rank = 8 - (square[1] - '0');
-    return rank * 8 + file;
+static const char* parseFenEnPassant(const char* cursor, const char* end, int8_t* enPassantTargetSquare) {
+    *enPassantTargetSquare = -1;
+    if (cursor < end && *cursor == '-') { return isFenFieldEnd(cursor + 1, end) ? cursor + 1 : NULL; }
+    if (end - cursor < 2 || cursor[0] < 'a' || cursor[0] > 'h' || (cursor[1] != '3' && cursor[1] != '6')) { return NULL; }
+    if (!isFenFieldEnd(cursor + 2, end)) { return NULL; }
+    int file = cursor[0] - 'a';
+    int rank = 8 - (cursor[1] - '0');
+    *enPassantTargetSquare = (int8_t) (rank * BOARD_LENGTH + file);
+    return cursor + 2;
 }
 
-#define splitString \
-do { \
-    split = strtok(NULL, " "); \
-    if (split == NULL) { return false; } \
-} while (0);
+/**
+ * Returns NULL if the field is not a number, which is not an error since the counters are optional
+*/
+static const char* parseFenCounter(const char* cursor, const char* end, int* result) {
+    const char* start = cursor;
+    int value = 0;
+    for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++) {
+        if (value < MAX_FEN_COUNTER) { value = value * 10 + (*cursor - '0'); }
+    }
+    if (cursor == start || !isFenFieldEnd(cursor, end)) { return NULL; }
+    *result = value;
+    return cursor;
+}
+
+/**
+ * Whether a piece of `attackerColor` attacks `square`. It walks the rays instead of using the magic bitboards,
+ * so that a fen string can be parsed before magicBitBoardInitialize
+*/
+static bool isFenSquareAttacked(const Board* board, int square, PieceCharacteristics attackerColor) {
+    const u64 attackers = board->colors[PIECE_COLOR_INDEX(attackerColor)];
+    const u64 occupancy = board->colors[0] | board->colors[1];
+    if (knightMovementMask[square] & board->pieces[PIECE_TYPE_INDEX(KNIGHT)] & attackers) { return true; }
+    if (kingMovementMask[square] & board->pieces[PIECE_TYPE_INDEX(KING)] & attackers) { return true; }
+
+    const int file = square % BOARD_LENGTH, rank = square / BOARD_LENGTH;
+    // The white pawns attack towards the 8th rank, which is the rank 0 here
+    const int pawnRank = attackerColor == WHITE ? rank + 1 : rank - 1;
+    const u64 pawns = board->pieces[PIECE_TYPE_INDEX(PAWN)] & attackers;
+    if (pawnRank >= 0 && pawnRank < BOARD_LENGTH) {
+        if (file > 0 && (pawns >> (pawnRank * BOARD_LENGTH + file - 1)) & 1) { return true; }
+        if (file < BOARD_LENGTH - 1 && (pawns >> (pawnRank * BOARD_LENGTH + file + 1)) & 1) { return true; }
+    }
+
+    // The 4 rook directions then the 4 bishop directions, as file and rank steps
+    static const int directions[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+    const u64 queens = board->pieces[PIECE_TYPE_INDEX(QUEEN)];
+    const u64 straightSliders = (board->pieces[PIECE_TYPE_INDEX(ROOK)] | queens) & attackers;
+    const u64 diagonalSliders = (board->pieces[PIECE_TYPE_INDEX(BISHOP)] | queens) & attackers;
+    for (int direction = 0; direction < 8; direction++) {
+        const u64 sliders = direction < 4 ? straightSliders : diagonalSliders;
+        int f = file + directions[direction][0], r = rank + directions[direction][1];
+        for (; f >= 0 && f < BOARD_LENGTH && r >= 0 && r < BOARD_LENGTH; f += directions[direction][0], r += directions[direction][1]) {
+            const u64 squareBitBoard = (u64) 1 << (r * BOARD_LENGTH + f);
+            if (sliders & squareBitBoard) { return true; }
+            if (occupancy & squareBitBoard) { break; }
+        }
+    }
+    return false;
+}
+
+/**
+ * The move generator needs one king per side, and the side that just moved cannot have left its king in check
+*/
+static bool isFenPositionPlayable(const GameState* state) {
+    const u64 kings = state->board.pieces[PIECE_TYPE_INDEX(KING)];
+    for (int colorIndex = 0; colorIndex < 2; colorIndex++) {
+        const u64 king = kings & state->board.colors[colorIndex];
+        if (king == 0 || (king & (king - 1)) != 0) { return false; }
+    }
+    const PieceCharacteristics waitingColor = state->colorToGo == WHITE ? BLACK : WHITE;
+    const int waitingKing = trailingZeros_64(kings & state->board.colors[PIECE_COLOR_INDEX(waitingColor)]);
+    return !isFenSquareAttacked(&state->board, waitingKing, state->colorToGo);
+}
+
+/**
+ * Each castling right needs its king and its rook on their starting squares
+*/
+static bool areFenCastlingRightsPlayable(const GameState* state) {
+    // K, Q, k and q, with the square of the king then the square of the rook
+    static const int castlingSquares[4][3] = { { 1 << 3, 60, 63 }, { 1 << 2, 60, 56 }, { 1 << 1, 4, 7 }, { 1 << 0, 4, 0 } };
+    for (int i = 0; i < 4; i++) {
+        if (!(state->castlingPerm & castlingSquares[i][0])) { continue; }
+        const PieceCharacteristics color = i < 2 ? WHITE : BLACK;
+        const u64 colorBitBoard = state->board.colors[PIECE_COLOR_INDEX(color)];
+        const u64 king = state->board.pieces[PIECE_TYPE_INDEX(KING)] & colorBitBoard;
+        const u64 rooks = state->board.pieces[PIECE_TYPE_INDEX(ROOK)] & colorBitBoard;
+        if (!((king >> castlingSquares[i][1]) & 1) || !((rooks >> castlingSquares[i][2]) & 1)) { return false; }
+    }
+    return true;
+}
+
+/**
+ * The en passant square is behind a pawn of the side that just moved, on the 6th rank when white is to move
+ * and on the 3rd rank when black is to move. The square and the one the pawn came from are empty
+*/
+static bool isFenEnPassantPlayable(const GameState* state) {
+    if (state->enPassantTargetSquare == -1) { return true; }
+    const int square = state->enPassantTargetSquare;
+    // The 6th rank is the row 2 here, and the 3rd rank the row 5
+    const int expectedRow = state->colorToGo == WHITE ? 2 : 5;
+    if (square / BOARD_LENGTH != expectedRow) { return false; }
+    const int forward = state->colorToGo == WHITE ? BOARD_LENGTH : -BOARD_LENGTH;
+    const PieceCharacteristics pawnColor = state->colorToGo == WHITE ? BLACK : WHITE;
+    const u64 pawns = state->board.pieces[PIECE_TYPE_INDEX(PAWN)] & state->board.colors[PIECE_COLOR_INDEX(pawnColor)];
+    const u64 occupancy = state->board.colors[0] | state->board.colors[1];
+    return ((pawns >> (square + forward)) & 1) && !((occupancy >> square) & 1) && !((occupancy >> (square - forward)) & 1);
+}
+
+size_t parseFenString(const char* fen, size_t length, GameState* result) {
+    if (result == NULL || fen == NULL) { return 0; }
+    const char* end = fen + length;
+    const char* cursor = skipFenSeparators(fen, end);
+
+    GameState state;
+    memset(&state, 0, sizeof(GameState));
+    if ((cursor = parseFenBoard(cursor, end, &state.board)) == NULL) { return 0; }
+
+    cursor = skipFenSeparators(cursor, end);
+    if (cursor == end || (*cursor != 'w' && *cursor != 'b') || !isFenFieldEnd(cursor + 1, end)) { return 0; }
+    state.colorToGo = *cursor == 'w' ? WHITE : BLACK;
+    cursor++;
+    if (!isFenPositionPlayable(&state)) { return 0; }
+
+    cursor = skipFenSeparators(cursor, end);
+    if ((cursor = parseFenCastling(cursor, end, &state.castlingPerm)) == NULL) { return 0; }
+    cursor = skipFenSeparators(cursor, end);
+    if ((cursor = parseFenEnPassant(cursor, end, &state.enPassantTargetSquare)) == NULL) { return 0; }
+    if (!areFenCastlingRightsPlayable(&state) || !isFenEnPassantPlayable(&state)) { return 0; }
+
+    // EPD lines usually stop here, before their operations
+    int turnsForFiftyRule = 0, nbMoves = 1;
+    const char* counter = parseFenCounter(skipFenSeparators(cursor, end), end, &turnsForFiftyRule);
+    if (counter != NULL) {
+        cursor = counter;
+        counter = parseFenCounter(skipFenSeparators(cursor, end), end, &nbMoves);
+        if (counter != NULL) { cursor = counter; }
+    }
+    // The counters are stored in one and two bytes, the bigger values make no difference
+    state.turnsForFiftyRule = (uint8_t) (turnsForFiftyRule > UINT8_MAX ? UINT8_MAX : turnsForFiftyRule);
+    state.nbMoves = (uint16_t) (nbMoves > UINT16_MAX ? UINT16_MAX : nbMoves);
+
+    state.pieceSquareScore = pieceSquareScoreFromBoard(state.board);
+    state.pawnKey = pawnKeyFromBoard(state.board);
+    state.zobristKey = zobristKeyFromPosition(state.board, state.colorToGo, state.castlingPerm, state.enPassantTargetSquare);
+    *result = state;
+    return (size_t) (cursor - fen);
+}
 
 /**
  * Populates a GameState struct from a fen string.
  * Returns false if the fen string is invalid
 */
-bool setGameStateFromFenString(char *fen, GameState* result) {
-    if (result == NULL) { return false; }
-    if (strlen(fen) > 100) {
-      printf("The fen string length is bigger than 100, which is too long for the program\n");
-      return false;
+bool setGameStateFromFenString(const char* fen, GameState* result) {
+    if (fen == NULL) { return false; }
+    return parseFenString(fen, strlen(fen), result) != 0;
+}
+
+// Indexed like the bitboards of Board, with (color >> 4) then (piece type - 1)
+static const char fenPieceCharacters[2][6] = { { 'K', 'N', 'B', 'Q', 'R', 'P' }, { 'k', 'n', 'b', 'q', 'r', 'p' } };
+
+static char* writeFenCounter(char* cursor, int value) {
+    char digits[12];
+    int nbDigits = 0;
+    unsigned int remaining = value > 0 ? (unsigned int) value : 0;
+    do {
+        digits[nbDigits++] = (char) ('0' + remaining % 10);
+        remaining /= 10;
+    } while (remaining);
+    while (nbDigits) { *cursor++ = digits[--nbDigits]; }
+    return cursor;
+}
+
+size_t gameStateToFen(const GameState* state, char* buffer, size_t length) {
+    // One scan per bitboard puts the pieces on a mailbox, then the ranks are written from it
+    char squares[BOARD_SIZE] = { 0 };
+    for (int color = 0; color < 2; color++) {
+        for (int type = 0; type < 6; type++) {
+            u64 bitboard = state->board.pieces[type] & state->board.colors[color];
+            while (bitboard) {
+                squares[trailingZeros_64(bitboard)] = fenPieceCharacters[color][type];
+                bitboard &= bitboard - 1;
+            }
+        }
     }
-    char copy[100]; // Could have potential buffer overflow
-    strcpy(copy, fen);
-    char* split = strtok(copy, " ");
-
-    Piece boardArray[BOARD_SIZE] = { 0 };
-    setBoardArrayFromFenString(split, boardArray);
-
-    Board board = { 0 };
-    fromArray(&board, boardArray);
-    result->board = board;
-    splitString;
-    
-    result->colorToGo = (strcmp(split, "w") == 0) ? WHITE : BLACK;
-    splitString;
-    result->castlingPerm = getCastlingPermFromFenString(split);
-    splitString;
-    result->enPassantTargetSquare = convertSquareToIndex(split);
-    splitString;
-    result->turnsForFiftyRule = (int) strtol(split, NULL, 10);
-    splitString;
-    result->nbMoves = (int) strtol(split, NULL, 10);
-    return true;
-}
\ No newline at end of file
+
+    char fen[MAX_FEN_LENGTH];
+    char* cursor = fen;
+    for (int rank = 0; rank < BOARD_LENGTH; rank++) {
+        int emptySquares = 0;
+        for (int file = 0; file < BOARD_LENGTH; file++) {
+            char piece = squares[rank * BOARD_LENGTH + file];
+            if (piece == 0) {
+                emptySquares++;
+                continue;
+            }
+            if (emptySquares) { *cursor++ = (char) ('0' + emptySquares); }
+            emptySquares = 0;
+            *cursor++ = piece;
+        }
+        if (emptySquares) { *cursor++ = (char) ('0' + emptySquares); }
+        *cursor++ = rank < BOARD_LENGTH - 1 ? '/' : ' ';
+    }
+
+    *cursor++ = state->colorToGo == WHITE ? 'w' : 'b';
+    *cursor++ = ' ';
+    if (state->castlingPerm == 0) { *cursor++ = '-'; }
+    if (state->castlingPerm & (1 << 3)) { *cursor++ = 'K'; }
+    if (state->castlingPerm & (1 << 2)) { *cursor++ = 'Q'; }
+    if (state->castlingPerm & (1 << 1)) { *cursor++ = 'k'; }
+    if (state->castlingPerm & (1 << 0)) { *cursor++ = 'q'; }
+    *cursor++ = ' ';
+    if (state->enPassantTargetSquare >= 0 && state->enPassantTargetSquare < BOARD_SIZE) {
+        *cursor++ = (char) ('a' + state->enPassantTargetSquare % BOARD_LENGTH);
+        *cursor++ = (char) ('8' - state->enPassantTargetSquare / BOARD_LENGTH);
+    } else {
+        *cursor++ = '-';
+    }
+    *cursor++ = ' ';
+    cursor = writeFenCounter(cursor, state->turnsForFiftyRule);
+    *cursor++ = ' ';
+    cursor = writeFenCounter(cursor, state->nbMoves);
+
+    size_t fenLength = (size_t) (cursor - fen);
+    if (buffer == NULL || fenLength + 1 > length) { return 0; }
+    memcpy(buffer, fen, fenLength);
+    buffer[fenLength] = '\0';
+    return fenLength;
+}
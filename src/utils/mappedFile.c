@@ -0,0 +1,74 @@
+#include <string.h>
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+bool mapFile(const char* path, MappedFile* result) {
+    memset(result, 0, sizeof(MappedFile));
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    result->data = data;
+    result->size = (size_t) size.QuadPart;
+    result->fileHandle = file;
+    result->mappingHandle = mapping;
+    return true;
+}
+
+void unmapFile(MappedFile* file) {
+    if (file->data == NULL) { return; }
+    UnmapViewOfFile(file->data);
+    CloseHandle(file->mappingHandle);
+    CloseHandle(file->fileHandle);
+    memset(file, 0, sizeof(MappedFile));
+}
+
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool mapFile(const char* path, MappedFile* result) {
+    memset(result, 0, sizeof(MappedFile));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if (data == MAP_FAILED) { return false; }
+
+    result->data = data;
+    result->size = (size_t) fileStat.st_size;
+    return true;
+}
+
+void unmapFile(MappedFile* file) {
+    if (file->data == NULL) { return; }
+    munmap((void*) file->data, file->size);
+    memset(file, 0, sizeof(MappedFile));
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include <stdbool.h>
+#include <string.h>
+#include "MoveNotation.h"
+#include "../MoveGenerator.h"
+#include "../ChessGameEmulator.h"
+#include "../magicBitBoard/MagicBitBoard.h"
+
+// NOPIECE for the characters that are not the letter of a piece
+static PieceCharacteristics sanPieceType(char c) {
+    switch (c) {
+        case 'K': return KING;
+        case 'Q': return QUEEN;
+        case 'R': return ROOK;
+        case 'B': return BISHOP;
+        case 'N': return KNIGHT;
+        default: return NOPIECE;
+    }
+}
+
+static Flag promotionFlag(PieceCharacteristics type) {
+    switch (type) {
+        case QUEEN: return PROMOTE_TO_QUEEN;
+        case ROOK: return PROMOTE_TO_ROOK;
+        case BISHOP: return PROMOTE_TO_BISHOP;
+        case KNIGHT: return PROMOTE_TO_KNIGHT;
+        default: return NOFlAG;
+    }
+}
+
+static bool isPromotionFlag(Flag flag) {
+    return flag >= PROMOTE_TO_QUEEN && flag <= PROMOTE_TO_BISHOP;
+}
+
+static bool isSanSuffix(char c) {
+    return c == '+' || c == '#' || c == '!' || c == '?';
+}
+
+static PieceCharacteristics pieceTypeAt(const Board* board, int square, PieceCharacteristics color) {
+    Piece piece = pieceAtIndex(*board, square);
+    return pieceColor(piece) == color ? pieceType(piece) : NOPIECE;
+}
+
+static Move castlingMove(const Move moves[MAX_LEGAL_MOVES + 1], Flag flag) {
+    for (int i = 0; moves[i]; i++) {
+        if (flagFromMove(moves[i]) == flag) { return moves[i]; }
+    }
+    return 0;
+}
+
+Move moveFromSan(const GameState* state, const char* san, size_t length) {
+    if (state == NULL || san == NULL) { return 0; }
+    while (length > 0 && isSanSuffix(san[length - 1])) { length--; }
+    if (length < 2) { return 0; }
+
+    // A game can go on after the fifty move rule, which would only leave the draw move
+    GameState position = *state;
+    if (position.turnsForFiftyRule >= 100) { position.turnsForFiftyRule = 0; }
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, position, NULL);
+
+    if (san[0] == 'O' || san[0] == '0') {
+        char zero = san[0];
+        if (length == 3 && san[1] == '-' && san[2] == zero) { return castlingMove(moves, KING_SIDE_CASTLING); }
+        if (length == 5 && san[1] == '-' && san[2] == zero && san[3] == '-' && san[4] == zero) { return castlingMove(moves, QUEEN_SIDE_CASTLING); }
+        return 0;
+    }
+
+    // Read from the end: the promotion, the target square, then the piece and the disambiguation from the start
+    Flag promotion = NOFlAG;
+    if (sanPieceType(san[length - 1]) != NOPIECE) {
+        promotion = promotionFlag(sanPieceType(san[length - 1]));
+        length -= san[length - 2] == '=' ? 2 : 1;
+        if (promotion == NOFlAG || length < 2) { return 0; }
+    }
+    char toFile = san[length - 2], toRank = san[length - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') { return 0; }
+    int to = ('8' - toRank) * BOARD_LENGTH + (toFile - 'a');
+    length -= 2;
+
+    size_t index = 0;
+    PieceCharacteristics type = PAWN;
+    if (index < length && sanPieceType(san[index]) != NOPIECE) { type = sanPieceType(san[index++]); }
+    int fromFile = -1, fromRank = -1;
+    if (index < length && san[index] >= 'a' && san[index] <= 'h') { fromFile = san[index++] - 'a'; }
+    if (index < length && san[index] >= '1' && san[index] <= '8') { fromRank = '8' - san[index++]; }
+    if (index < length && (san[index] == 'x' || san[index] == '-' || san[index] == ':')) { index++; }
+    if (index != length || (promotion != NOFlAG && type != PAWN)) { return 0; }
+
+    Move result = 0;
+    for (int i = 0; moves[i]; i++) {
+        Move move = moves[i];
+        Flag flag = flagFromMove(move);
+        if (toSquareFromMove(move) != to || flag >= STALEMATE || flag == KING_SIDE_CASTLING || flag == QUEEN_SIDE_CASTLING) { continue; }
+        int from = fromSquareFromMove(move);
+        if ((fromFile >= 0 && from % BOARD_LENGTH != fromFile) || (fromRank >= 0 && from / BOARD_LENGTH != fromRank)) { continue; }
+        if (pieceTypeAt(&position.board, from, position.colorToGo) != type) { continue; }
+        if (isPromotionFlag(flag) ? flag != promotion : promotion != NOFlAG) { continue; }
+        if (result != 0) { return 0; } // Ambiguous
+        result = move;
+    }
+    return result;
+}
+
+static const char sanPieceLetters[] = { [KING] = 'K', [KNIGHT] = 'N', [BISHOP] = 'B', [QUEEN] = 'Q', [ROOK] = 'R' };
+
+/**
+ * The pieces of that type and color that attack `square`, so that could also move there if they are not pinned
+*/
+static u64 attackersOfType(const Board* board, PieceCharacteristics type, PieceCharacteristics color, int square, u64 occupancy) {
+    u64 pieces = bitBoardForPiece(*board, makePiece(color, type));
+    switch (type) {
+        case KNIGHT: return knightMovementMask[square] & pieces;
+        case BISHOP: return getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square]) & pieces;
+        case ROOK: return getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square]) & pieces;
+        case QUEEN: return (getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square])
+            | getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square])) & pieces;
+        default: return 0;
+    }
+}
+
+/**
+ * Returns true if moving the piece (not the king) from `from` to `to` does not leave the king in check
+*/
+static bool keepsKingSafe(const Board* board, PieceCharacteristics color, int from, int to, u64 occupancy) {
+    u64 king = bitBoardForPiece(*board, makePiece(color, KING));
+    if (!king) { return true; }
+    u64 toBitBoard = (u64) 1 << to;
+    u64 occupancyAfterMove = (occupancy & ~((u64) 1 << from)) | toBitBoard;
+    PieceCharacteristics opponentColor = color == WHITE ? BLACK : WHITE;
+    // A captured piece does not attack anymore
+    return (attackersOfSquare(*board, trailingZeros_64(king), occupancyAfterMove, opponentColor) & ~toBitBoard) == 0;
+}
+
+static char* writeSquare(char* cursor, int square) {
+    *cursor++ = (char) ('a' + square % BOARD_LENGTH);
+    *cursor++ = (char) ('8' - square / BOARD_LENGTH);
+    return cursor;
+}
+
+int moveToSan(const GameState* state, Move move, char result[MAX_SAN_LENGTH]) {
+    const Board* board = &state->board;
+    int from = fromSquareFromMove(move);
+    int to = toSquareFromMove(move);
+    Flag flag = flagFromMove(move);
+    char* cursor = result;
+
+    if (flag == KING_SIDE_CASTLING || flag == QUEEN_SIDE_CASTLING) {
+        memcpy(cursor, flag == KING_SIDE_CASTLING ? "O-O" : "O-O-O", flag == KING_SIDE_CASTLING ? 3 : 5);
+        cursor += flag == KING_SIDE_CASTLING ? 3 : 5;
+    } else {
+        PieceCharacteristics color = state->colorToGo;
+        PieceCharacteristics type = pieceTypeAt(board, from, color);
+        u64 occupancy = allPiecesBitBoard(*board);
+        bool isCapture = (occupancy & ((u64) 1 << to)) || flag == EN_PASSANT;
+
+        if (type == PAWN) {
+            if (isCapture) { *cursor++ = (char) ('a' + from % BOARD_LENGTH); }
+        } else {
+            *cursor++ = sanPieceLetters[type];
+            // The other pieces of the same type that can legally go to the same square
+            u64 others = attackersOfType(board, type, color, to, occupancy) & ~((u64) 1 << from);
+            bool isAmbiguous = false, sameFile = false, sameRank = false;
+            while (others) {
+                int other = trailingZeros_64(others);
+                others &= others - 1;
+                if (!keepsKingSafe(board, color, other, to, occupancy)) { continue; }
+                isAmbiguous = true;
+                sameFile |= other % BOARD_LENGTH == from % BOARD_LENGTH;
+                sameRank |= other / BOARD_LENGTH == from / BOARD_LENGTH;
+            }
+            if (isAmbiguous && (!sameFile || sameRank)) { *cursor++ = (char) ('a' + from % BOARD_LENGTH); }
+            if (isAmbiguous && sameFile) { *cursor++ = (char) ('8' - from / BOARD_LENGTH); }
+        }
+        if (isCapture) { *cursor++ = 'x'; }
+        cursor = writeSquare(cursor, to);
+        if (isPromotionFlag(flag)) {
+            *cursor++ = '=';
+            *cursor++ = flag == PROMOTE_TO_QUEEN ? 'Q' : flag == PROMOTE_TO_ROOK ? 'R' : flag == PROMOTE_TO_BISHOP ? 'B' : 'N';
+        }
+    }
+
+    GameState nextState = *state;
+    makeMove(move, &nextState);
+    if (isInCheck(nextState)) {
+        // Even after the fifty move rule, a mate is a mate
+        if (nextState.turnsForFiftyRule >= 100) { nextState.turnsForFiftyRule = 0; }
+        Move replies[MAX_LEGAL_MOVES + 1] = { 0 };
+        getValidMoves(replies, nextState, NULL);
+        *cursor++ = flagFromMove(replies[0]) == CHECKMATE ? '#' : '+';
+    }
+    *cursor = '\0';
+    return (int) (cursor - result);
+}
+
+void moveToUci(Move move, char result[MAX_UCI_LENGTH]) {
+    char* cursor = writeSquare(result, fromSquareFromMove(move));
+    cursor = writeSquare(cursor, toSquareFromMove(move));
+    switch (flagFromMove(move)) {
+        case PROMOTE_TO_QUEEN: *cursor++ = 'q'; break;
+        case PROMOTE_TO_KNIGHT: *cursor++ = 'n'; break;
+        case PROMOTE_TO_ROOK: *cursor++ = 'r'; break;
+        case PROMOTE_TO_BISHOP: *cursor++ = 'b'; break;
+        default: break;
+    }
+    *cursor = '\0';
+}
+
+Move moveFromUci(const GameState* state, const char* uci) {
+    size_t length = strlen(uci);
+    if (length != 4 && length != 5) { return 0; }
+    if (uci[0] < 'a' || uci[0] > 'h' || uci[1] < '1' || uci[1] > '8' || uci[2] < 'a' || uci[2] > 'h' || uci[3] < '1' || uci[3] > '8') { return 0; }
+    int from = ('8' - uci[1]) * BOARD_LENGTH + (uci[0] - 'a');
+    int to = ('8' - uci[3]) * BOARD_LENGTH + (uci[2] - 'a');
+    Flag promotion = NOFlAG;
+    if (length == 5) {
+        promotion = uci[4] == 'q' ? PROMOTE_TO_QUEEN : uci[4] == 'n' ? PROMOTE_TO_KNIGHT : uci[4] == 'r' ? PROMOTE_TO_ROOK : uci[4] == 'b' ? PROMOTE_TO_BISHOP : NOFlAG;
+        if (promotion == NOFlAG) { return 0; }
+    }
+
+    GameState position = *state;
+    if (position.turnsForFiftyRule >= 100) { position.turnsForFiftyRule = 0; }
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, position, NULL);
+    for (int i = 0; moves[i]; i++) {
+        Flag flag = flagFromMove(moves[i]);
+        if (flag >= STALEMATE || fromSquareFromMove(moves[i]) != from || toSquareFromMove(moves[i]) != to) { continue; }
+        if (isPromotionFlag(flag) ? flag == promotion : promotion == NOFlAG) { return moves[i]; }
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "PackedPositionFile.h"
+
+#define WRITER_BUFFER_SIZE 4096
+
+/**
+ * The file is in little endian, so the numbers only need to be swapped on big endian machines.
+ * Swapping twice gives back the original, so the same function reads and writes
+*/
+static void swapPackedPositionByteOrder(PackedPosition* positions, size_t nbPositions) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < nbPositions; i++) {
+        positions[i].occupancy = __builtin_bswap64(positions[i].occupancy);
+        positions[i].nbMoves = __builtin_bswap16(positions[i].nbMoves);
+    }
+#else
+    (void) positions;
+    (void) nbPositions;
+#endif
+}
+
+static bool flushPackedPositions(PackedPositionWriter* writer) {
+    if (writer->nbBuffered == 0 || writer->hasFailed) { return !writer->hasFailed; }
+    swapPackedPositionByteOrder(writer->buffer, writer->nbBuffered);
+    if (fwrite(writer->buffer, sizeof(PackedPosition), writer->nbBuffered, writer->file) != writer->nbBuffered) {
+        writer->hasFailed = true;
+    }
+    writer->nbBuffered = 0;
+    return !writer->hasFailed;
+}
+
+bool openPackedPositionWriter(const char* path, PackedPositionWriter* writer) {
+    memset(writer, 0, sizeof(PackedPositionWriter));
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) { return false; }
+    if (fwrite(PACKED_POSITION_FILE_MAGIC, 1, PACKED_POSITION_FILE_MAGIC_LENGTH, writer->file) != PACKED_POSITION_FILE_MAGIC_LENGTH) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return false;
+    }
+    writer->buffer = malloc(sizeof(PackedPosition) * WRITER_BUFFER_SIZE);
+    assert(writer->buffer != NULL && "Malloc failed so buy more RAM lol");
+    return true;
+}
+
+bool writePackedPosition(PackedPositionWriter* writer, const PackedPosition* position) {
+    if (writer->hasFailed) { return false; }
+    writer->buffer[writer->nbBuffered++] = *position;
+    writer->nbPositions++;
+    return writer->nbBuffered < WRITER_BUFFER_SIZE || flushPackedPositions(writer);
+}
+
+bool closePackedPositionWriter(PackedPositionWriter* writer) {
+    if (writer->file == NULL) { return false; }
+    bool isWritten = flushPackedPositions(writer);
+    isWritten &= fclose(writer->file) == 0;
+    free(writer->buffer);
+    memset(writer, 0, sizeof(PackedPositionWriter));
+    return isWritten;
+}
+
+bool openPackedPositionReader(const char* path, PackedPositionReader* reader) {
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) { return false; }
+    char magic[PACKED_POSITION_FILE_MAGIC_LENGTH];
+    if (fread(magic, 1, PACKED_POSITION_FILE_MAGIC_LENGTH, reader->file) != PACKED_POSITION_FILE_MAGIC_LENGTH
+        || memcmp(magic, PACKED_POSITION_FILE_MAGIC, PACKED_POSITION_FILE_MAGIC_LENGTH) != 0) {
+        closePackedPositionReader(reader);
+        return false;
+    }
+    return true;
+}
+
+size_t readPackedPositions(PackedPositionReader* reader, PackedPosition* positions, size_t maxPositions) {
+    if (reader->file == NULL) { return 0; }
+    size_t nbRead = fread(positions, sizeof(PackedPosition), maxPositions, reader->file);
+    swapPackedPositionByteOrder(positions, nbRead);
+    return nbRead;
+}
+
+void closePackedPositionReader(PackedPositionReader* reader) {
+    if (reader->file != NULL) { fclose(reader->file); }
+    reader->file = NULL;
+}
@@ -0,0 +1,306 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "PgnReader.h"
+#include "FenString.h"
+#include "MappedFile.h"
+#include "MoveNotation.h"
+#include "../ChessGameEmulator.h"
+
+#define STARTING_POSITION "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// The threads take the file one chunk at a time, a game belongs to the chunk where it starts
+#define PGN_CHUNK_SIZE (1 << 20)
+#define MAX_SAN_TOKEN_LENGTH 16 // With the annotations
+
+typedef struct PgnImport {
+    const char* fileStart; // The game offsets start from here, the data can skip a byte order mark
+    const char* data;
+    const char* end;
+    size_t nbChunks;
+    atomic_size_t nextChunk;
+    PgnPositionCallback onPosition;
+    void* userData;
+} PgnImport;
+
+/**
+ * The positions of the game being replayed are kept until its end, so that invalid games are not given to the callback
+*/
+typedef struct PgnWorker {
+    PgnImport* import;
+    GameState startingPosition;
+    GameState* states; // nbMoves + 1 positions
+    Move* moves;
+    size_t nbMoves;
+    size_t capacity;
+    PgnImportStats stats;
+} PgnWorker;
+
+static bool isPgnSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/**
+ * A tag line like [Event "..."], the comments can also start lines with [%clk ...] so the tag name has to follow
+*/
+static bool isTagLine(const char* line, const char* end) {
+    return end - line >= 2 && line[0] == '[' && isLetter(line[1]);
+}
+
+static const char* nextLine(const char* cursor, const char* end) {
+    const char* newLine = memchr(cursor, '\n', end - cursor);
+    return newLine != NULL ? newLine + 1 : end;
+}
+
+/**
+ * Returns the start of the first game that starts at or after `cursor`, which is the first line of its tags
+*/
+static const char* findGameStart(const char* data, const char* cursor, const char* end) {
+    if (cursor <= data) { return data; }
+    const char* line = cursor[-1] == '\n' ? cursor : nextLine(cursor, end);
+    bool previousIsTag = false;
+    if (line > data) {
+        const char* previousLine = line - 1;
+        while (previousLine > data && previousLine[-1] != '\n') { previousLine--; }
+        previousIsTag = isTagLine(previousLine, end);
+    }
+    for (; line < end; line = nextLine(line, end)) {
+        bool isTag = isTagLine(line, end);
+        if (isTag && !previousIsTag) { return line; }
+        previousIsTag = isTag;
+    }
+    return end;
+}
+
+static const char* skipPgnSpaces(const char* cursor, const char* end) {
+    while (cursor < end && isPgnSpace(*cursor)) { cursor++; }
+    return cursor;
+}
+
+static const char* skipUntil(const char* cursor, const char* end, char c) {
+    const char* found = memchr(cursor, c, end - cursor);
+    return found != NULL ? found + 1 : end;
+}
+
+/**
+ * Skips a variation, with the variations and the comments inside it
+*/
+static const char* skipVariation(const char* cursor, const char* end) {
+    int depth = 0;
+    while (cursor < end) {
+        char c = *cursor++;
+        if (c == '{') {
+            cursor = skipUntil(cursor, end, '}');
+        } else if (c == ';') {
+            cursor = skipUntil(cursor, end, '\n');
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')' && --depth == 0) {
+            break;
+        }
+    }
+    return cursor;
+}
+
+static bool isTokenEnd(char c) {
+    return isPgnSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';' || c == '[' || c == '$';
+}
+
+static bool tokenEquals(const char* token, size_t length, const char* text) {
+    return strlen(text) == length && memcmp(token, text, length) == 0;
+}
+
+/**
+ * Returns true and sets `result` if the token is a game termination marker
+*/
+static bool parseResult(const char* token, size_t length, PgnResult* result) {
+    if (tokenEquals(token, length, "1-0")) { *result = PGN_WHITE_WINS; return true; }
+    if (tokenEquals(token, length, "0-1")) { *result = PGN_BLACK_WINS; return true; }
+    if (tokenEquals(token, length, "1/2-1/2")) { *result = PGN_DRAW; return true; }
+    if (tokenEquals(token, length, "*")) { *result = PGN_UNKNOWN_RESULT; return true; }
+    return false;
+}
+
+/**
+ * Reads a tag pair at `cursor`, on the [. Only the FEN and the Result tags are used.
+ * Returns false if the FEN tag is not valid
+*/
+static bool parseTag(const char** cursor, const char* end, GameState* startingPosition, PgnResult* result) {
+    const char* name = *cursor + 1;
+    const char* nameEnd = name;
+    while (nameEnd < end && !isPgnSpace(*nameEnd) && *nameEnd != '"' && *nameEnd != ']') { nameEnd++; }
+    const char* value = skipPgnSpaces(nameEnd, end);
+    const char* valueEnd = value;
+    if (value < end && *value == '"') {
+        value++;
+        valueEnd = value;
+        while (valueEnd < end && *valueEnd != '"' && *valueEnd != '\n') { valueEnd += (*valueEnd == '\\' && valueEnd + 1 < end) ? 2 : 1; }
+        if (valueEnd > end) { valueEnd = end; }
+    }
+    // The rest of the line, a tag cannot span several lines
+    const char* tagEnd = valueEnd;
+    while (tagEnd < end && *tagEnd != ']' && *tagEnd != '\n') { tagEnd++; }
+    *cursor = tagEnd < end && *tagEnd == ']' ? tagEnd + 1 : tagEnd;
+
+    size_t nameLength = nameEnd - name;
+    if (tokenEquals(name, nameLength, "FEN")) {
+        return parseFenString(value, valueEnd - value, startingPosition) != 0;
+    }
+    if (tokenEquals(name, nameLength, "Result")) {
+        parseResult(value, valueEnd - value, result);
+    }
+    return true;
+}
+
+static void reserveGamePositions(PgnWorker* worker, size_t nbPositions) {
+    if (nbPositions <= worker->capacity) { return; }
+    worker->capacity = worker->capacity == 0 ? 256 : worker->capacity * 2;
+    worker->states = realloc(worker->states, sizeof(GameState) * worker->capacity);
+    worker->moves = realloc(worker->moves, sizeof(Move) * worker->capacity);
+    assert(worker->states != NULL && worker->moves != NULL && "Malloc failed so buy more RAM lol");
+}
+
+static void playPgnMove(PgnWorker* worker, Move move) {
+    reserveGamePositions(worker, worker->nbMoves + 2);
+    worker->moves[worker->nbMoves] = move;
+    worker->states[worker->nbMoves + 1] = worker->states[worker->nbMoves];
+    makeMove(move, &worker->states[worker->nbMoves + 1]);
+    worker->nbMoves++;
+}
+
+static void emitGame(PgnWorker* worker, PgnResult result, size_t gameOffset) {
+    PgnPosition position = { .result = result, .gameOffset = gameOffset };
+    for (size_t i = 0; i <= worker->nbMoves; i++) {
+        position.state = &worker->states[i];
+        position.move = i < worker->nbMoves ? worker->moves[i] : 0;
+        position.ply = (int) i;
+        if (worker->import->onPosition != NULL) { worker->import->onPosition(&position, worker->import->userData); }
+    }
+    worker->stats.nbGames++;
+    worker->stats.nbPositions += worker->nbMoves + 1;
+}
+
+/**
+ * Replays the game at `cursor`, until its termination marker or the tags of the next game.
+ * Returns where the game ends
+*/
+static const char* replayGame(PgnWorker* worker, const char* cursor, const char* end, size_t gameOffset) {
+    GameState startingPosition = worker->startingPosition;
+    PgnResult result = PGN_UNKNOWN_RESULT;
+    bool isValid = true;
+
+    for (cursor = skipPgnSpaces(cursor, end); cursor < end && *cursor == '['; cursor = skipPgnSpaces(cursor, end)) {
+        isValid &= parseTag(&cursor, end, &startingPosition, &result);
+    }
+    reserveGamePositions(worker, 1);
+    worker->states[0] = startingPosition;
+    worker->nbMoves = 0;
+
+    while ((cursor = skipPgnSpaces(cursor, end)) < end) {
+        char c = *cursor;
+        if (c == '[') { break; } // The next game, without a termination marker
+        if (c == '{') { cursor = skipUntil(cursor + 1, end, '}'); continue; }
+        if (c == ';' || c == '%') { cursor = skipUntil(cursor, end, '\n'); continue; }
+        if (c == '(') { cursor = skipVariation(cursor, end); continue; }
+        if (c == '$' || c == ')' || c == '}') {
+            cursor++;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9') { cursor++; }
+            continue;
+        }
+
+        const char* token = cursor;
+        while (cursor < end && !isTokenEnd(*cursor)) { cursor++; }
+        size_t length = cursor - token;
+        if (parseResult(token, length, &result)) { break; }
+
+        // Move numbers, which can be glued to the move like 1.e4 or 3...Nf6
+        const char* san = token;
+        while (san < cursor && *san >= '0' && *san <= '9') { san++; }
+        if (san < cursor && *san == '.') {
+            while (san < cursor && *san == '.') { san++; }
+        } else {
+            san = token;
+        }
+        if (san == cursor || tokenEquals(san, cursor - san, "e.p.") || !isValid) { continue; }
+
+        Move move = cursor - san <= MAX_SAN_TOKEN_LENGTH ? moveFromSan(&worker->states[worker->nbMoves], san, cursor - san) : 0;
+        if (move == 0) {
+            isValid = false;
+            continue;
+        }
+        playPgnMove(worker, move);
+    }
+
+    if (isValid) {
+        emitGame(worker, result, gameOffset);
+    } else {
+        worker->stats.nbInvalidGames++;
+    }
+    return cursor;
+}
+
+static void* importPgnChunks(void* data) {
+    PgnWorker* worker = data;
+    PgnImport* import = worker->import;
+    size_t chunk;
+    while ((chunk = atomic_fetch_add(&import->nextChunk, 1)) < import->nbChunks) {
+        const char* start = findGameStart(import->data, import->data + chunk * PGN_CHUNK_SIZE, import->end);
+        const char* chunkEnd = chunk + 1 == import->nbChunks ? import->end : findGameStart(import->data, import->data + (chunk + 1) * PGN_CHUNK_SIZE, import->end);
+        // A game longer than a chunk is read by the thread of the chunk where it starts
+        for (const char* cursor = skipPgnSpaces(start, chunkEnd); cursor < chunkEnd; cursor = skipPgnSpaces(cursor, chunkEnd)) {
+            cursor = replayGame(worker, cursor, chunkEnd, cursor - import->fileStart);
+        }
+    }
+    return NULL;
+}
+
+bool importPgnFile(const char* path, int nbThreads, PgnPositionCallback onPosition, void* userData, PgnImportStats* stats) {
+    memset(stats, 0, sizeof(PgnImportStats));
+    MappedFile file;
+    if (!mapFile(path, &file)) { return false; }
+
+    PgnImport import = { .fileStart = (const char*) file.data, .data = (const char*) file.data, .end = (const char*) file.data + file.size, .onPosition = onPosition, .userData = userData };
+    if (file.size >= 3 && memcmp(import.data, "\xEF\xBB\xBF", 3) == 0) { import.data += 3; } // UTF-8 byte order mark
+    import.nbChunks = ((size_t) (import.end - import.data) + PGN_CHUNK_SIZE - 1) / PGN_CHUNK_SIZE;
+    atomic_init(&import.nextChunk, 0);
+
+    int nbWorkers = nbThreads > 1 ? nbThreads : 1;
+    if ((size_t) nbWorkers > import.nbChunks) { nbWorkers = import.nbChunks > 0 ? (int) import.nbChunks : 1; }
+    PgnWorker workers[nbWorkers];
+    memset(workers, 0, sizeof(workers));
+    GameState startingPosition;
+    bool isValid = setGameStateFromFenString(STARTING_POSITION, &startingPosition);
+    assert(isValid && "Invalid starting position");
+    (void) isValid;
+
+    pthread_t threads[nbWorkers];
+    for (int i = 0; i < nbWorkers; i++) {
+        workers[i].import = &import;
+        workers[i].startingPosition = startingPosition;
+    }
+    for (int i = 1; i < nbWorkers; i++) {
+        int error = pthread_create(&threads[i], NULL, importPgnChunks, &workers[i]);
+        assert(error == 0 && "Could not start a pgn import thread");
+        (void) error;
+    }
+    importPgnChunks(&workers[0]);
+    for (int i = 1; i < nbWorkers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    unmapFile(&file);
+
+    for (int i = 0; i < nbWorkers; i++) {
+        stats->nbGames += workers[i].stats.nbGames;
+        stats->nbInvalidGames += workers[i].stats.nbInvalidGames;
+        stats->nbPositions += workers[i].stats.nbPositions;
+        free(workers[i].states);
+        free(workers[i].moves);
+    }
+    return true;
+}
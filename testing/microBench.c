@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "../src/magicBitBoard/MagicBitBoard.h"
+#include "../src/MoveGenerator.h"
+#include "../src/ChessGameEmulator.h"
+#include "../src/utils/FenString.h"
+#include "../src/utils/MoveNotation.h"
+#include "../src/state/PackedPosition.h"
+
+#define NB_WARMUP_SAMPLES 50
+#define NB_SAMPLES 1000
+#define TARGET_SAMPLE_TIME 50000 // In nanoseconds, a sample repeats its batch until it takes about this long
+#define MAX_CORPUS_MOVES 4096
+#define HISTORY_LENGTH 100 // About the previous states of a middle game, since the search needs the whole game for repetitions
+
+// Opening, middle game, end game and the perft positions with the tricky castling, promotions and en passant
+const char* corpusPositions[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+  "2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 w - - 0 25",
+  "8/8/4k3/8/2p5/8/B2K4/8 w - - 0 1",
+  "8/8/3p4/KPp4r/1R2PpPk/8/8/8 b - e3 0 1",
+};
+
+#define NB_CORPUS_POSITIONS ((int) (sizeof(corpusPositions) / sizeof(corpusPositions[0])))
+
+typedef struct BenchCorpus {
+  char fenStrings[NB_CORPUS_POSITIONS][128];
+  GameState states[NB_CORPUS_POSITIONS];
+  PackedPosition packedPositions[NB_CORPUS_POSITIONS];
+  // Every legal move of every position, with the position it is played from
+  int nbMoves;
+  Move moves[MAX_CORPUS_MOVES];
+  int moveStates[MAX_CORPUS_MOVES];
+  // The positions one or two plies after the corpus positions, so that half of them have the same side to move
+  GameState history[HISTORY_LENGTH + 1];
+} BenchCorpus;
+
+// Every benchmark adds its results here so that the compiler cannot throw the work away
+volatile u64 benchSink;
+
+/**
+ * Runs the primitive once over the corpus and returns how many operations that was
+*/
+typedef int (*BenchFunction)(const BenchCorpus* corpus);
+
+int benchGetValidMoves(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, corpus->states[i], NULL);
+    benchSink += moves[0];
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchMakeMove(const BenchCorpus* corpus) {
+  for (int i = 0; i < corpus->nbMoves; i++) {
+    GameState state = corpus->states[corpus->moveStates[i]];
+    makeMove(corpus->moves[i], &state);
+    benchSink += state.zobristKey;
+  }
+  return corpus->nbMoves;
+}
+
+int benchCopyMake(const BenchCorpus* corpus) {
+  // Like the search, every ply gets its own copy of the state on a stack
+  static GameState stack[MAX_CORPUS_MOVES + 1];
+  for (int i = 0; i < corpus->nbMoves; i++) {
+    stack[i + 1] = corpus->states[corpus->moveStates[i]];
+    makeMove(corpus->moves[i], &stack[i + 1]);
+    benchSink += stack[i + 1].zobristKey;
+  }
+  return corpus->nbMoves;
+}
+
+int benchCopyHistory(const BenchCorpus* corpus) {
+  static GameState history[HISTORY_LENGTH + 1];
+  memcpy(history, corpus->history, sizeof(history));
+  benchSink += history[HISTORY_LENGTH / 2].zobristKey;
+  return 1;
+}
+
+int benchGetValidMovesWithHistory(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, corpus->states[i], corpus->history);
+    benchSink += moves[0];
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchLegalTargetsFrom(const BenchCorpus* corpus) {
+  // A touched piece is the from square of one of the legal moves
+  for (int i = 0; i < corpus->nbMoves; i++) {
+    benchSink += legalTargetsFrom(corpus->states[corpus->moveStates[i]], fromSquareFromMove(corpus->moves[i]));
+  }
+  return corpus->nbMoves;
+}
+
+int benchLegalTargetsAll(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    u64 targets[BOARD_SIZE];
+    benchSink += legalTargetsAll(corpus->states[i], targets);
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchPieceAtIndex(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    for (int square = 0; square < BOARD_SIZE; square++) {
+      benchSink += pieceAtIndex(corpus->states[i].board, square);
+    }
+  }
+  return NB_CORPUS_POSITIONS * BOARD_SIZE;
+}
+
+int benchRookMagic(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    u64 occupancy = allPiecesBitBoard(corpus->states[i].board);
+    for (int square = 0; square < BOARD_SIZE; square++) {
+      benchSink += getRookPseudoLegalMovesBitBoard(square, occupancy & rookMovementMask[square]);
+    }
+  }
+  return NB_CORPUS_POSITIONS * BOARD_SIZE;
+}
+
+int benchBishopMagic(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    u64 occupancy = allPiecesBitBoard(corpus->states[i].board);
+    for (int square = 0; square < BOARD_SIZE; square++) {
+      benchSink += getBishopPseudoLegalMovesBitBoard(square, occupancy & bishopMovementMask[square]);
+    }
+  }
+  return NB_CORPUS_POSITIONS * BOARD_SIZE;
+}
+
+int benchFenParsing(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    GameState state;
+    setGameStateFromFenString(corpus->fenStrings[i], &state);
+    benchSink += state.zobristKey;
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchFenWriting(const BenchCorpus* corpus) {
+  char fen[MAX_FEN_LENGTH];
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    benchSink += gameStateToFen(&corpus->states[i], fen, sizeof(fen));
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchMoveToSan(const BenchCorpus* corpus) {
+  char san[MAX_SAN_LENGTH];
+  for (int i = 0; i < corpus->nbMoves; i++) {
+    benchSink += moveToSan(&corpus->states[corpus->moveStates[i]], corpus->moves[i], san);
+  }
+  return corpus->nbMoves;
+}
+
+int benchPackPosition(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    PackedPosition packed;
+    packPosition(&corpus->states[i], &packed);
+    benchSink += packed.occupancy;
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+int benchUnpackPosition(const BenchCorpus* corpus) {
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    GameState state;
+    unpackPosition(&corpus->packedPositions[i], &state);
+    benchSink += state.zobristKey;
+  }
+  return NB_CORPUS_POSITIONS;
+}
+
+typedef struct Benchmark {
+  const char* name;
+  BenchFunction run;
+} Benchmark;
+
+const Benchmark benchmarks[] = {
+  { "getValidMoves", benchGetValidMoves },
+  { "makeMove", benchMakeMove },
+  { "copyMake", benchCopyMake },
+  { "copyHistory", benchCopyHistory },
+  { "getValidMovesWithHistory", benchGetValidMovesWithHistory },
+  { "legalTargetsFrom", benchLegalTargetsFrom },
+  { "legalTargetsAll", benchLegalTargetsAll },
+  { "pieceAtIndex", benchPieceAtIndex },
+  { "rookMagic", benchRookMagic },
+  { "bishopMagic", benchBishopMagic },
+  { "setGameStateFromFenString", benchFenParsing },
+  { "gameStateToFen", benchFenWriting },
+  { "moveToSan", benchMoveToSan },
+  { "packPosition", benchPackPosition },
+  { "unpackPosition", benchUnpackPosition },
+};
+
+#define NB_BENCHMARKS ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+/**
+ * Cycles, instructions and cache misses of this thread, read together as one group.
+ * Containers and kernels with a strict perf_event_paranoid often refuse them, the bench then only reports times.
+ * perf_event_open only exists on Linux, the counters are never available elsewhere
+*/
+typedef struct PerfCounters {
+  int fds[3];
+  bool isAvailable;
+} PerfCounters;
+
+typedef struct PerfValues {
+  u64 cycles;
+  u64 instructions;
+  u64 cacheMisses;
+} PerfValues;
+
+#ifdef __linux__
+
+int openPerfCounter(u64 config, int groupFd) {
+  struct perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = config;
+  attributes.disabled = groupFd == -1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format = PERF_FORMAT_GROUP;
+  return (int) syscall(SYS_perf_event_open, &attributes, 0, -1, groupFd, 0);
+}
+
+PerfCounters openPerfCounters() {
+  PerfCounters counters = { .fds = { -1, -1, -1 }, .isAvailable = false };
+  const u64 configs[3] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES };
+  for (int i = 0; i < 3; i++) {
+    counters.fds[i] = openPerfCounter(configs[i], i == 0 ? -1 : counters.fds[0]);
+    if (counters.fds[i] == -1) {
+      for (int j = 0; j < i; j++) { close(counters.fds[j]); }
+      return counters;
+    }
+  }
+  counters.isAvailable = true;
+  return counters;
+}
+
+void closePerfCounters(PerfCounters* counters) {
+  if (!counters->isAvailable) { return; }
+  for (int i = 0; i < 3; i++) { close(counters->fds[i]); }
+}
+
+void startPerfCounters(PerfCounters* counters) {
+  if (!counters->isAvailable) { return; }
+  ioctl(counters->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(counters->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfValues stopPerfCounters(PerfCounters* counters) {
+  PerfValues values = { 0 };
+  if (!counters->isAvailable) { return values; }
+  ioctl(counters->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  u64 group[4]; // The number of counters, then their values in the order they were opened
+  if (read(counters->fds[0], group, sizeof(group)) == (ssize_t) sizeof(group)) {
+    values.cycles = group[1];
+    values.instructions = group[2];
+    values.cacheMisses = group[3];
+  }
+  return values;
+}
+
+#else
+
+PerfCounters openPerfCounters() {
+  PerfCounters counters = { .fds = { -1, -1, -1 }, .isAvailable = false };
+  return counters;
+}
+
+void closePerfCounters(PerfCounters* counters) { (void) counters; }
+
+void startPerfCounters(PerfCounters* counters) { (void) counters; }
+
+PerfValues stopPerfCounters(PerfCounters* counters) {
+  (void) counters;
+  PerfValues values = { 0 };
+  return values;
+}
+
+#endif
+
+u64 nanoseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (u64) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+int compareDoubles(const void* a, const void* b) {
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Every sample repeats the batch enough times to be well above the clock resolution, the median and p99 are
+ * taken over the ns/op of the samples
+*/
+void runBenchmark(const Benchmark* benchmark, const BenchCorpus* corpus, PerfCounters* counters) {
+  // Warm up the caches and the branch predictors, and find how many batches make a sample
+  int repetitions = 1;
+  for (int i = 0; i < NB_WARMUP_SAMPLES; i++) {
+    u64 start = nanoseconds();
+    for (int j = 0; j < repetitions; j++) { benchmark->run(corpus); }
+    u64 time = nanoseconds() - start;
+    if (time < TARGET_SAMPLE_TIME / 2 && repetitions < (1 << 20)) { repetitions *= 2; }
+  }
+
+  static double samples[NB_SAMPLES];
+  u64 totalOperations = 0;
+  startPerfCounters(counters);
+  for (int i = 0; i < NB_SAMPLES; i++) {
+    u64 operations = 0;
+    u64 start = nanoseconds();
+    for (int j = 0; j < repetitions; j++) { operations += benchmark->run(corpus); }
+    u64 time = nanoseconds() - start;
+    samples[i] = (double) time / operations;
+    totalOperations += operations;
+  }
+  PerfValues values = stopPerfCounters(counters);
+
+  qsort(samples, NB_SAMPLES, sizeof(double), compareDoubles);
+  printf("%-28s %10.1f %10.1f", benchmark->name, samples[NB_SAMPLES / 2], samples[NB_SAMPLES * 99 / 100]);
+  if (counters->isAvailable) {
+    printf(" %12.1f %12.1f %12.3f",
+      (double) values.cycles / totalOperations,
+      (double) values.instructions / totalOperations,
+      (double) values.cacheMisses / totalOperations);
+  }
+  printf("\n");
+}
+
+/**
+ * Only has something to print when the library is built with CHESS_ENGINE_PROFILE_MOVE_GENERATION
+*/
+void printMoveGenerationProfile() {
+  MoveGenerationProfile profile;
+  if (!getMoveGenerationProfile(&profile)) { return; }
+  printf("\n%-38s %12s %14s\n", "getValidMoves phase", "calls", "cycles/call");
+  for (int phase = 0; phase < NB_MOVE_GENERATION_PHASES; phase++) {
+    u64 calls = profile.calls[phase];
+    printf("%-38s %12" PRIu64 " %14.1f\n", moveGenerationPhaseName(phase), calls, calls > 0 ? (double) profile.cycles[phase] / calls : 0.0);
+  }
+}
+
+void buildCorpus(BenchCorpus* corpus) {
+  corpus->nbMoves = 0;
+  for (int i = 0; i < NB_CORPUS_POSITIONS; i++) {
+    strcpy(corpus->fenStrings[i], corpusPositions[i]);
+    bool isValid = setGameStateFromFenString(corpus->fenStrings[i], &corpus->states[i]);
+    assert(isValid && "Invalid bench position");
+    (void) isValid;
+    packPosition(&corpus->states[i], &corpus->packedPositions[i]);
+
+    Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+    getValidMoves(moves, corpus->states[i], NULL);
+    for (int j = 0; moves[j] && corpus->nbMoves < MAX_CORPUS_MOVES; j++) {
+      corpus->moves[corpus->nbMoves] = moves[j];
+      corpus->moveStates[corpus->nbMoves] = i;
+      corpus->nbMoves++;
+    }
+  }
+
+  for (int i = 0; i < HISTORY_LENGTH; i++) {
+    corpus->history[i] = corpus->states[corpus->moveStates[i]];
+    makeMove(corpus->moves[i], &corpus->history[i]);
+    if (i % 2) {
+      Move replies[MAX_LEGAL_MOVES + 1] = { 0 };
+      getValidMoves(replies, corpus->history[i], NULL);
+      if (fromSquareFromMove(replies[0]) != toSquareFromMove(replies[0])) { makeMove(replies[0], &corpus->history[i]); }
+    }
+  }
+  memset(&corpus->history[HISTORY_LENGTH], 0, sizeof(GameState)); // The end of the array has colorToGo == 0
+}
+
+void printUsage(char* programName) {
+  printf("Usage: %s [perf] [benchmark names...]\n", programName);
+  printf("Runs every benchmark, or only the given ones, and prints the median and p99 ns/op\n");
+  printf("`perf` adds the cycles, instructions and cache misses per op (needs perf_event_open)\n");
+  printf("Benchmarks:");
+  for (int i = 0; i < NB_BENCHMARKS; i++) { printf(" %s", benchmarks[i].name); }
+  printf("\n");
+}
+
+// Configure with -DCMAKE_BUILD_TYPE=Release, the default build is not optimized
+int main(int argc, char* argv[]) {
+  bool usePerf = false;
+  bool isSelected[NB_BENCHMARKS];
+  bool hasSelection = false;
+  memset(isSelected, 0, sizeof(isSelected));
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "perf") == 0) {
+      usePerf = true;
+      continue;
+    }
+    bool isKnown = false;
+    for (int j = 0; j < NB_BENCHMARKS; j++) {
+      if (strcmp(argv[i], benchmarks[j].name) == 0) {
+        isSelected[j] = true;
+        isKnown = true;
+      }
+    }
+    if (!isKnown) {
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    hasSelection = true;
+  }
+
+  magicBitBoardInitialize();
+  BenchCorpus* corpus = malloc(sizeof(BenchCorpus));
+  assert(corpus != NULL && "Malloc failed so buy more RAM lol");
+  buildCorpus(corpus);
+
+  PerfCounters counters = { .fds = { -1, -1, -1 }, .isAvailable = false };
+  if (usePerf) {
+    counters = openPerfCounters();
+    if (!counters.isAvailable) {
+      printf("The perf counters are not available (see /proc/sys/kernel/perf_event_paranoid), only reporting times\n");
+    }
+  }
+#ifndef __OPTIMIZE__
+  printf("Warning: the bench was compiled without optimizations\n");
+#endif
+
+  printf("%d positions, %d moves, %d samples per benchmark\n", NB_CORPUS_POSITIONS, corpus->nbMoves, NB_SAMPLES);
+  printf("GameState is %zu bytes (Board %zu), a history of %d states is %zu bytes\n",
+    sizeof(GameState), sizeof(Board), HISTORY_LENGTH, sizeof(GameState) * (HISTORY_LENGTH + 1));
+  printf("%-28s %10s %10s", "benchmark", "median ns", "p99 ns");
+  if (counters.isAvailable) { printf(" %12s %12s %12s", "cycles", "instructions", "cache misses"); }
+  printf("\n");
+  resetMoveGenerationProfile();
+  for (int i = 0; i < NB_BENCHMARKS; i++) {
+    if (hasSelection && !isSelected[i]) { continue; }
+    runBenchmark(&benchmarks[i], corpus, &counters);
+  }
+  printMoveGenerationProfile();
+
+  closePerfCounters(&counters);
+  free(corpus);
+  magicBitBoardTerminate();
+  return 0;
+}
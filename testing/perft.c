@@ -98,12 +98,12 @@ k7/8/8/K1Pp3r/8/8/8/8 w - d6 0 1 (Pawn is en-passant pinned)
 /**
  * Represents a position to perform a perft test on.
  * The nbTest parameter indicates for how many depths there is a results
- * perftResults returns the expected number of moves for a depth (the indices of said int)
+ * perftResults returns the expected number of moves for a depth (the indices of said array)
 */
 typedef struct testPosition {
   char* fenString;
   int nbTest;
-  int* perftResults;
+  u64* perftResults;
 } TestPosition;
 
 // These are the 8 ANSI color types
@@ -122,42 +122,42 @@ void test() {
   magicBitBoardInitialize();
   int maxDepth = 5;
   
-  int startingPosResults[6] = {1, 20, 400, 8902, 197281, 4865609};
+  u64 startingPosResults[6] = {1, 20, 400, 8902, 197281, 4865609};
   TestPosition startingPosition = {
     .fenString = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 
     .nbTest = 6, 
     .perftResults = startingPosResults
   };
   
-  int pos2Result[5] = {1, 48, 2039, 97862, 4085603};
+  u64 pos2Result[5] = {1, 48, 2039, 97862, 4085603};
   TestPosition pos2 = {
     .fenString = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
     .nbTest = 5,
     .perftResults = pos2Result
   };
   
-  int pos3Result[6] = {1, 14, 191, 2812, 43238, 674624};
+  u64 pos3Result[6] = {1, 14, 191, 2812, 43238, 674624};
   TestPosition pos3 = {
     .fenString = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
     .nbTest = 6,
     .perftResults = pos3Result
   };
 
-  int pos4Result[5] = {1, 6, 264, 9467, 422333};
+  u64 pos4Result[5] = {1, 6, 264, 9467, 422333};
   TestPosition pos4 = {
     .fenString = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
     .nbTest = 5,
     .perftResults = pos4Result
   };
 
-  int pos5Result[5] = {1, 44, 1486, 62379, 2103487};
+  u64 pos5Result[5] = {1, 44, 1486, 62379, 2103487};
   TestPosition pos5 = {
     .fenString = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
     .nbTest = 5,
     .perftResults = pos5Result
   };
 
-  int pos6Result[5] = {1, 46, 2079, 89890, 3894594};
+  u64 pos6Result[5] = {1, 46, 2079, 89890, 3894594};
   TestPosition pos6 = {
     .fenString = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
     .nbTest = 5,
@@ -199,10 +199,10 @@ void test() {
       timeSpent = (double)(end - begin) / CLOCKS_PER_SEC;
       
       printf(RESET "Depth: " GRN "%d " RESET "ply  " RESET "Result: " RED "%lu" RESET "  Time: " BLU "%f " RESET "ms ", depth, perftResult, timeSpent * 1000);
-      if (perftResult == (u64) testPosition.perftResults[depth]) {
+      if (perftResult == testPosition.perftResults[depth]) {
         printf("%s" RESET "\n", testPassed);
       } else {
-        printf("%s " RED "%d" RESET ")\n", testFailedPrefix, testPosition.perftResults[depth]);
+        printf("%s " RED "%lu" RESET ")\n", testFailedPrefix, testPosition.perftResults[depth]);
       }
 
     }
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include "../src/magicBitBoard/MagicBitBoard.h"
+#include "../src/MoveGenerator.h"
+#include "../src/utils/FenString.h"
+#include "../src/ChessGameEmulator.h"
+
+#define MAX_PERFT_DEPTH 16
+#define MAX_LINE_LENGTH 512
+
+/**
+ * A line of the EPD file, like `<fen> ;D1 20 ;D2 400 ;D3 8902`
+ * The results are filled by the thread that runs the position
+*/
+typedef struct PerftPosition {
+  char fenString[MAX_LINE_LENGTH];
+  GameState state;
+  int nbDepths; // The depths go from 1 to nbDepths, a depth without an expectation has expected[depth] == 0
+  u64 expected[MAX_PERFT_DEPTH + 1];
+  u64 nodes[MAX_PERFT_DEPTH + 1];
+  u64 totalNodes;
+  double time; // In seconds, for all the depths
+  bool passed;
+} PerftPosition;
+
+typedef struct PerftSuite {
+  PerftPosition* positions;
+  int nbPositions;
+  atomic_int nextPosition; // The threads take the positions one by one, in the order of the file
+} PerftSuite;
+
+double secondsSince(struct timespec start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * Unlike perft.c, everything is on the stack so that several threads can run it.
+ * The moves of the last ply are counted without being made
+*/
+u64 perft(const GameState* state, int depth) {
+  if (depth == 0) { return 1; }
+  Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+  // Perft counts the legal moves whatever the halfmove clock is, like the reference numbers of the EPD suites
+  GameState position = *state;
+  position.turnsForFiftyRule = 0;
+  getValidMoves(moves, position, NULL);
+  Flag flag = flagFromMove(moves[0]);
+  if (flag == STALEMATE || flag == CHECKMATE) { return 0; }
+
+  int nbMoves = 0;
+  while (moves[nbMoves]) { nbMoves++; }
+  if (depth == 1) { return nbMoves; }
+
+  u64 nodes = 0;
+  for (int i = 0; i < nbMoves; i++) {
+    GameState child = *state;
+    makeMove(moves[i], &child);
+    nodes += perft(&child, depth - 1);
+  }
+  return nodes;
+}
+
+/**
+ * Reads `<fen> ;D1 20 ;D2 400 ...`, the move counters of the fen string are optional like in most EPD files.
+ * Returns false if the line is not a valid position
+*/
+bool parsePerftLine(char* line, int maxDepth, PerftPosition* result) {
+  memset(result, 0, sizeof(PerftPosition));
+  size_t fenLength = parseFenString(line, strlen(line), &result->state);
+  if (fenLength == 0) { return false; }
+  memcpy(result->fenString, line, fenLength);
+  char* operations = strchr(line + fenLength, ';');
+
+  while (operations != NULL) {
+    operations++;
+    while (*operations == ' ') { operations++; }
+    if (*operations == 'D') {
+      char* end;
+      long depth = strtol(operations + 1, &end, 10);
+      u64 expected = strtoull(end, NULL, 10);
+      if (depth >= 1 && depth <= maxDepth) {
+        result->expected[depth] = expected;
+        if (depth > result->nbDepths) { result->nbDepths = depth; }
+      }
+    }
+    operations = strchr(operations, ';');
+  }
+  return result->nbDepths > 0;
+}
+
+/**
+ * Returns the positions of the file, NULL if it cannot be read
+*/
+PerftPosition* readPerftFile(const char* path, int maxDepth, int* nbPositions) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) { return NULL; }
+
+  int capacity = 64;
+  PerftPosition* positions = malloc(sizeof(PerftPosition) * capacity);
+  assert(positions != NULL && "Malloc failed so buy more RAM lol");
+  *nbPositions = 0;
+
+  char line[MAX_LINE_LENGTH];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') { continue; }
+
+    if (*nbPositions == capacity) {
+      capacity *= 2;
+      positions = realloc(positions, sizeof(PerftPosition) * capacity);
+      assert(positions != NULL && "Malloc failed so buy more RAM lol");
+    }
+    if (parsePerftLine(line, maxDepth, &positions[*nbPositions])) {
+      (*nbPositions)++;
+    } else {
+      fprintf(stderr, "Skipping line %d of %s: %s\n", lineNumber, path, line);
+    }
+  }
+  fclose(file);
+  return positions;
+}
+
+void* runPerftPositions(void* data) {
+  PerftSuite* suite = data;
+  int index;
+  while ((index = atomic_fetch_add(&suite->nextPosition, 1)) < suite->nbPositions) {
+    PerftPosition* position = &suite->positions[index];
+    position->passed = true;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int depth = 1; depth <= position->nbDepths; depth++) {
+      position->nodes[depth] = perft(&position->state, depth);
+      position->totalNodes += position->nodes[depth];
+      if (position->expected[depth] != 0 && position->nodes[depth] != position->expected[depth]) {
+        position->passed = false;
+      }
+    }
+    position->time = secondsSince(start);
+  }
+  return NULL;
+}
+
+double nodesPerSecond(u64 nodes, double time) {
+  return time > 0 ? nodes / time : 0;
+}
+
+void printText(const PerftSuite* suite, int nbThreads, u64 totalNodes, double time) {
+  for (int i = 0; i < suite->nbPositions; i++) {
+    const PerftPosition* position = &suite->positions[i];
+    printf("Position %d: %s\n", i + 1, position->fenString);
+    for (int depth = 1; depth <= position->nbDepths; depth++) {
+      if (position->expected[depth] == 0) { continue; }
+      bool passed = position->nodes[depth] == position->expected[depth];
+      printf("  Depth %2d: %15" PRIu64 " %s", depth, position->nodes[depth], passed ? "ok" : "FAILED");
+      if (!passed) { printf(" (expected %" PRIu64 ")", position->expected[depth]); }
+      printf("\n");
+    }
+    printf("  %" PRIu64 " nodes, %.3fs, %.0f nps\n", position->totalNodes, position->time, nodesPerSecond(position->totalNodes, position->time));
+  }
+
+  int nbFailed = 0;
+  for (int i = 0; i < suite->nbPositions; i++) {
+    nbFailed += !suite->positions[i].passed;
+  }
+  printf("%d/%d positions passed with %d threads: %" PRIu64 " nodes, %.3fs, %.0f nps\n",
+    suite->nbPositions - nbFailed, suite->nbPositions, nbThreads, totalNodes, time, nodesPerSecond(totalNodes, time));
+}
+
+void printJsonString(const char* string) {
+  putchar('"');
+  for (; *string; string++) {
+    if (*string == '"' || *string == '\\') { putchar('\\'); }
+    putchar(*string);
+  }
+  putchar('"');
+}
+
+void printJson(const PerftSuite* suite, int nbThreads, u64 totalNodes, double time) {
+  bool passed = true;
+  printf("{\"threads\": %d, \"positions\": [", nbThreads);
+  for (int i = 0; i < suite->nbPositions; i++) {
+    const PerftPosition* position = &suite->positions[i];
+    passed = passed && position->passed;
+    printf(i == 0 ? "\n  {\"fen\": " : ",\n  {\"fen\": ");
+    printJsonString(position->fenString);
+    printf(", \"depths\": [");
+    bool isFirst = true;
+    for (int depth = 1; depth <= position->nbDepths; depth++) {
+      if (position->expected[depth] == 0) { continue; }
+      printf("%s{\"depth\": %d, \"nodes\": %" PRIu64 ", \"expected\": %" PRIu64 ", \"passed\": %s}", isFirst ? "" : ", ", depth,
+        position->nodes[depth], position->expected[depth], position->nodes[depth] == position->expected[depth] ? "true" : "false");
+      isFirst = false;
+    }
+    printf("], \"nodes\": %" PRIu64 ", \"time\": %.6f, \"nps\": %.0f, \"passed\": %s}",
+      position->totalNodes, position->time, nodesPerSecond(position->totalNodes, position->time), position->passed ? "true" : "false");
+  }
+  printf("\n], \"nodes\": %" PRIu64 ", \"time\": %.6f, \"nps\": %.0f, \"passed\": %s}\n",
+    totalNodes, time, nodesPerSecond(totalNodes, time), passed ? "true" : "false");
+}
+
+void printUsage(char* programName) {
+  printf("Usage: %s <epd file> [max depth (positive integer)] [threads (positive integer)] [json]\n", programName);
+  printf("Runs perft on every position of the file, up to its last `;Dn <nodes>` entry or up to `max depth`\n");
+  printf("The positions are split between the threads (all the cores by default), `json` prints the results as JSON\n");
+}
+
+// To compile and run the program: ./perftSuite testing/perftsuite.epd
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  int maxDepth = MAX_PERFT_DEPTH;
+  int nbThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  bool json = false;
+  int nbNumbers = 0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "json") == 0) {
+      json = true;
+    } else if (atoi(argv[i]) > 0 && nbNumbers < 2) {
+      if (nbNumbers++ == 0) {
+        maxDepth = atoi(argv[i]) < MAX_PERFT_DEPTH ? atoi(argv[i]) : MAX_PERFT_DEPTH;
+      } else {
+        nbThreads = atoi(argv[i]);
+      }
+    } else {
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (nbThreads < 1) { nbThreads = 1; }
+
+  magicBitBoardInitialize();
+  PerftSuite suite = { .nextPosition = 0 };
+  suite.positions = readPerftFile(argv[1], maxDepth, &suite.nbPositions);
+  if (suite.positions == NULL) {
+    printf("Could not read %s\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  if (nbThreads > suite.nbPositions) { nbThreads = suite.nbPositions > 0 ? suite.nbPositions : 1; }
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t threads[nbThreads];
+  for (int i = 1; i < nbThreads; i++) {
+    int error = pthread_create(&threads[i], NULL, runPerftPositions, &suite);
+    assert(error == 0 && "Could not start a perft thread");
+    (void) error;
+  }
+  runPerftPositions(&suite);
+  for (int i = 1; i < nbThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double time = secondsSince(start);
+
+  u64 totalNodes = 0;
+  bool passed = true;
+  for (int i = 0; i < suite.nbPositions; i++) {
+    totalNodes += suite.positions[i].totalNodes;
+    passed = passed && suite.positions[i].passed;
+  }
+  if (json) {
+    printJson(&suite, nbThreads, totalNodes, time);
+  } else {
+    printText(&suite, nbThreads, totalNodes, time);
+  }
+
+  free(suite.positions);
+  magicBitBoardTerminate();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
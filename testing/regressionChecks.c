@@ -0,0 +1,748 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "../src/magicBitBoard/MagicBitBoard.h"
+#include "../src/MoveGenerator.h"
+#include "../src/ChessGameEmulator.h"
+#include "../src/utils/FenString.h"
+#include "../src/utils/FenLoader.h"
+#include "../src/utils/MoveNotation.h"
+#include "../src/state/PackedPosition.h"
+#include "../src/session/GameSession.h"
+#include "../src/utils/PgnReader.h"
+#include "../src/tablebase/Syzygy.h"
+#include "../src/tablebase/EndgameTable.h"
+#include "../src/tablebase/TablebaseGenerator.h"
+#include "../src/search/Search.h"
+#include "../src/search/TranspositionTable.h"
+#include "../src/book/PolyglotBook.h"
+#include "../src/nnue/Nnue.h"
+
+#define STARTING_POSITION "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define NB_RANDOM_GAMES 200
+#define MAX_RANDOM_GAME_PLIES 300
+
+// Every check adds its failures here, with the line that failed printed
+int nbFailures;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+      printf("  %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      nbFailures++; \
+    } \
+  } while (0)
+
+/**
+ * xorshift64, seeded the same way on every run so that the random games are always the same
+*/
+u64 randomState = 88172645463325252ULL;
+
+u64 nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 7;
+  randomState ^= randomState << 17;
+  return randomState;
+}
+
+/**
+ * Plays NB_RANDOM_GAMES random games from the starting position and calls `onPosition` on every position, the last
+ * one included. The fifty move counter is ignored so that the games go on until a checkmate, a stalemate or the ply limit
+*/
+void forEachRandomPosition(void (*onPosition)(const GameState* state, void* userData), void* userData) {
+  for (int game = 0; game < NB_RANDOM_GAMES; game++) {
+    GameState state;
+    setGameStateFromFenString(STARTING_POSITION, &state);
+    for (int ply = 0; ply < MAX_RANDOM_GAME_PLIES; ply++) {
+      onPosition(&state, userData);
+      GameState withoutFiftyRule = state;
+      withoutFiftyRule.turnsForFiftyRule = 0;
+      Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+      getValidMoves(moves, withoutFiftyRule, NULL);
+      if (fromSquareFromMove(moves[0]) == toSquareFromMove(moves[0])) { break; }
+      makeMove(moves[nextRandom() % nbMovesInArray(moves)], &state);
+    }
+  }
+}
+
+/**
+ * Everything but the dirty pieces, which only say what the last makeMove changed
+*/
+bool isSamePosition(const GameState* a, const GameState* b) {
+  return memcmp(&a->board, &b->board, sizeof(Board)) == 0 &&
+    a->zobristKey == b->zobristKey &&
+    a->pawnKey == b->pawnKey &&
+    memcmp(&a->pieceSquareScore, &b->pieceSquareScore, sizeof(PieceSquareScore)) == 0 &&
+    a->nbMoves == b->nbMoves &&
+    a->colorToGo == b->colorToGo &&
+    a->castlingPerm == b->castlingPerm &&
+    a->enPassantTargetSquare == b->enPassantTargetSquare &&
+    a->turnsForFiftyRule == b->turnsForFiftyRule;
+}
+
+void checkFenRoundTripOnPosition(const GameState* state, void* userData) {
+  (void) userData;
+  char fen[MAX_FEN_LENGTH];
+  size_t length = gameStateToFen(state, fen, sizeof(fen));
+  CHECK(length != 0 && length == strlen(fen));
+  GameState parsed;
+  CHECK(parseFenString(fen, length, &parsed) == length);
+  CHECK(isSamePosition(state, &parsed));
+
+  char written[MAX_FEN_LENGTH];
+  CHECK(gameStateToFen(&parsed, written, sizeof(written)) == length);
+  CHECK(strcmp(fen, written) == 0);
+}
+
+void checkFenStrings() {
+  const char* fens[] = {
+    STARTING_POSITION,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "8/8/3p4/KPp4r/1R2PpPk/8/8/8 b - e3 0 1",
+    "4k3/8/8/8/8/8/8/4K3 b - - 99 312",
+  };
+  for (size_t i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+    GameState state;
+    CHECK(setGameStateFromFenString(fens[i], &state));
+    char written[MAX_FEN_LENGTH];
+    CHECK(gameStateToFen(&state, written, sizeof(written)) == strlen(fens[i]));
+    CHECK(strcmp(written, fens[i]) == 0);
+  }
+
+  // The counters are optional and the EPD operations are not read
+  GameState state;
+  const char* epd = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - bm e4; id \"start\";";
+  CHECK(parseFenString(epd, strlen(epd), &state) == strlen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -"));
+  CHECK(state.turnsForFiftyRule == 0 && state.nbMoves == 1);
+
+  // Too short a buffer writes nothing
+  char buffer[8];
+  CHECK(gameStateToFen(&state, buffer, sizeof(buffer)) == 0);
+
+  // Castling rights without their king or rook, and en passant squares that no double push could have left
+  const char* invalidFens[] = {
+    "r3k2r/8/8/8/8/8/8/R3K1R1 w KQkq - 0 1",
+    "r3k2r/8/8/8/8/8/8/R4K1R w Qkq - 0 1",
+    "1r2k2r/8/8/8/8/8/8/R3K2R b q - 0 1",
+    "4k3/8/8/3pP3/8/8/8/4K3 w - d3 0 1",
+    "4k3/8/8/3pP3/8/8/8/4K3 b - d6 0 1",
+    "4k3/8/8/4P3/8/8/8/4K3 w - d6 0 1",
+    "4k3/3p4/8/3pP3/8/8/8/4K3 w - d6 0 1",
+  };
+  for (size_t i = 0; i < sizeof(invalidFens) / sizeof(invalidFens[0]); i++) {
+    CHECK(!setGameStateFromFenString(invalidFens[i], &state));
+  }
+  CHECK(setGameStateFromFenString("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", &state));
+
+  // An empty file is read, with no positions
+  char path[] = "/tmp/fenLoaderXXXXXX";
+  int descriptor = mkstemp(path);
+  CHECK(descriptor >= 0);
+  if (descriptor >= 0) {
+    close(descriptor);
+    LoadedPositions positions;
+    CHECK(loadPositionsFromFile(path, 2, &positions) && positions.nbStates == 0 && positions.nbInvalidLines == 0);
+    freeLoadedPositions(&positions);
+    remove(path);
+  }
+  LoadedPositions missing;
+  CHECK(!loadPositionsFromFile("/nonexistent/positions.epd", 1, &missing));
+
+  forEachRandomPosition(checkFenRoundTripOnPosition, NULL);
+}
+
+void checkNotationOnPosition(const GameState* state, void* userData) {
+  // Parsing back every move runs the move generator for each of them, so only one position out of 16 is checked
+  int* nbPositions = userData;
+  if ((*nbPositions)++ % 16 != 0) { return; }
+  GameState withoutFiftyRule = *state;
+  withoutFiftyRule.turnsForFiftyRule = 0;
+  Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+  getValidMoves(moves, withoutFiftyRule, NULL);
+  if (fromSquareFromMove(moves[0]) == toSquareFromMove(moves[0])) { return; }
+  for (int i = 0; moves[i]; i++) {
+    char san[MAX_SAN_LENGTH];
+    int length = moveToSan(state, moves[i], san);
+    CHECK(length > 0 && length == (int) strlen(san));
+    CHECK(moveFromSan(state, san, length) == moves[i]);
+    char uci[MAX_UCI_LENGTH];
+    moveToUci(moves[i], uci);
+    CHECK(moveFromUci(state, uci) == moves[i]);
+  }
+}
+
+/**
+ * Writes the move `uci` of the position in SAN and compares it to `expected`
+*/
+bool isSanOf(const char* fen, const char* uci, const char* expected) {
+  GameState state;
+  if (!setGameStateFromFenString(fen, &state)) { return false; }
+  Move move = moveFromUci(&state, uci);
+  char san[MAX_SAN_LENGTH];
+  return move != 0 && moveToSan(&state, move, san) > 0 && strcmp(san, expected) == 0 &&
+    moveFromSan(&state, expected, strlen(expected)) == move;
+}
+
+void checkNotation() {
+  CHECK(isSanOf(STARTING_POSITION, "g1f3", "Nf3"));
+  CHECK(isSanOf(STARTING_POSITION, "e2e4", "e4"));
+  CHECK(isSanOf("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "e1g1", "O-O"));
+  CHECK(isSanOf("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", "e8c8", "O-O-O"));
+  CHECK(isSanOf("4k3/8/8/8/8/8/8/N1N1K3 w - - 0 1", "a1b3", "Nab3"));
+  CHECK(isSanOf("4k3/8/8/N7/8/8/8/N3K3 w - - 0 1", "a1b3", "N1b3"));
+  CHECK(isSanOf("4k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a7a8q", "a8=Q+"));
+  CHECK(isSanOf("4k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a7a8n", "a8=N"));
+  CHECK(isSanOf("rnbqkbnr/pppp1ppp/8/4p3/6P1/5P2/PPPPP2P/RNBQKBNR b KQkq - 0 2", "d8h4", "Qh4#"));
+  CHECK(isSanOf("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", "exd6"));
+
+  GameState state;
+  setGameStateFromFenString(STARTING_POSITION, &state);
+  Move knight = moveFromUci(&state, "g1f3");
+  CHECK(moveFromSan(&state, "Nf3+", 4) == knight); // A wrong suffix is still read
+  CHECK(moveFromSan(&state, "Nf3!?", 5) == knight);
+  CHECK(moveFromSan(&state, "Nf4", 3) == 0);
+  CHECK(moveFromSan(&state, "O-O", 3) == 0);
+  CHECK(moveFromUci(&state, "e2e5") == 0);
+
+  int nbPositions = 0;
+  forEachRandomPosition(checkNotationOnPosition, &nbPositions);
+}
+
+void checkPackedPositionOnPosition(const GameState* state, void* userData) {
+  (void) userData;
+  PackedPosition packed;
+  CHECK(packPosition(state, &packed));
+  GameState unpacked;
+  CHECK(unpackPosition(&packed, &unpacked));
+  CHECK(isSamePosition(state, &unpacked));
+  // The same position always gives the same bytes
+  PackedPosition packedAgain;
+  CHECK(packPosition(&unpacked, &packedAgain));
+  CHECK(memcmp(&packed, &packedAgain, sizeof(PackedPosition)) == 0);
+}
+
+void checkPackedPositions() {
+  GameState state;
+  setGameStateFromFenString("8/8/3p4/KPp4r/1R2PpPk/8/8/8 b - e3 0 1", &state);
+  PackedPosition packed;
+  CHECK(packPosition(&state, &packed));
+  CHECK(packed.enPassantTargetSquare == 44); // e3
+  CHECK(packed.sideAndCastling == 1 << 4);
+
+  PackedPosition invalid = packed;
+  invalid.pieces[0] = (invalid.pieces[0] & 0xF0) | 7; // 7 is not a piece code
+  CHECK(!unpackPosition(&invalid, &state));
+
+  // The black king becomes a second white king
+  invalid = packed;
+  int nbPieces = __builtin_popcountll(packed.occupancy);
+  for (int i = 0; i < nbPieces; i++) {
+    int shift = (i & 1) * 4;
+    if (((invalid.pieces[i >> 1] >> shift) & 0xF) == makePiece(BLACK, KING) - 8) {
+      invalid.pieces[i >> 1] = (invalid.pieces[i >> 1] & ~(0xF << shift)) | ((makePiece(WHITE, KING) - 8) << shift);
+    }
+  }
+  CHECK(!unpackPosition(&invalid, &state));
+
+  PackedPosition empty = { 0 };
+  CHECK(!unpackPosition(&empty, &state));
+
+  // A position has a single encoding
+  invalid = packed;
+  invalid.pieces[nbPieces >> 1] |= 1 << ((nbPieces & 1) * 4);
+  CHECK(!unpackPosition(&invalid, &state));
+  invalid = packed;
+  invalid.reserved[0] = 1;
+  CHECK(!unpackPosition(&invalid, &state));
+
+  forEachRandomPosition(checkPackedPositionOnPosition, NULL);
+}
+
+bool playUciMoves(GameSession* session, const char* moves[], int nbMoves) {
+  for (int i = 0; i < nbMoves; i++) {
+    if (!sessionPlayUci(session, moves[i])) { return false; }
+  }
+  return true;
+}
+
+void checkSessionInvalidFens() {
+  const char* invalidFens[] = {
+    "8/8/8/8/8/8/8/8 w - - 0 1", // No king at all
+    "k7/8/8/8/8/8/8/8 w - - 0 1", // No white king
+    "kk6/8/8/8/8/8/8/7K w - - 0 1", // Two black kings
+    "k7/8/8/8/8/8/8/R6K w - - 0 1", // Black is in check but it is white to move
+    "k7/1P6/8/8/8/8/8/7K w - - 0 1", // Same with a pawn
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1", // 7 squares on the 1st rank
+    "",
+    "not a fen",
+  };
+  for (size_t i = 0; i < sizeof(invalidFens) / sizeof(invalidFens[0]); i++) {
+    GameSession* session = createGameSession(invalidFens[i]);
+    CHECK(session == NULL);
+    destroyGameSession(session);
+  }
+}
+
+void checkSessionPlayAndUndo() {
+  GameSession* session = createGameSession(STARTING_POSITION);
+  CHECK(session != NULL);
+  GameState start = *sessionState(session);
+  Move moves[MAX_LEGAL_MOVES + 1];
+  CHECK(sessionLegalMoves(session, moves) == 20);
+  CHECK(sessionStatus(session) == GAME_IN_PROGRESS);
+  CHECK(!sessionUndo(session));
+  CHECK(!sessionPlayUci(session, "e2e5"));
+
+  const char* opening[] = { "e2e4", "e7e5", "g1f3" };
+  CHECK(playUciMoves(session, opening, 3));
+  int nbMoves;
+  sessionMoves(session, &nbMoves);
+  CHECK(nbMoves == 3);
+  CHECK(sessionState(session)->colorToGo == BLACK);
+  CHECK(sessionPreviousStates(session)[3].colorToGo == 0);
+  for (int i = 0; i < 3; i++) { CHECK(sessionUndo(session)); }
+  CHECK(memcmp(sessionState(session), &start, sizeof(GameState)) == 0);
+  CHECK(sessionLegalMoves(session, moves) == 20);
+  destroyGameSession(session);
+}
+
+void checkSessionEndOfGame() {
+  // The starting position a third time after the knights went out and back twice
+  GameSession* session = createGameSession(STARTING_POSITION);
+  const char* knightMoves[] = { "g1f3", "g8f6", "f3g1", "f6g8", "g1f3", "g8f6", "f3g1" };
+  CHECK(playUciMoves(session, knightMoves, 7));
+  CHECK(sessionStatus(session) == GAME_IN_PROGRESS);
+  CHECK(sessionPlayUci(session, "f6g8"));
+  CHECK(sessionStatus(session) == GAME_DRAW_BY_REPETITION);
+  Move moves[MAX_LEGAL_MOVES + 1];
+  CHECK(sessionLegalMoves(session, moves) == 0);
+  CHECK(!sessionPlayUci(session, "g1f3"));
+  CHECK(sessionUndo(session));
+  CHECK(sessionStatus(session) == GAME_IN_PROGRESS);
+  destroyGameSession(session);
+
+  session = createGameSession(STARTING_POSITION);
+  const char* foolsMate[] = { "f2f3", "e7e5", "g2g4", "d8h4" };
+  CHECK(playUciMoves(session, foolsMate, 4));
+  CHECK(sessionStatus(session) == GAME_CHECKMATE);
+  destroyGameSession(session);
+
+  session = createGameSession("k7/8/1Q6/8/8/8/8/7K b - - 0 1");
+  CHECK(sessionStatus(session) == GAME_STALEMATE);
+  destroyGameSession(session);
+
+  session = createGameSession("k7/8/8/8/8/8/8/K6R w - - 99 80");
+  CHECK(sessionStatus(session) == GAME_IN_PROGRESS);
+  CHECK(sessionPlayUci(session, "h1h2"));
+  CHECK(sessionStatus(session) == GAME_DRAW_BY_FIFTY_MOVES);
+  destroyGameSession(session);
+}
+
+void checkSessionLegalMovesOnPosition(const GameState* state, void* userData) {
+  (void) userData;
+  char fen[MAX_FEN_LENGTH];
+  CHECK(gameStateToFen(state, fen, sizeof(fen)) != 0);
+  GameSession* session = createGameSession(fen);
+  CHECK(session != NULL);
+  if (session == NULL) { return; }
+
+  // A new session has no history, so only the fifty move rule can make it a draw
+  GameState withoutFiftyRule = *state;
+  withoutFiftyRule.turnsForFiftyRule = 0;
+  Move expected[MAX_LEGAL_MOVES + 1] = { 0 };
+  getValidMoves(expected, withoutFiftyRule, NULL);
+  Move moves[MAX_LEGAL_MOVES + 1];
+  int nbMoves = sessionLegalMoves(session, moves);
+  if (fromSquareFromMove(expected[0]) == toSquareFromMove(expected[0])) {
+    CHECK(nbMoves == 0);
+  } else if (state->turnsForFiftyRule < 100) {
+    CHECK(nbMoves == nbMovesInArray(expected));
+    CHECK(memcmp(moves, expected, sizeof(Move) * (nbMoves + 1)) == 0);
+  }
+  destroyGameSession(session);
+}
+
+void checkSession() {
+  checkSessionInvalidFens();
+  checkSessionPlayAndUndo();
+  checkSessionEndOfGame();
+  forEachRandomPosition(checkSessionLegalMovesOnPosition, NULL);
+}
+
+void checkLegalTargetsOnPosition(const GameState* state, void* userData) {
+  (void) userData;
+  GameState withoutFiftyRule = *state;
+  withoutFiftyRule.turnsForFiftyRule = 0;
+  Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+  getValidMoves(moves, withoutFiftyRule, NULL);
+  u64 expected[BOARD_SIZE] = { 0 };
+  int nbMoves = 0;
+  if (fromSquareFromMove(moves[0]) != toSquareFromMove(moves[0])) {
+    for (; moves[nbMoves]; nbMoves++) {
+      expected[(int) fromSquareFromMove(moves[nbMoves])] |= (u64) 1 << toSquareFromMove(moves[nbMoves]);
+    }
+  }
+
+  // The fifty move counter makes no difference to the targets
+  u64 targets[BOARD_SIZE];
+  CHECK(legalTargetsAll(*state, targets) == nbMoves);
+  CHECK(memcmp(targets, expected, sizeof(targets)) == 0);
+  for (int square = 0; square < BOARD_SIZE; square++) {
+    CHECK(legalTargetsFrom(*state, square) == expected[square]);
+  }
+}
+
+void checkLegalTargets() {
+  GameState state;
+  setGameStateFromFenString("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", &state);
+  // The castlings are the squares the king lands on
+  u64 kingTargets = legalTargetsFrom(state, 60); // e1
+  CHECK((kingTargets >> 62) & 1); // g1
+  CHECK((kingTargets >> 58) & 1); // c1
+  CHECK(legalTargetsFrom(state, 4) == 0); // The black king does not move, it is white to move
+  CHECK(legalTargetsFrom(state, 35) == 0); // An empty square
+  CHECK(legalTargetsFrom(state, -1) == 0);
+  CHECK(legalTargetsFrom(state, BOARD_SIZE) == 0);
+
+  // The pinned knight on e2 cannot move, and the pawn promotes on a single square
+  setGameStateFromFenString("4r1k1/P7/8/8/8/8/4N3/4K3 w - - 0 1", &state);
+  CHECK(legalTargetsFrom(state, 52) == 0);
+  CHECK(legalTargetsFrom(state, 8) == (u64) 1 << 0);
+
+  forEachRandomPosition(checkLegalTargetsOnPosition, NULL);
+}
+
+bool probeWdlOf(const char* fen, SyzygyWdl expected) {
+  GameState state;
+  SyzygyWdl wdl;
+  return setGameStateFromFenString(fen, &state) && syzygyProbeWdl(&state, &wdl) && wdl == expected;
+}
+
+/**
+ * Probes the DTZ and returns it in `result`, false if the position cannot be probed
+*/
+bool probeDtzOf(const char* fen, int* result) {
+  GameState state;
+  return setGameStateFromFenString(fen, &state) && syzygyProbeDtz(&state, result);
+}
+
+/**
+ * Needs the KQvK and KRvK tables (.rtbw and .rtbz) in the directories of the SYZYGY_PATH environment variable,
+ * it is skipped without them
+*/
+void checkSyzygy() {
+  const char* path = getenv("SYZYGY_PATH");
+  syzygyInitialize(path);
+  GameState state;
+  SyzygyWdl wdl;
+  setGameStateFromFenString("4k3/8/8/8/8/8/8/3QK3 w - - 0 1", &state);
+  bool hasQueenTable = syzygyProbeWdl(&state, &wdl);
+  setGameStateFromFenString("4k3/8/8/8/8/8/8/R3K3 w - - 0 1", &state);
+  bool hasRookTable = syzygyProbeWdl(&state, &wdl);
+  if (!hasQueenTable || !hasRookTable) {
+    printf("  no KQvK and KRvK tables in SYZYGY_PATH, skipped\n");
+    syzygyFree();
+    return;
+  }
+
+  CHECK(probeWdlOf("4k3/8/8/8/8/8/8/3QK3 w - - 0 1", SYZYGY_WIN));
+  CHECK(probeWdlOf("4k3/8/8/8/8/8/8/3QK3 b - - 0 1", SYZYGY_LOSS));
+  CHECK(probeWdlOf("k7/8/1Q6/8/8/8/8/7K b - - 0 1", SYZYGY_DRAW)); // Stalemate
+  CHECK(probeWdlOf("k7/1Q6/8/8/8/8/8/7K b - - 0 1", SYZYGY_DRAW)); // The king takes the queen
+  CHECK(probeWdlOf("4k3/8/8/8/8/8/8/R3K3 w - - 0 1", SYZYGY_WIN));
+  CHECK(probeWdlOf("8/8/8/8/8/8/5kR1/K7 b - - 0 1", SYZYGY_DRAW)); // The king takes the rook
+
+  // Mate in 1 is one ply to zeroing, the side that gets mated has a negative DTZ
+  int dtz;
+  CHECK(probeDtzOf("k7/8/1K6/8/8/8/7Q/8 w - - 0 1", &dtz) && dtz == 1);
+  CHECK(probeDtzOf("k7/8/1K6/8/8/8/8/7R w - - 0 1", &dtz) && dtz == 1);
+  CHECK(probeDtzOf("4k3/8/8/8/8/8/8/3QK3 b - - 0 1", &dtz) && dtz < 0);
+  CHECK(probeDtzOf("k7/8/1Q6/8/8/8/8/7K b - - 0 1", &dtz) && dtz == 0);
+
+  // The mate is one of the moves that keep the win
+  setGameStateFromFenString("k7/8/1K6/8/8/8/8/7R w - - 0 1", &state);
+  Move rootMoves[MAX_LEGAL_MOVES + 1];
+  int nbRootMoves = syzygyRootMoves(&state, rootMoves);
+  Move mate = moveFromUci(&state, "h1h8");
+  bool hasMate = false;
+  for (int i = 0; i < nbRootMoves; i++) { hasMate |= rootMoves[i] == mate; }
+  CHECK(nbRootMoves > 0 && hasMate);
+
+  // Castling rights are not in the tables
+  setGameStateFromFenString("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1", &state);
+  CHECK(!syzygyProbeWdl(&state, &wdl));
+  syzygyFree();
+}
+
+bool probeEndgameOf(const char* fen, EndgameWdl expected, int movesToMate) {
+  GameState state;
+  EndgameProbe probe;
+  return setGameStateFromFenString(fen, &state) && probeEndgameTables(&state, &probe) &&
+    probe.wdl == expected && probe.movesToMate == movesToMate;
+}
+
+/**
+ * Generates the KQvK and KRvK tables in a temporary directory, and probes them like the search does
+*/
+void checkEndgameTables() {
+  char directory[] = "/tmp/endgameTablesXXXXXX";
+  if (mkdtemp(directory) == NULL) {
+    printf("  could not create a temporary directory, skipped\n");
+    return;
+  }
+  CHECK(endgameTablesInitialize(directory) == 0);
+  CHECK(generateEndgameTable("KQvK", directory, 1));
+  CHECK(generateEndgameTable("KRvK", directory, 1));
+  CHECK(endgameTablesInitialize(directory) == 2);
+  CHECK(endgameTablesLargest() == 3);
+
+  CHECK(probeEndgameOf("k7/8/1K6/8/8/8/7Q/8 w - - 0 1", ENDGAME_WIN, 1));
+  CHECK(probeEndgameOf("k7/8/1K6/8/8/8/8/7R w - - 0 1", ENDGAME_WIN, 1));
+  CHECK(probeEndgameOf("k6Q/8/1K6/8/8/8/8/8 b - - 0 1", ENDGAME_LOSS, 0)); // Checkmated
+  CHECK(probeEndgameOf("K6q/8/1k6/8/8/8/8/8 w - - 0 1", ENDGAME_LOSS, 0)); // Same with the colors flipped
+  CHECK(probeEndgameOf("k7/8/1Q6/8/8/8/8/7K b - - 0 1", ENDGAME_DRAW, 0)); // Stalemate
+  CHECK(probeEndgameOf("k7/1Q6/8/8/8/8/8/7K b - - 0 1", ENDGAME_DRAW, 0)); // The king takes the queen
+
+  GameState state;
+  EndgameProbe probe;
+  setGameStateFromFenString("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1", &state);
+  CHECK(!probeEndgameTables(&state, &probe)); // Castling rights are not in the tables
+  setGameStateFromFenString("4k3/8/8/8/8/8/8/RB2K3 w - - 0 1", &state);
+  CHECK(!probeEndgameTables(&state, &probe)); // No KRBvK table
+
+  // Taking the rook leaves a KRvK position that the search gets from the table
+  setGameStateFromFenString("4k3/8/8/8/8/8/3r4/R3K3 w - - 0 1", &state);
+  TranspositionTable* table = createTranspositionTable(1);
+  SearchLimits limits = { .depth = 4 };
+  SearchResult result = searchPosition(&state, NULL, limits, defaultSearchOptions(), table);
+  CHECK(result.bestMove == moveFromUci(&state, "e1d2"));
+  CHECK(result.tablebaseHits > 0);
+  freeTranspositionTable(table);
+
+  endgameTablesFree();
+  CHECK(endgameTablesLargest() == 0);
+  char path[64];
+
+  // Tables cut in the middle, or whose win/draw/loss section is not where the header says, are rejected
+  snprintf(path, sizeof(path), "%s/KQvK%s", directory, ENDGAME_TABLE_EXTENSION);
+  EndgameTable queenTable;
+  CHECK(openEndgameTable(path, &queenTable));
+  char corruptedPath[64];
+  snprintf(corruptedPath, sizeof(corruptedPath), "%s/corrupted%s", directory, ENDGAME_TABLE_EXTENSION);
+  for (int corruption = 0; corruption < 2; corruption++) {
+    EndgameTableHeader header;
+    memcpy(&header, queenTable.file.data, sizeof(header));
+    u64 size = queenTable.file.size;
+    if (corruption == 0) { size = sizeof(header) + endgameWdlBytes(&queenTable.material) / 2; }
+    if (corruption == 1) { header.wdlOffset = header.dtmIndexOffset - 1; }
+    FILE* corrupted = fopen(corruptedPath, "wb");
+    CHECK(corrupted != NULL);
+    if (corrupted == NULL) { break; }
+    fwrite(&header, 1, sizeof(header), corrupted);
+    fwrite(queenTable.file.data + sizeof(header), 1, size - sizeof(header), corrupted);
+    fclose(corrupted);
+    EndgameTable corruptedTable;
+    CHECK(!openEndgameTable(corruptedPath, &corruptedTable));
+  }
+  closeEndgameTable(&queenTable);
+  remove(corruptedPath);
+
+  const char* names[] = { "KQvK", "KRvK" };
+  for (int i = 0; i < 2; i++) {
+    snprintf(path, sizeof(path), "%s/%s%s", directory, names[i], ENDGAME_TABLE_EXTENSION);
+    remove(path);
+  }
+  rmdir(directory);
+}
+
+typedef struct PgnGameOffsets {
+  size_t offsets[2];
+  int nbGames;
+} PgnGameOffsets;
+
+void recordPgnGameOffset(const PgnPosition* position, void* userData) {
+  PgnGameOffsets* games = userData;
+  if (position->ply == 0 && games->nbGames < 2) { games->offsets[games->nbGames++] = position->gameOffset; }
+}
+
+/**
+ * The game offsets are positions in the file, the byte order mark included
+*/
+void checkPgnImport() {
+  const char* text = "\xEF\xBB\xBF[Event \"a\"]\n\n1. e4 e5 1-0\n\n[Event \"b\"]\n\n1. d4 d5 0-1\n";
+  char path[] = "/tmp/pgnImportXXXXXX";
+  int descriptor = mkstemp(path);
+  if (descriptor < 0) {
+    printf("  could not create a temporary file, skipped\n");
+    return;
+  }
+  CHECK(write(descriptor, text, strlen(text)) == (ssize_t) strlen(text));
+  close(descriptor);
+
+  PgnGameOffsets games = { .nbGames = 0 };
+  PgnImportStats stats;
+  CHECK(importPgnFile(path, 1, recordPgnGameOffset, &games, &stats));
+  CHECK(stats.nbGames == 2 && stats.nbInvalidGames == 0 && games.nbGames == 2);
+  for (int i = 0; i < games.nbGames; i++) {
+    const char* expected = i == 0 ? "[Event \"a\"]" : "[Event \"b\"]";
+    CHECK(games.offsets[i] < strlen(text) && strncmp(text + games.offsets[i], expected, strlen(expected)) == 0);
+  }
+  remove(path);
+}
+
+typedef struct PolyglotKeyCheck {
+  const char* fen;
+  u64 key;
+} PolyglotKeyCheck;
+
+/**
+ * The reference keys of the Polyglot book format documentation
+*/
+void checkPolyglotKeys() {
+  const PolyglotKeyCheck positions[] = {
+    { STARTING_POSITION, 0x463b96181691fc9cULL },
+    { "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ULL },
+    { "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0ULL },
+    { "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4ULL },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78ULL },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1ULL },
+    { "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9ULL },
+    { "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637ULL },
+    { "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560ULL },
+  };
+  for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+    GameState state;
+    CHECK(setGameStateFromFenString(positions[i].fen, &state));
+    CHECK(polyglotKey(&state) == positions[i].key);
+  }
+}
+
+/**
+ * Writes `nbValues` random little endian numbers of `nbBytes` bytes, between -range and range - 1
+*/
+unsigned char* writeRandomNetworkValues(unsigned char* data, size_t nbValues, int nbBytes, int range) {
+  for (size_t i = 0; i < nbValues; i++) {
+    int value = (int) (nextRandom() % (2 * range)) - range;
+    for (int j = 0; j < nbBytes; j++) { *data++ = (unsigned char) ((unsigned int) value >> (8 * j)); }
+  }
+  return data;
+}
+
+/**
+ * A network of random weights in the format of Nnue.h, small enough that the accumulators do not overflow
+*/
+bool writeRandomNetwork(const char* path) {
+  size_t size = 32 + 2 * NNUE_HALF_DIMENSIONS + 2 * (size_t) NNUE_FEATURE_DIMENSIONS * NNUE_HALF_DIMENSIONS +
+    4 * NNUE_HIDDEN1_DIMENSIONS + NNUE_HIDDEN1_DIMENSIONS * 2 * NNUE_HALF_DIMENSIONS +
+    4 * NNUE_HIDDEN2_DIMENSIONS + NNUE_HIDDEN2_DIMENSIONS * NNUE_HIDDEN1_DIMENSIONS + 4 + NNUE_HIDDEN2_DIMENSIONS;
+  unsigned char* network = calloc(size, 1);
+  if (network == NULL) { return false; }
+  memcpy(network, "CNUE", 4);
+  const uint32_t header[5] = { 1, NNUE_FEATURE_DIMENSIONS, NNUE_HALF_DIMENSIONS, NNUE_HIDDEN1_DIMENSIONS, NNUE_HIDDEN2_DIMENSIONS };
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 4; j++) { network[4 + 4 * i + j] = (unsigned char) (header[i] >> (8 * j)); }
+  }
+  unsigned char* data = network + 32;
+  data = writeRandomNetworkValues(data, NNUE_HALF_DIMENSIONS, 2, 64);
+  data = writeRandomNetworkValues(data, (size_t) NNUE_FEATURE_DIMENSIONS * NNUE_HALF_DIMENSIONS, 2, 64);
+  data = writeRandomNetworkValues(data, NNUE_HIDDEN1_DIMENSIONS, 4, 1024);
+  data = writeRandomNetworkValues(data, NNUE_HIDDEN1_DIMENSIONS * 2 * NNUE_HALF_DIMENSIONS, 1, 64);
+  data = writeRandomNetworkValues(data, NNUE_HIDDEN2_DIMENSIONS, 4, 1024);
+  data = writeRandomNetworkValues(data, NNUE_HIDDEN2_DIMENSIONS * NNUE_HIDDEN1_DIMENSIONS, 1, 64);
+  data = writeRandomNetworkValues(data, 1, 4, 1024);
+  writeRandomNetworkValues(data, NNUE_HIDDEN2_DIMENSIONS, 1, 64);
+
+  FILE* file = fopen(path, "wb");
+  bool isWritten = file != NULL && fwrite(network, 1, size, file) == size;
+  if (file != NULL) { isWritten &= fclose(file) == 0; }
+  free(network);
+  return isWritten;
+}
+
+/**
+ * Along random games, the accumulator updated with the dirty pieces of every move is the one computed from scratch
+*/
+void checkNnueAccumulators() {
+  char path[] = "/tmp/nnueNetworkXXXXXX";
+  int descriptor = mkstemp(path);
+  if (descriptor < 0) {
+    printf("  could not create a temporary file, skipped\n");
+    return;
+  }
+  close(descriptor);
+  bool isWritten = writeRandomNetwork(path);
+  CHECK(isWritten);
+  bool isLoaded = isWritten && nnueLoadNetwork(path);
+  CHECK(isLoaded);
+  remove(path);
+  if (!isLoaded) { return; }
+
+  for (int game = 0; game < 20; game++) {
+    GameState state;
+    setGameStateFromFenString(STARTING_POSITION, &state);
+    NnueAccumulator accumulator;
+    nnueRefreshAccumulator(&accumulator, &state);
+    for (int ply = 0; ply < MAX_RANDOM_GAME_PLIES; ply++) {
+      Move moves[MAX_LEGAL_MOVES + 1] = { 0 };
+      GameState withoutFiftyRule = state;
+      withoutFiftyRule.turnsForFiftyRule = 0;
+      getValidMoves(moves, withoutFiftyRule, NULL);
+      if (fromSquareFromMove(moves[0]) == toSquareFromMove(moves[0])) { break; }
+      makeMove(moves[nextRandom() % nbMovesInArray(moves)], &state);
+
+      nnueUpdateAccumulator(&accumulator, &accumulator, &state);
+      NnueAccumulator refreshed;
+      nnueRefreshAccumulator(&refreshed, &state);
+      bool isSameAccumulator = memcmp(&accumulator, &refreshed, sizeof(NnueAccumulator)) == 0;
+      CHECK(isSameAccumulator);
+      if (!isSameAccumulator) { break; } // The next updates would start from the wrong accumulator
+      CHECK(nnueEvaluate(&accumulator, state.colorToGo) == nnueEvaluatePosition(&state));
+    }
+  }
+  CHECK(nnueUnloadNetwork());
+}
+
+typedef struct RegressionCheck {
+  const char* name;
+  void (*run)();
+} RegressionCheck;
+
+const RegressionCheck checks[] = {
+  { "fenStrings", checkFenStrings },
+  { "notation", checkNotation },
+  { "packedPositions", checkPackedPositions },
+  { "session", checkSession },
+  { "legalTargets", checkLegalTargets },
+  { "syzygy", checkSyzygy },
+  { "endgameTables", checkEndgameTables },
+  { "pgnImport", checkPgnImport },
+  { "polyglotKeys", checkPolyglotKeys },
+  { "nnueAccumulators", checkNnueAccumulators },
+};
+
+#define NB_CHECKS ((int) (sizeof(checks) / sizeof(checks[0])))
+
+/**
+ * Runs every check, or only the ones given as arguments. Returns 1 if one of them failed, so that ctest can run it
+*/
+int main(int argc, char* argv[]) {
+  magicBitBoardInitialize();
+  int nbFailedChecks = 0, nbRunChecks = 0;
+  for (int i = 0; i < NB_CHECKS; i++) {
+    bool isSelected = argc == 1;
+    for (int j = 1; j < argc; j++) { isSelected |= strcmp(argv[j], checks[i].name) == 0; }
+    if (!isSelected) { continue; }
+
+    int failuresBefore = nbFailures;
+    checks[i].run();
+    bool passed = nbFailures == failuresBefore;
+    printf("%-16s %s\n", checks[i].name, passed ? "ok" : "FAILED");
+    nbFailedChecks += !passed;
+    nbRunChecks++;
+  }
+  magicBitBoardTerminate();
+  printf("%d/%d checks failed\n", nbFailedChecks, nbRunChecks);
+  return nbFailedChecks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
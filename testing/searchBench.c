@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../src/magicBitBoard/MagicBitBoard.h"
+#include "../src/utils/FenString.h"
+#include "../src/search/Search.h"
+#include "../src/search/TranspositionTable.h"
+#include "LogChessStructs.h"
+
+#define DEFAULT_BENCH_DEPTH 8
+#define BENCH_HASH_SIZE 16 // In MB
+
+// A mix of opening, middle game and end game positions
+const char* benchPositions[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+  "2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 w - - 0 25",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "8/8/4k3/8/2p5/8/B2K4/8 w - - 0 1",
+  "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+  "r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - 0 7",
+};
+
+const int nbBenchPositions = sizeof(benchPositions) / sizeof(benchPositions[0]);
+
+double secondsSince(struct timespec start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void printUsage(char* programName) {
+  printf("Usage: %s [depth (positive integer)] [nonull] [nolmr] [norfp] [nolmp]\n", programName);
+  printf("Searches every bench position to the given depth (%d by default) and prints the nodes and the speed\n", DEFAULT_BENCH_DEPTH);
+  printf("The `no...` arguments turn off null move pruning, late move reductions, reverse futility pruning and late move pruning\n");
+}
+
+int main(int argc, char* argv[]) {
+  int depth = DEFAULT_BENCH_DEPTH;
+  SearchOptions options = defaultSearchOptions();
+  SearchFeatures* features = &options.features;
+
+  for (int i = 1; i < argc; i++) {
+    char* arg = argv[i];
+    if (strcmp(arg, "nonull") == 0) {
+      features->nullMovePruning = false;
+    } else if (strcmp(arg, "nolmr") == 0) {
+      features->lateMoveReductions = false;
+    } else if (strcmp(arg, "norfp") == 0) {
+      features->reverseFutilityPruning = false;
+    } else if (strcmp(arg, "nolmp") == 0) {
+      features->lateMovePruning = false;
+    } else if (atoi(arg) > 0) {
+      depth = atoi(arg);
+    } else {
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  printf("Depth %d, null move pruning: %s, late move reductions: %s, reverse futility pruning: %s, late move pruning: %s\n",
+    depth,
+    features->nullMovePruning ? "on" : "off",
+    features->lateMoveReductions ? "on" : "off",
+    features->reverseFutilityPruning ? "on" : "off",
+    features->lateMovePruning ? "on" : "off"
+  );
+
+  magicBitBoardInitialize();
+  TranspositionTable* table = createTranspositionTable(BENCH_HASH_SIZE);
+  SearchLimits limits = { .depth = depth, .nodes = 0 };
+
+  u64 totalNodes = 0;
+  double totalTime = 0;
+  for (int i = 0; i < nbBenchPositions; i++) {
+    char fenString[128];
+    strncpy(fenString, benchPositions[i], sizeof(fenString) - 1);
+    fenString[sizeof(fenString) - 1] = '\0';
+
+    GameState state;
+    if (!setGameStateFromFenString(fenString, &state)) {
+      printf("Invalid bench position: %s\n", benchPositions[i]);
+      exit(EXIT_FAILURE);
+    }
+
+    // Every position starts with an empty table, so that the results do not depend on the order of the positions
+    clearTranspositionTable(table);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SearchResult result = searchPosition(&state, NULL, limits, options, table);
+    double time = secondsSince(start);
+
+    totalNodes += result.nodes;
+    totalTime += time;
+    printf("Position %2d: score %6d, best move ", i + 1, result.score);
+    printMoveToAlgebraic(result.bestMove);
+    printf(", %10lu nodes, %8.3fs, %10.0f nps\n", result.nodes, time, result.nodes / time);
+  }
+
+  printf("Total: %lu nodes, %.3fs, %.0f nps\n", totalNodes, totalTime, totalNodes / totalTime);
+
+  freeTranspositionTable(table);
+  magicBitBoardTerminate();
+  return 0;
+}